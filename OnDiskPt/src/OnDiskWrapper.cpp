@@ -21,8 +21,15 @@
 #include <direct.h>
 #endif
 #include <sys/stat.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 #include <cassert>
+#include <iostream>
 #include <string>
+#include "util/exception.hh"
+#include "util/file.hh"
 #include "OnDiskWrapper.h"
 
 using namespace std;
@@ -30,6 +37,17 @@ using namespace std;
 namespace OnDiskPt
 {
 
+namespace
+{
+void MapForLoad(const std::string &filePath, util::scoped_memory &mem)
+{
+  util::scoped_fd file(util::OpenReadOrThrow(filePath.c_str()));
+  off_t size = util::SizeFile(file.get());
+  UTIL_THROW_IF(size == util::kBadSize, util::ErrnoException, "Couldn't size " << filePath);
+  util::MapRead(util::LAZY, file.get(), 0, size, mem);
+}
+}
+
 OnDiskWrapper::OnDiskWrapper()
 {
 }
@@ -55,14 +73,16 @@ bool OnDiskWrapper::BeginLoad(const std::string &filePath)
 
 bool OnDiskWrapper::OpenForLoad(const std::string &filePath)
 {
-  m_fileSource.open((filePath + "/Source.dat").c_str(), ios::in | ios::binary);
-  assert(m_fileSource.is_open());
-
-  m_fileTargetInd.open((filePath + "/TargetInd.dat").c_str(), ios::in | ios::binary);
-  assert(m_fileTargetInd.is_open());
-
-  m_fileTargetColl.open((filePath + "/TargetColl.dat").c_str(), ios::in | ios::binary);
-  assert(m_fileTargetColl.is_open());
+  // nodes and target phrases are read straight from these mappings, so
+  // concurrent lookups don't share a file position
+  try {
+    MapForLoad(filePath + "/Source.dat", m_memSource);
+    MapForLoad(filePath + "/TargetInd.dat", m_memTargetInd);
+    MapForLoad(filePath + "/TargetColl.dat", m_memTargetColl);
+  } catch (util::Exception &e) {
+    std::cerr << e.what() << std::endl;
+    return false;
+  }
 
   m_fileVocab.open((filePath + "/Vocab.dat").c_str(), ios::in);
   assert(m_fileVocab.is_open());
@@ -189,6 +209,19 @@ UINT64 OnDiskWrapper::GetMisc(const std::string &key) const
   return iter->second;
 }
 
+void OnDiskWrapper::PrefetchSource(UINT64 filePos, size_t size) const
+{
+#ifndef WIN32
+  static const size_t pageSize = sysconf(_SC_PAGE_SIZE);
+  // a node within one page is read in by the first access anyway
+  if (size < pageSize)
+    return;
+
+  UINT64 begin = filePos - filePos % pageSize;
+  madvise(const_cast<char*>(m_memSource.begin()) + begin, filePos + size - begin, MADV_WILLNEED);
+#endif
+}
+
 PhraseNode &OnDiskWrapper::GetRootSourceNode()
 {
   return *m_rootSourceNode;
@@ -20,6 +20,7 @@
  ***********************************************************************/
 #include <string>
 #include <fstream>
+#include "util/mmap.hh"
 #include "Vocab.h"
 #include "PhraseNode.h"
 #include "../../moses/src/Word.h"
@@ -35,6 +36,8 @@ protected:
   std::string m_filePath;
   int m_numSourceFactors, m_numTargetFactors, m_numScores;
   std::fstream m_fileMisc, m_fileVocab, m_fileSource, m_fileTarget, m_fileTargetInd, m_fileTargetColl;
+  // read-only mappings of the source, target and target collection files, used once loaded
+  util::scoped_memory m_memSource, m_memTargetInd, m_memTargetColl;
 
   size_t m_defaultNodeSize;
   PhraseNode *m_rootSourceNode;
@@ -75,6 +78,19 @@ public:
     return m_fileVocab;
   }
 
+  const char *GetMemSource() const {
+    return m_memSource.begin();
+  }
+  const char *GetMemTargetInd() const {
+    return m_memTargetInd.begin();
+  }
+  const char *GetMemTargetColl() const {
+    return m_memTargetColl.begin();
+  }
+
+  //! ask the OS to read in part of the source file, eg. a node that will be searched soon
+  void PrefetchSource(UINT64 filePos, size_t size) const;
+
   size_t GetNumSourceFactors() const {
     return m_numSourceFactors;
   }
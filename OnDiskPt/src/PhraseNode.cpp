@@ -53,28 +53,16 @@ PhraseNode::PhraseNode(UINT64 filePos, OnDiskWrapper &onDiskWrapper)
 
   size_t countSize = onDiskWrapper.GetNumCounts();
 
-  std::fstream &file = onDiskWrapper.GetFileSource();
-  file.seekg(filePos);
-  assert(filePos == file.tellg());
-
-  file.read((char*) &m_numChildrenLoad, sizeof(UINT64));
-
+  // the node is used in place, in the mapping of the source file
+  m_memLoad = onDiskWrapper.GetMemSource() + filePos;
+  m_numChildrenLoad = ((const UINT64*)m_memLoad)[0];
   size_t memAlloc = GetNodeSize(m_numChildrenLoad, onDiskWrapper.GetSourceWordSize(), countSize);
-  m_memLoad = (char*) malloc(memAlloc);
-
-  // go to start of node again
-  file.seekg(filePos);
-  assert(filePos == file.tellg());
-
-  // read everything into memory
-  file.read(m_memLoad, memAlloc);
-  assert(filePos + memAlloc == file.tellg());
 
   // get value
-  m_value = ((UINT64*)m_memLoad)[1];
+  m_value = ((const UINT64*)m_memLoad)[1];
 
   // get counts
-  float *memFloat = (float*) (m_memLoad + sizeof(UINT64) * 2);
+  const float *memFloat = (const float*) (m_memLoad + sizeof(UINT64) * 2);
 
   assert(countSize == 1);
   m_counts[0] = memFloat[0];
@@ -84,10 +72,14 @@ PhraseNode::PhraseNode(UINT64 filePos, OnDiskWrapper &onDiskWrapper)
 
 PhraseNode::~PhraseNode()
 {
-  free(m_memLoad);
   //assert(m_saved);
 }
 
+void PhraseNode::Prefetch(const OnDiskWrapper &onDiskWrapper) const
+{
+  onDiskWrapper.PrefetchSource(m_filePos, m_memLoadLast - m_memLoad);
+}
+
 float PhraseNode::GetCount(size_t ind) const
 {
   return m_counts[ind];
@@ -228,7 +220,7 @@ void PhraseNode::GetChild(Word &wordFound, UINT64 &childFilePos, size_t ind, OnD
   size_t childSize = wordSize + sizeof(UINT64);
   size_t numFactors = onDiskWrapper.GetNumSourceFactors();
 
-  char *currMem = m_memLoad
+  const char *currMem = m_memLoad
                   + sizeof(UINT64) * 2 // size & file pos of target phrase coll
                   + sizeof(float) * onDiskWrapper.GetNumCounts() // count info
                   + childSize * ind;
@@ -45,7 +45,7 @@ protected:
 
   TargetPhraseCollection m_targetPhraseColl;
 
-  char *m_memLoad, *m_memLoadLast;
+  const char *m_memLoad, *m_memLoadLast; //! saved node, in the mapping of the source file
   UINT64 m_numChildrenLoad;
 
   void AddTargetPhrase(size_t pos, const SourcePhrase &sourcePhrase
@@ -90,6 +90,8 @@ public:
   }
 
   const PhraseNode *GetChild(const Word &wordSought, OnDiskWrapper &onDiskWrapper) const;
+  //! start reading in the children of a saved node that is going to be searched
+  void Prefetch(const OnDiskWrapper &onDiskWrapper) const;
   const TargetPhraseCollection *GetTargetPhraseCollection(size_t tableLimit, OnDiskWrapper &onDiskWrapper) const;
 
   void AddCounts(const std::vector<float> &counts) {
@@ -230,79 +230,57 @@ Moses::TargetPhrase *TargetPhrase::ConvertToMoses(const std::vector<Moses::Facto
   return ret;
 }
 
-UINT64 TargetPhrase::ReadOtherInfoFromFile(UINT64 filePos, std::fstream &fileTPColl)
+UINT64 TargetPhrase::ReadOtherInfoFromMemory(const char *mem)
 {
-  assert(filePos == fileTPColl.tellg());
-
   UINT64 memUsed = 0;
-  fileTPColl.read((char*) &m_filePos, sizeof(UINT64));
+  m_filePos = ((const UINT64*)mem)[0];
   memUsed += sizeof(UINT64);
   assert(m_filePos != 0);
 
-  memUsed += ReadAlignFromFile(fileTPColl);
-  assert((memUsed + filePos) == fileTPColl.tellg());
-
-  memUsed += ReadScoresFromFile(fileTPColl);
-  assert((memUsed + filePos) == fileTPColl.tellg());
+  memUsed += ReadAlignFromMemory(mem + memUsed);
+  memUsed += ReadScoresFromMemory(mem + memUsed);
 
   return memUsed;
 }
 
-UINT64 TargetPhrase::ReadFromFile(std::fstream &fileTP, size_t numFactors)
+UINT64 TargetPhrase::ReadFromMemory(const char *mem, size_t numFactors)
 {
   UINT64 bytesRead = 0;
 
-  fileTP.seekg(m_filePos);
-
-  UINT64 numWords;
-  fileTP.read((char*) &numWords, sizeof(UINT64));
+  UINT64 numWords = ((const UINT64*)mem)[0];
   bytesRead += sizeof(UINT64);
 
   for (size_t ind = 0; ind < numWords; ++ind) {
     Word *word = new Word();
-    bytesRead += word->ReadFromFile(fileTP, numFactors);
+    bytesRead += word->ReadFromMemory(mem + bytesRead, numFactors);
     AddWord(word);
   }
 
   return bytesRead;
 }
 
-UINT64 TargetPhrase::ReadAlignFromFile(std::fstream &fileTPColl)
+UINT64 TargetPhrase::ReadAlignFromMemory(const char *mem)
 {
-  UINT64 bytesRead = 0;
-
-  UINT64 numAlign;
-  fileTPColl.read((char*) &numAlign, sizeof(UINT64));
-  bytesRead += sizeof(UINT64);
+  const UINT64 *memArray = (const UINT64*) mem;
+  UINT64 numAlign = memArray[0];
 
   for (size_t ind = 0; ind < numAlign; ++ind) {
-    AlignPair alignPair;
-    fileTPColl.read((char*) &alignPair.first, sizeof(UINT64));
-    fileTPColl.read((char*) &alignPair.second, sizeof(UINT64));
+    AlignPair alignPair(memArray[1 + ind * 2], memArray[2 + ind * 2]);
     m_align.push_back(alignPair);
-
-    bytesRead += sizeof(UINT64) * 2;
   }
 
-  return bytesRead;
+  return sizeof(UINT64) * (1 + numAlign * 2);
 }
 
-UINT64 TargetPhrase::ReadScoresFromFile(std::fstream &fileTPColl)
+UINT64 TargetPhrase::ReadScoresFromMemory(const char *mem)
 {
   assert(m_scores.size() > 0);
 
-  UINT64 bytesRead = 0;
-
-  for (size_t ind = 0; ind < m_scores.size(); ++ind) {
-    fileTPColl.read((char*) &m_scores[ind], sizeof(float));
-
-    bytesRead += sizeof(float);
-  }
-
-  std::transform(m_scores.begin(),m_scores.end(),m_scores.begin(), Moses::TransformScore);
+  const float *memFloat = (const float*) mem;
+  std::transform(memFloat, memFloat + m_scores.size(), m_scores.begin(), Moses::TransformScore);
   std::transform(m_scores.begin(),m_scores.end(),m_scores.begin(), Moses::FloorScore);
 
-  return bytesRead;
+  return sizeof(float) * m_scores.size();
 }
 
 std::ostream& operator<<(std::ostream &out, const TargetPhrase &phrase)
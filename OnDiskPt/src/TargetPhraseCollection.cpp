@@ -152,30 +152,26 @@ Moses::TargetPhraseCollection *TargetPhraseCollection::ConvertToMoses(const std:
 
 void TargetPhraseCollection::ReadFromFile(size_t tableLimit, UINT64 filePos, OnDiskWrapper &onDiskWrapper)
 {
-  fstream &fileTPColl = onDiskWrapper.GetFileTargetColl();
-  fstream &fileTP = onDiskWrapper.GetFileTargetInd();
+  const char *memTPColl = onDiskWrapper.GetMemTargetColl() + filePos;
+  const char *memTP = onDiskWrapper.GetMemTargetInd();
 
   size_t numScores = onDiskWrapper.GetNumScores();
   size_t numTargetFactors = onDiskWrapper.GetNumTargetFactors();
 
-  UINT64 numPhrases;
-
-  UINT64 currFilePos = filePos;
-  fileTPColl.seekg(filePos);
-  fileTPColl.read((char*) &numPhrases, sizeof(UINT64));
+  UINT64 numPhrases = ((const UINT64*)memTPColl)[0];
 
   // table limit
   numPhrases = std::min(numPhrases, (UINT64) tableLimit);
 
-  currFilePos += sizeof(UINT64);
+  memTPColl += sizeof(UINT64);
 
   for (size_t ind = 0; ind < numPhrases; ++ind) {
     TargetPhrase *tp = new TargetPhrase(numScores);
 
-    UINT64 sizeOtherInfo = tp->ReadOtherInfoFromFile(currFilePos, fileTPColl);
-    tp->ReadFromFile(fileTP, numTargetFactors);
+    UINT64 sizeOtherInfo = tp->ReadOtherInfoFromMemory(memTPColl);
+    tp->ReadFromMemory(memTP + tp->GetFilePos(), numTargetFactors);
 
-    currFilePos += sizeOtherInfo;
+    memTPColl += sizeOtherInfo;
 
     m_coll.push_back(tp);
   }
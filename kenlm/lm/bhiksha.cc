@@ -1,6 +1,7 @@
 #include "lm/bhiksha.hh"
 #include "lm/config.hh"
 
+#include <algorithm>
 #include <limits>
 
 namespace lm {
@@ -92,6 +93,62 @@ void ArrayBhiksha::FinishedLoading(const Config &config) {
 void ArrayBhiksha::LoadedBinary() {
 }
 
+const uint8_t kEliasFanoBhikshaVersion = 0;
+
+void EliasFanoBhiksha::UpdateConfigFromBinary(FD fd, Config &/*config*/) {
+  uint8_t version;
+#ifdef WIN32
+#else
+  if (read(fd, &version, 1) != 1) {
+    UTIL_THROW(util::ErrnoException, "Could not read from binary file");
+  }
+#endif
+  if (version != kEliasFanoBhikshaVersion) UTIL_THROW(FormatLoadException, "This file has Elias-Fano pointer compression version " << (unsigned) version << " but the code expects version " << (unsigned)kEliasFanoBhikshaVersion);
+}
+
+namespace {
+
+std::size_t SampleCount(uint64_t max_offset, uint64_t sample) {
+  return max_offset / sample + 1;
+}
+
+// Each of the max_offset pointers sets a bit, spread over the high values.  +1 so scans stop in bounds.
+std::size_t HighWords(uint64_t max_offset, uint64_t max_next, uint8_t inline_bits) {
+  return ((max_next >> inline_bits) + max_offset + 63) / 64 + 1;
+}
+
+} // namespace
+
+std::size_t EliasFanoBhiksha::Size(uint64_t max_offset, uint64_t max_next, const Config &config) {
+  return sizeof(uint64_t) * (1 /* header */ + SampleCount(max_offset, kSelectSample) + HighWords(max_offset, max_next, InlineBits(max_offset, max_next, config))) + 7 /* 8-byte alignment */;
+}
+
+uint8_t EliasFanoBhiksha::InlineBits(uint64_t max_offset, uint64_t max_next, const Config &/*config*/) {
+  // floor(log2(max_next / max_offset)) minimizes the total size.
+  uint64_t ratio = max_next / std::max<uint64_t>(max_offset, 1);
+  return ratio ? util::RequiredBits(ratio) - 1 : 0;
+}
+
+EliasFanoBhiksha::EliasFanoBhiksha(void *base, uint64_t max_offset, uint64_t max_next, const Config &config)
+  : next_inline_(util::BitsMask::ByBits(InlineBits(max_offset, max_next, config))),
+    samples_(reinterpret_cast<uint64_t*>(AlignTo8(base)) + 1 /* 8-byte header */),
+    high_(samples_ + SampleCount(max_offset, kSelectSample)),
+    high_words_(HighWords(max_offset, max_next, next_inline_.bits)),
+    written_(0),
+    original_base_(base) {}
+
+void EliasFanoBhiksha::FinishedLoading(const Config &/*config*/) {
+  uint64_t rank = 0;
+  for (uint64_t word = 0; word < high_words_; ++word) {
+    for (uint64_t bits = high_[word]; bits; bits &= bits - 1, ++rank) {
+      if (!(rank % kSelectSample)) samples_[rank / kSelectSample] = (word << 6) + util::LowestBit64(bits);
+    }
+  }
+  if (rank != written_) UTIL_THROW(util::Exception, "Elias-Fano pointers collided: " << rank << " bits set for " << written_ << " pointers.");
+
+  *reinterpret_cast<uint8_t*>(original_base_) = kEliasFanoBhikshaVersion;
+}
+
 } // namespace trie
 } // namespace ngram
 } // namespace lm
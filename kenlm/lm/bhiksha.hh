@@ -8,6 +8,16 @@
  *  }
  *
  *  Currently only used for next pointers.  
+ *
+ *  EliasFanoBhiksha instead uses
+ * @inproceedings{elias1974efficient,
+ *  author={Peter Elias},
+ *  year={1974},
+ *  title={Efficient Storage and Retrieval by Content and Address of Static Files},
+ *  journal={Journal of the ACM},
+ *  volume={21},
+ *  pages={246--260},
+ *  }
  */
 
 #include <stdint.h>
@@ -106,6 +116,82 @@ class ArrayBhiksha {
     void *original_base_;
 };
 
+/* Next pointers are non-decreasing, so Elias-Fano code them.  The low bits of
+ * each pointer stay inline like ArrayBhiksha.  The high bits are stored in
+ * unary: pointer i sets bit (pointer >> inline bits) + i of a bit vector that
+ * has about two bits per entry.  Reading pointer i means finding set bit i,
+ * which starts from a sample of every kSelectSample-th set bit.  The next
+ * pointer is the following set bit.
+ */
+class EliasFanoBhiksha {
+  public:
+    static const ModelType kModelTypeAdd = kEliasFanoAdd;
+
+    static void UpdateConfigFromBinary(FD fd, Config &config);
+
+    static std::size_t Size(uint64_t max_offset, uint64_t max_next, const Config &config);
+
+    static uint8_t InlineBits(uint64_t max_offset, uint64_t max_next, const Config &config);
+
+    EliasFanoBhiksha(void *base, uint64_t max_offset, uint64_t max_next, const Config &config);
+
+    void ReadNext(const void *base, uint64_t bit_offset, uint64_t index, uint8_t total_bits, NodeRange &out) const {
+      uint64_t position = Select(index);
+      out.begin = ((position - index) << next_inline_.bits) |
+        util::ReadInt57(base, bit_offset, next_inline_.bits, next_inline_.mask);
+      position = NextSet(position);
+      out.end = ((position - index - 1) << next_inline_.bits) |
+        util::ReadInt57(base, bit_offset + total_bits, next_inline_.bits, next_inline_.mask);
+      //assert(out.end >= out.begin);
+    }
+
+    void WriteNext(void *base, uint64_t bit_offset, uint64_t /*index*/, uint64_t value) {
+      uint64_t position = (value >> next_inline_.bits) + written_++;
+      high_[position >> 6] |= 1ULL << (position & 63);
+      util::WriteInt57(base, bit_offset, next_inline_.bits, value & next_inline_.mask);
+    }
+
+    void FinishedLoading(const Config &config);
+
+    void LoadedBinary() {}
+
+    uint8_t InlineBits() const { return next_inline_.bits; }
+
+  private:
+    static const uint64_t kSelectSample = 256;
+
+    // Position of the set bit with this rank, counting from 0.
+    uint64_t Select(uint64_t rank) const {
+      uint64_t position = samples_[rank / kSelectSample];
+      uint64_t remaining = rank % kSelectSample;
+      const uint64_t *word = high_ + (position >> 6);
+      uint64_t bits = *word & (~0ULL << (position & 63));
+      for (unsigned int count; remaining >= (count = util::PopCount64(bits)); bits = *++word) {
+        remaining -= count;
+      }
+      for (; remaining; --remaining) bits &= bits - 1;
+      return ((word - high_) << 6) + util::LowestBit64(bits);
+    }
+
+    // Position of the first set bit after position.
+    uint64_t NextSet(uint64_t position) const {
+      const uint64_t *word = high_ + (position >> 6);
+      uint64_t bits = *word & ((~0ULL << (position & 63)) << 1);
+      while (!bits) bits = *++word;
+      return ((word - high_) << 6) + util::LowestBit64(bits);
+    }
+
+    const util::BitsMask next_inline_;
+
+    uint64_t *const samples_;
+    uint64_t *const high_;
+    const uint64_t high_words_;
+
+    uint64_t written_;
+
+    void *original_base_;
+};
+
 } // namespace trie
 } // namespace ngram
 } // namespace lm
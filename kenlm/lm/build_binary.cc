@@ -15,9 +15,11 @@ namespace ngram {
 namespace {
 
 void Usage(const char *name) {
-  std::cerr << "Usage: " << name << " [-u log10_unknown_probability] [-s] [-i] [-p probing_multiplier] [-t trie_temporary] [-m trie_building_megabytes] [-q bits] [-b bits] [-c bits] [type] input.arpa [output.mmap]\n\n"
+  std::cerr << "Usage: " << name << " [-u log10_unknown_probability] [-s] [-i] [-p probing_multiplier] [-t trie_temporary] [-m trie_building_megabytes] [-j threads] [-q bits] [-b bits] [-a bits] [-e] [type] input.arpa [output.mmap]\n\n"
 "-u sets the log10 probability for <unk> if the ARPA file does not have one.\n"
 "   Default is -100.  The ARPA file will always take precedence.\n"
+"-j sets the number of threads that parse the ARPA file and, for trie, sort\n"
+"   and merge.  Default is 1.\n"
 "-s allows models to be built even if they do not have <s> and </s>.\n"
 "-i allows buggy models from IRSTLM by mapping positive log probability to 0.\n\n"
 "type is either probing or trie.  Default is probing.\n\n"
@@ -28,11 +30,14 @@ void Usage(const char *name) {
 "on-disk sort to save memory.\n"
 "-t is the temporary directory prefix.  Default is the output file name.\n"
 "-m limits memory use for sorting.  Measured in MB.  Default is 1024MB.\n"
+"   It is split between the sorting threads.\n"
 "-q turns quantization on and sets the number of bits (e.g. -q 8).\n"
 "-b sets backoff quantization bits.  Requires -q and defaults to that value.\n"
 "-a compresses pointers using an array of offsets.  The parameter is the\n"
 "   maximum number of bits encoded by the array.  Memory is minimized subject\n"
-"   to the maximum, so pick 255 to minimize memory.\n\n"
+"   to the maximum, so pick 255 to minimize memory.\n"
+"-e compresses pointers with Elias-Fano coding instead, which usually takes\n"
+"   less memory than -a but makes lookups a little slower.\n\n"
 "Get a memory estimate by passing an ARPA file without an output file name.\n";
   exit(1);
 }
@@ -64,12 +69,14 @@ void ShowSizes(const char *file, const lm::ngram::Config &config) {
   std::vector<uint64_t> counts;
   util::FilePiece f(file);
   lm::ReadARPACounts(f, counts);
-  std::size_t sizes[5];
+  std::size_t sizes[7];
   sizes[0] = ProbingModel::Size(counts, config);
   sizes[1] = TrieModel::Size(counts, config);
   sizes[2] = QuantTrieModel::Size(counts, config);
   sizes[3] = ArrayTrieModel::Size(counts, config);
   sizes[4] = QuantArrayTrieModel::Size(counts, config);
+  sizes[5] = EliasFanoTrieModel::Size(counts, config);
+  sizes[6] = QuantEliasFanoTrieModel::Size(counts, config);
   std::size_t max_length = *std::max_element(sizes, sizes + sizeof(sizes) / sizeof(size_t));
   std::size_t min_length = *std::min_element(sizes, sizes + sizeof(sizes) / sizeof(size_t));
   std::size_t divide;
@@ -96,7 +103,9 @@ void ShowSizes(const char *file, const lm::ngram::Config &config) {
     "trie    " << std::setw(length) << (sizes[1] / divide) << " without quantization\n"
     "trie    " << std::setw(length) << (sizes[2] / divide) << " assuming -q " << (unsigned)config.prob_bits << " -b " << (unsigned)config.backoff_bits << " quantization \n"
     "trie    " << std::setw(length) << (sizes[3] / divide) << " assuming -a " << (unsigned)config.pointer_bhiksha_bits << " array pointer compression\n"
-    "trie    " << std::setw(length) << (sizes[4] / divide) << " assuming -a " << (unsigned)config.pointer_bhiksha_bits << " -q " << (unsigned)config.prob_bits << " -b " << (unsigned)config.backoff_bits<< " array pointer compression and quantization\n";
+    "trie    " << std::setw(length) << (sizes[4] / divide) << " assuming -a " << (unsigned)config.pointer_bhiksha_bits << " -q " << (unsigned)config.prob_bits << " -b " << (unsigned)config.backoff_bits<< " array pointer compression and quantization\n"
+    "trie    " << std::setw(length) << (sizes[5] / divide) << " assuming -e Elias-Fano pointer compression\n"
+    "trie    " << std::setw(length) << (sizes[6] / divide) << " assuming -e -q " << (unsigned)config.prob_bits << " -b " << (unsigned)config.backoff_bits<< " Elias-Fano pointer compression and quantization\n";
 }
 
 void ProbingQuantizationUnsupported() {
@@ -112,10 +121,10 @@ int main(int argc, char *argv[]) {
   using namespace lm::ngram;
 
   try {
-    bool quantize = false, set_backoff_bits = false, bhiksha = false;
+    bool quantize = false, set_backoff_bits = false, bhiksha = false, elias_fano = false;
     lm::ngram::Config config;
     int opt;
-    while ((opt = getopt(argc, argv, "siu:p:t:m:q:b:a:")) != -1) {
+    while ((opt = getopt(argc, argv, "siu:p:t:m:j:q:b:a:e")) != -1) {
       switch(opt) {
         case 'q':
           config.prob_bits = ParseBitCount(optarg);
@@ -141,6 +150,13 @@ int main(int argc, char *argv[]) {
         case 'm':
           config.building_memory = ParseUInt(optarg) * 1048576;
           break;
+        case 'e':
+          elias_fano = true;
+          break;
+        case 'j':
+          config.building_threads = ParseUInt(optarg);
+          config.arpa_threads = config.building_threads;
+          break;
         case 's':
           config.sentence_marker_missing = lm::SILENT;
           break;
@@ -155,6 +171,10 @@ int main(int argc, char *argv[]) {
       std::cerr << "You specified backoff quantization (-b) but not probability quantization (-q)" << std::endl;
       abort();
     }
+    if (bhiksha && elias_fano) {
+      std::cerr << "Pick one pointer compression: array (-a) or Elias-Fano (-e)" << std::endl;
+      abort();
+    }
     if (optind + 1 == argc) {
       ShowSizes(argv[optind], config);
     } else if (optind + 2 == argc) {
@@ -172,12 +192,16 @@ int main(int argc, char *argv[]) {
         if (quantize) {
           if (bhiksha) {
             QuantArrayTrieModel(from_file, config);
+          } else if (elias_fano) {
+            QuantEliasFanoTrieModel(from_file, config);
           } else {
             QuantTrieModel(from_file, config);
           }
         } else {
           if (bhiksha) {
             ArrayTrieModel(from_file, config);
+          } else if (elias_fano) {
+            EliasFanoTrieModel(from_file, config);
           } else {
             TrieModel(from_file, config);
           }
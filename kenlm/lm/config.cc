@@ -14,6 +14,8 @@ Config::Config() :
   unknown_missing_logprob(-100.0),
   probing_multiplier(1.5),
   building_memory(1073741824ULL), // 1 GB
+  building_threads(1),
+  arpa_threads(1),
   temporary_directory_prefix(NULL),
   arpa_complain(ALL),
   write_mmap(NULL),
@@ -21,7 +23,8 @@ Config::Config() :
   prob_bits(8),
   backoff_bits(8),
   pointer_bhiksha_bits(22),
-  load_method(util::POPULATE_OR_READ) {}
+  load_method(util::POPULATE_OR_READ),
+  shared_memory_name(NULL) {}
 
 } // namespace ngram
 } // namespace lm
@@ -56,6 +56,16 @@ struct Config {
   // models.
   std::size_t building_memory;
 
+  // Number of threads to build a trie with: one reads the ARPA file, the
+  // others sort and merge in the background.  building_memory is split
+  // between them.  Only applies to trie models and needs WITH_THREADS.  
+  std::size_t building_threads;
+
+  // Number of threads to parse the n-grams of an ARPA file with.  They are
+  // still inserted in file order, so the model is the same for any number.
+  // Needs WITH_THREADS.  
+  std::size_t arpa_threads;
+
   // Template for temporary directory appropriate for passing to mkdtemp.  
   // The characters XXXXXX are appended before passing to mkdtemp.  Only
   // applies to trie.  If NULL, defaults to write_mmap.  If that's NULL,
@@ -89,6 +99,14 @@ struct Config {
   // See util/mmap.hh for details of MapMethod.  
   util::LoadMethod load_method;
 
+  // If not NULL, the name of a POSIX shared memory segment (e.g. "/lm") that
+  // processes loading the same binary file share, so it is in memory once.
+  // The first process reads the file into the segment and later ones attach
+  // to it read-only.  The segment stays until removed.  load_method is only
+  // consulted for HUGE_READ, which asks for transparent huge pages on it.
+  // See util::MapSharedRead.  
+  const char *shared_memory_name;
+
 
 
   // Set defaults. 
@@ -49,23 +49,32 @@
 namespace lm {
 namespace ngram {
 
+/* The left state holds pointers to the n-grams that the leftmost words begin,
+ * only as many as might still be extended by words to the left.  full is the
+ * explicit independent left flag: once set, no words added to the left can
+ * change the probability of the words in this fragment, so the pointers are
+ * all that matter for recombination.  Entries of pointers beyond length are
+ * undefined and never compared or hashed.
+ */
 struct Left {
   bool operator==(const Left &other) const {
     return 
       (length == other.length) && 
-      pointers[length - 1] == other.pointers[length - 1];
+      (!length || pointers[length - 1] == other.pointers[length - 1]) &&
+      (full == other.full);
   }
 
   int Compare(const Left &other) const {
     if (length != other.length) return length < other.length ? -1 : 1;
-    if (pointers[length - 1] > other.pointers[length - 1]) return 1;
-    if (pointers[length - 1] < other.pointers[length - 1]) return -1;
-    return 0;
+    if (length) {
+      if (pointers[length - 1] > other.pointers[length - 1]) return 1;
+      if (pointers[length - 1] < other.pointers[length - 1]) return -1;
+    }
+    return (int)full - (int)other.full;
   }
 
   bool operator<(const Left &other) const {
-    if (length != other.length) return length < other.length;
-    return pointers[length - 1] < other.pointers[length - 1];
+    return Compare(other) < 0;
   }
 
   void ZeroRemaining() {
@@ -73,29 +82,31 @@ struct Left {
       *i = 0;
   }
 
-  unsigned char length;
   uint64_t pointers[kMaxOrder - 1];
+  unsigned char length;
+  bool full;
 };
 
 inline size_t hash_value(const Left &left) {
-  return util::MurmurHashNative(&left.length, 1, left.pointers[left.length - 1]);
+  unsigned char add[2];
+  add[0] = left.length;
+  add[1] = left.full;
+  return util::MurmurHashNative(add, 2, left.length ? left.pointers[left.length - 1] : 0);
 }
 
 struct ChartState {
-  bool operator==(const ChartState &other) {
-    return (left == other.left) && (right == other.right) && (full == other.full);
+  bool operator==(const ChartState &other) const {
+    return (left == other.left) && (right == other.right);
   }
 
   int Compare(const ChartState &other) const {
     int lres = left.Compare(other.left);
     if (lres) return lres;
-    int rres = right.Compare(other.right);
-    if (rres) return rres;
-    return (int)full - (int)other.full;
+    return right.Compare(other.right);
   }
 
   bool operator<(const ChartState &other) const {
-    return Compare(other) == -1;
+    return Compare(other) < 0;
   }
 
   void ZeroRemaining() {
@@ -104,7 +115,6 @@ struct ChartState {
   }
 
   Left left;
-  bool full;
   State right;
 };
 
@@ -112,13 +122,14 @@ inline size_t hash_value(const ChartState &state) {
   size_t hashes[2];
   hashes[0] = hash_value(state.left);
   hashes[1] = hash_value(state.right);
-  return util::MurmurHashNative(hashes, sizeof(size_t), state.full);
+  return util::MurmurHashNative(hashes, sizeof(size_t) * 2);
 }
 
 template <class M> class RuleScore {
   public:
     explicit RuleScore(const M &model, ChartState &out) : model_(model), out_(out), left_done_(false), prob_(0.0) {
       out.left.length = 0;
+      out.left.full = false;
       out.right.length = 0;
     }
 
@@ -146,14 +157,14 @@ template <class M> class RuleScore {
     void BeginNonTerminal(const ChartState &in, float prob) {
       prob_ = prob;
       out_ = in;
-      left_done_ = in.full;
+      left_done_ = in.left.full;
     }
 
     void NonTerminal(const ChartState &in, float prob) {
       prob_ += prob;
       
       if (!in.left.length) {
-        if (in.full) {
+        if (in.left.full) {
           for (const float *i = out_.right.backoff; i < out_.right.backoff + out_.right.length; ++i) prob_ += *i;
           left_done_ = true;
           out_.right = in.right;
@@ -168,7 +179,7 @@ template <class M> class RuleScore {
           left_done_ = true;
         } else {
           out_.left = in.left;
-          left_done_ = in.full;
+          left_done_ = in.left.full;
         }
         return;
       }
@@ -186,7 +197,7 @@ template <class M> class RuleScore {
         std::swap(back, back2);
       }
 
-      if (in.full) {
+      if (in.left.full) {
         for (const float *i = back; i != back + next_use; ++i) prob_ += *i;
         left_done_ = true;
         out_.right = in.right;
@@ -213,7 +224,7 @@ template <class M> class RuleScore {
 
     float Finish() {
       // A N-1-gram might extend left and right but we should still set full to true because it's an N-1-gram.  
-      out_.full = left_done_ || (out_.left.length == model_.Order() - 1);
+      out_.left.full = left_done_ || (out_.left.length == model_.Order() - 1);
       return prob_;
     }
 
@@ -84,7 +84,10 @@ template <class Search, class VocabularyT> void GenericModel<Search, VocabularyT
     }
     FinishFile(config, kModelType, kVersion, counts, backing_);
   } catch (util::Exception &e) {
-    e << " Byte: " << f.Offset();
+    // With several threads the n-gram sections are read ahead in chunks, so
+    // f.Offset() can be far past the line at fault.  Errors in those sections
+    // carry the offset of their line instead.
+    if (config.arpa_threads <= 1) e << " Byte: " << f.Offset();
     throw;
   }
 }
@@ -271,6 +274,8 @@ template class GenericModel<trie::TrieSearch<DontQuantize, trie::DontBhiksha>, S
 template class GenericModel<trie::TrieSearch<DontQuantize, trie::ArrayBhiksha>, SortedVocabulary>;
 template class GenericModel<trie::TrieSearch<SeparatelyQuantize, trie::DontBhiksha>, SortedVocabulary>; // TRIE_SORTED_QUANT
 template class GenericModel<trie::TrieSearch<SeparatelyQuantize, trie::ArrayBhiksha>, SortedVocabulary>;
+template class GenericModel<trie::TrieSearch<DontQuantize, trie::EliasFanoBhiksha>, SortedVocabulary>; // ELIAS_FANO_TRIE_SORTED
+template class GenericModel<trie::TrieSearch<SeparatelyQuantize, trie::EliasFanoBhiksha>, SortedVocabulary>; // QUANT_ELIAS_FANO_TRIE_SORTED
 
 } // namespace detail
 } // namespace ngram
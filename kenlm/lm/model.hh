@@ -118,6 +118,15 @@ template <class Search, class VocabularyT> class GenericModel : public base::Mod
      */
     void GetState(const WordIndex *context_rbegin, const WordIndex *context_rend, State &out_state) const;
 
+    /* Hint that new_word will soon be scored after the context, given in
+     * reverse order like for FullScoreForgotState.  This starts loading the
+     * entries the lookup reads, so that several lookups can wait for memory
+     * at the same time instead of one after the other.  
+     */
+    void Prefetch(const WordIndex *context_rbegin, const WordIndex *context_rend, const WordIndex new_word) const {
+      search_.Prefetch(context_rbegin, std::min(context_rend, context_rbegin + P::Order() - 1), new_word);
+    }
+
     /* More efficient version of FullScore where a partial n-gram has already
      * been scored.  
      * NOTE: THE RETURNED .prob IS RELATIVE, NOT ABSOLUTE.  So for example, if
@@ -179,9 +188,11 @@ typedef ProbingModel Model;
 typedef ::lm::ngram::SortedVocabulary SortedVocabulary;
 typedef detail::GenericModel<trie::TrieSearch<DontQuantize, trie::DontBhiksha>, SortedVocabulary> TrieModel; // TRIE_SORTED
 typedef detail::GenericModel<trie::TrieSearch<DontQuantize, trie::ArrayBhiksha>, SortedVocabulary> ArrayTrieModel;
+typedef detail::GenericModel<trie::TrieSearch<DontQuantize, trie::EliasFanoBhiksha>, SortedVocabulary> EliasFanoTrieModel; // ELIAS_FANO_TRIE_SORTED
 
 typedef detail::GenericModel<trie::TrieSearch<SeparatelyQuantize, trie::DontBhiksha>, SortedVocabulary> QuantTrieModel; // QUANT_TRIE_SORTED
 typedef detail::GenericModel<trie::TrieSearch<SeparatelyQuantize, trie::ArrayBhiksha>, SortedVocabulary> QuantArrayTrieModel;
+typedef detail::GenericModel<trie::TrieSearch<SeparatelyQuantize, trie::EliasFanoBhiksha>, SortedVocabulary> QuantEliasFanoTrieModel; // QUANT_ELIAS_FANO_TRIE_SORTED
 
 } // namespace ngram
 } // namespace lm
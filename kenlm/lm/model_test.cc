@@ -337,6 +337,47 @@ BOOST_AUTO_TEST_CASE(bhiksha_trie) {
 BOOST_AUTO_TEST_CASE(quant_bhiksha_trie) {
   LoadingTest<QuantArrayTrieModel>();
 }
+BOOST_AUTO_TEST_CASE(elias_fano_trie) {
+  LoadingTest<EliasFanoTrieModel>();
+}
+BOOST_AUTO_TEST_CASE(quant_elias_fano_trie) {
+  LoadingTest<QuantEliasFanoTrieModel>();
+}
+
+BOOST_AUTO_TEST_CASE(trie_threads) {
+  Config config;
+  config.arpa_complain = Config::NONE;
+  config.messages = NULL;
+  config.building_threads = 3;
+  TrieModel m("test.arpa", config);
+  Everything(m);
+}
+
+BOOST_AUTO_TEST_CASE(arpa_threads) {
+  Config config;
+  config.arpa_complain = Config::NONE;
+  config.messages = NULL;
+  config.arpa_threads = 3;
+  {
+    Model m("test.arpa", config);
+    Everything(m);
+  }
+  {
+    TrieModel m("test.arpa", config);
+    Everything(m);
+  }
+}
+
+// test_truncated.arpa has fewer bigrams than its header says.
+BOOST_AUTO_TEST_CASE(arpa_threads_truncated) {
+  Config config;
+  config.arpa_complain = Config::NONE;
+  config.messages = NULL;
+  for (config.arpa_threads = 1; config.arpa_threads <= 3; config.arpa_threads += 2) {
+    BOOST_CHECK_THROW(Model m("test_truncated.arpa", config), util::EndOfFileException);
+    BOOST_CHECK_THROW(TrieModel m("test_truncated.arpa", config), util::EndOfFileException);
+  }
+}
 
 template <class ModelT> void BinaryTest() {
   Config config;
@@ -399,6 +440,34 @@ BOOST_AUTO_TEST_CASE(write_and_read_array_trie) {
 BOOST_AUTO_TEST_CASE(write_and_read_quant_array_trie) {
   BinaryTest<QuantArrayTrieModel>();
 }
+BOOST_AUTO_TEST_CASE(write_and_read_elias_fano_trie) {
+  BinaryTest<EliasFanoTrieModel>();
+}
+BOOST_AUTO_TEST_CASE(write_and_read_quant_elias_fano_trie) {
+  BinaryTest<QuantEliasFanoTrieModel>();
+}
+
+BOOST_AUTO_TEST_CASE(shared_memory) {
+  Config config;
+  config.write_mmap = "test.binary";
+  config.messages = NULL;
+  {
+    TrieModel copy_model("test.arpa", config);
+  }
+  config.write_mmap = NULL;
+  config.shared_memory_name = "/kenlm_model_test";
+  config.load_method = util::HUGE_READ;
+  shm_unlink(config.shared_memory_name);
+  {
+    // The first loads the segment and the second attaches to it.
+    TrieModel loaded("test.binary", config);
+    TrieModel attached("test.binary", config);
+    Everything(loaded);
+    Everything(attached);
+  }
+  shm_unlink(config.shared_memory_name);
+  unlink("test.binary");
+}
 
 } // namespace
 } // namespace ngram
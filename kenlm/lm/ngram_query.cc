@@ -1,17 +1,50 @@
 #include "lm/enumerate_vocab.hh"
 #include "lm/model.hh"
 
+#include <algorithm>
 #include <cstdlib>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include <ctype.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/thread/thread.hpp>
+#endif
 
 #include "util/portability.hh"
 
 float FloatSec(const struct timeval &tv) {
-  return static_cast<float>(tv.tv_sec) + (static_cast<float>(tv.tv_usec) / 1000000000.0);
+  return static_cast<float>(tv.tv_sec) + (static_cast<float>(tv.tv_usec) / 1000000.0);
+}
+
+double WallSec() {
+#ifdef WIN32
+  return 0.0;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return static_cast<double>(tv.tv_sec) + (static_cast<double>(tv.tv_usec) / 1000000.0);
+#endif
+}
+
+// Nanoseconds on a monotonic clock, fine enough to time one sentence.  
+uint64_t NanoSec() {
+#ifdef WIN32
+  return 0;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+#endif
 }
 
 void PrintUsage(const char *message) {
@@ -38,7 +71,6 @@ void PrintUsage(const char *message) {
 }
 
 template <class Model> void Query(const Model &model, bool sentence_context) {
-  PrintUsage("Loading statistics:\n");
   typename Model::State state, out;
   lm::FullScoreReturn ret;
   std::string word;
@@ -79,44 +111,191 @@ template <class Model> void Query(const Model &model, bool sentence_context) {
   PrintUsage("After queries:\n");
 }
 
-template <class Model> void Query(const char *name) {
-  lm::ngram::Config config;
+// Scores every stride-th sentence starting with offset, timing each one.  
+template <class Model> void BenchmarkThread(const Model &model, const std::vector<std::vector<lm::WordIndex> > &corpus, bool sentence_context, std::size_t offset, std::size_t stride, std::vector<uint64_t> *latencies, double *total) {
+  typename Model::State state, out;
+  double sum = 0.0;
+  // Kept local until the end because the threads' vectors share cache lines.  
+  std::vector<uint64_t> times;
+  times.reserve(corpus.size() / stride + 1);
+  for (std::size_t i = offset; i < corpus.size(); i += stride) {
+    uint64_t start = NanoSec();
+    state = sentence_context ? model.BeginSentenceState() : model.NullContextState();
+    for (std::vector<lm::WordIndex>::const_iterator word = corpus[i].begin(); word != corpus[i].end(); ++word) {
+      sum += model.FullScore(state, *word, out).prob;
+      state = out;
+    }
+    times.push_back(NanoSec() - start);
+  }
+  latencies->swap(times);
+  *total = sum;
+}
+
+// Value below which fraction of the sorted values lie.  
+double Percentile(const std::vector<uint64_t> &sorted, double fraction) {
+  if (sorted.empty()) return 0.0;
+  std::size_t index = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size()));
+  return static_cast<double>(sorted[std::min(index, sorted.size() - 1)]);
+}
+
+/* Loads all of stdin as vocabulary ids, then scores it with threads threads
+ * and reports throughput, per-sentence latency, page faults and memory.  
+ * Vocabulary lookup is not timed, as a decoder does it once per word type.  
+ */
+template <class Model> void Benchmark(const Model &model, bool sentence_context, std::size_t threads) {
+  std::vector<std::vector<lm::WordIndex> > corpus;
+  std::size_t queries = 0;
+  std::string line, word;
+  while (getline(std::cin, line)) {
+    corpus.resize(corpus.size() + 1);
+    std::istringstream words(line);
+    while (words >> word) corpus.back().push_back(model.GetVocabulary().Index(word));
+    if (sentence_context) corpus.back().push_back(model.GetVocabulary().EndSentence());
+    queries += corpus.back().size();
+  }
+
+#ifndef WITH_THREADS
+  if (threads > 1) {
+    std::cerr << "Compiled without WITH_THREADS so benchmarking with 1 thread." << std::endl;
+    threads = 1;
+  }
+#endif
+  std::vector<std::vector<uint64_t> > latencies(threads);
+  std::vector<double> totals(threads);
+
+#ifndef WIN32
+  struct rusage before, after;
+  getrusage(RUSAGE_SELF, &before);
+#endif
+  double start = WallSec();
+#ifdef WITH_THREADS
+  boost::thread_group workers;
+  for (std::size_t i = 1; i < threads; ++i) {
+    workers.create_thread(boost::bind(&BenchmarkThread<Model>, boost::cref(model), boost::cref(corpus), sentence_context, i, threads, &latencies[i], &totals[i]));
+  }
+#endif
+  BenchmarkThread(model, corpus, sentence_context, 0, threads, &latencies[0], &totals[0]);
+#ifdef WITH_THREADS
+  workers.join_all();
+#endif
+  double wall = WallSec() - start;
+#ifndef WIN32
+  getrusage(RUSAGE_SELF, &after);
+#endif
+
+  std::vector<uint64_t> all;
+  double total = 0.0;
+  for (std::size_t i = 0; i < threads; ++i) {
+    all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+    total += totals[i];
+  }
+  std::sort(all.begin(), all.end());
+
+  std::cout << "Sentences: " << corpus.size() << " Queries: " << queries << " Threads: " << threads << '\n'
+    << "Total: " << total << '\n'
+    << "Wall: " << wall << " seconds\n"
+    << "Queries/sec: " << (wall > 0.0 ? static_cast<double>(queries) / wall : 0.0) << '\n'
+    << "Sentence latency p50: " << (Percentile(all, 0.5) / 1000.0) << " us p99: " << (Percentile(all, 0.99) / 1000.0) << " us\n";
+#ifndef WIN32
+  std::cout << "Page faults minor: " << (after.ru_minflt - before.ru_minflt) << " major: " << (after.ru_majflt - before.ru_majflt) << '\n';
+#endif
+  PrintUsage("After benchmark:\n");
+}
+
+template <class Model> void Query(const char *name, const lm::ngram::Config &config, bool sentence_context, std::size_t bench_threads) {
+  double start = WallSec();
   Model model(name, config);
-  Query(model);
+  std::cerr << "Loading took " << (WallSec() - start) << " seconds\n";
+  PrintUsage("Loading statistics:\n");
+  if (bench_threads) {
+    Benchmark(model, sentence_context, bench_threads);
+  } else {
+    Query(model, sentence_context);
+  }
+}
+
+void Usage(const char *name) {
+  std::cerr << "Usage: " << name << " [-l lazy|populate|read|huge] [-s shared_memory_name] [-b threads] lm_file [null]\n"
+"Input is wrapped in <s> and </s> unless null is passed.\n"
+"-l sets how a binary file is loaded.  Default is populate.  huge reads it into\n"
+"   memory on huge pages.\n"
+"-s shares one copy of a binary file between processes through the named\n"
+"   shared memory segment (e.g. /lm).  The first process loads it and the rest\n"
+"   attach.  Remove the segment (rm /dev/shm/lm on Linux) to free it.\n"
+"-b benchmarks instead of printing scores.  All of the input is loaded into\n"
+"   memory then scored by the given number of threads.  Reports queries per\n"
+"   second, sentence latency percentiles, page faults, and memory.\n";
+  exit(1);
+}
+
+util::LoadMethod ParseLoadMethod(const char *name, const char *from) {
+  if (!strcmp(from, "lazy")) return util::LAZY;
+  if (!strcmp(from, "populate")) return util::POPULATE_OR_READ;
+  if (!strcmp(from, "read")) return util::READ;
+  if (!strcmp(from, "huge")) return util::HUGE_READ;
+  Usage(name);
+  return util::LAZY;
 }
 
 int main(int argc, char *argv[]) {
-  if (!(argc == 2 || (argc == 3 && !strcmp(argv[2], "null")))) {
-    std::cerr << "Usage: " << argv[0] << " lm_file [null]" << std::endl;
-    std::cerr << "Input is wrapped in <s> and </s> unless null is passed." << std::endl;
-    return 1;
-  }
-  bool sentence_context = (argc == 2);
-  lm::ngram::ModelType model_type;
-  if (lm::ngram::RecognizeBinary(argv[1], model_type)) {
-    switch(model_type) {
-      case lm::ngram::HASH_PROBING:
-        Query<lm::ngram::ProbingModel>(argv[1], sentence_context);
-        break;
-      case lm::ngram::TRIE_SORTED:
-        Query<lm::ngram::TrieModel>(argv[1], sentence_context);
-        break;
-      case lm::ngram::QUANT_TRIE_SORTED:
-        Query<lm::ngram::QuantTrieModel>(argv[1], sentence_context);
+  lm::ngram::Config config;
+  std::size_t bench_threads = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "l:s:b:")) != -1) {
+    switch (opt) {
+      case 'l':
+        config.load_method = ParseLoadMethod(argv[0], optarg);
         break;
-      case lm::ngram::ARRAY_TRIE_SORTED:
-        Query<lm::ngram::ArrayTrieModel>(argv[1], sentence_context);
+      case 's':
+        config.shared_memory_name = optarg;
         break;
-      case lm::ngram::QUANT_ARRAY_TRIE_SORTED:
-        Query<lm::ngram::QuantArrayTrieModel>(argv[1], sentence_context);
+      case 'b':
+        bench_threads = strtoul(optarg, NULL, 10);
+        if (!bench_threads) Usage(argv[0]);
         break;
-      case lm::ngram::HASH_SORTED:
       default:
-        std::cerr << "Unrecognized kenlm model type " << model_type << std::endl;
-        abort();
+        Usage(argv[0]);
     }
-  } else {
-    Query<lm::ngram::ProbingModel>(argv[1], sentence_context);
+  }
+  if (!(optind + 1 == argc || (optind + 2 == argc && !strcmp(argv[optind + 1], "null")))) Usage(argv[0]);
+  const char *file = argv[optind];
+  bool sentence_context = (optind + 1 == argc);
+  lm::ngram::ModelType model_type;
+  try {
+    if (lm::ngram::RecognizeBinary(file, model_type)) {
+      switch(model_type) {
+        case lm::ngram::HASH_PROBING:
+          Query<lm::ngram::ProbingModel>(file, config, sentence_context, bench_threads);
+          break;
+        case lm::ngram::TRIE_SORTED:
+          Query<lm::ngram::TrieModel>(file, config, sentence_context, bench_threads);
+          break;
+        case lm::ngram::QUANT_TRIE_SORTED:
+          Query<lm::ngram::QuantTrieModel>(file, config, sentence_context, bench_threads);
+          break;
+        case lm::ngram::ARRAY_TRIE_SORTED:
+          Query<lm::ngram::ArrayTrieModel>(file, config, sentence_context, bench_threads);
+          break;
+        case lm::ngram::QUANT_ARRAY_TRIE_SORTED:
+          Query<lm::ngram::QuantArrayTrieModel>(file, config, sentence_context, bench_threads);
+          break;
+        case lm::ngram::ELIAS_FANO_TRIE_SORTED:
+          Query<lm::ngram::EliasFanoTrieModel>(file, config, sentence_context, bench_threads);
+          break;
+        case lm::ngram::QUANT_ELIAS_FANO_TRIE_SORTED:
+          Query<lm::ngram::QuantEliasFanoTrieModel>(file, config, sentence_context, bench_threads);
+          break;
+        case lm::ngram::HASH_SORTED:
+        default:
+          std::cerr << "Unrecognized kenlm model type " << model_type << std::endl;
+          abort();
+      }
+    } else {
+      Query<lm::ngram::ProbingModel>(file, config, sentence_context, bench_threads);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
   }
 
   PrintUsage("Total time including destruction:\n");
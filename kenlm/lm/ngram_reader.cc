@@ -0,0 +1,328 @@
+#include "lm/ngram_reader.hh"
+
+#include "lm/blank.hh"
+#include "lm/lm_exception.hh"
+#include "lm/vocab.hh"
+#include "lm/weights.hh"
+#include "util/file_piece.hh"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+#endif
+
+namespace lm {
+namespace {
+
+#ifdef WITH_THREADS
+// Most lines handed to a thread at once.
+const std::size_t kChunkLines = 8192;
+
+bool IsEntirelyWhiteSpace(const StringPiece &line) {
+  for (size_t i = 0; i < static_cast<size_t>(line.size()); ++i) {
+    if (!isspace(line.data()[i])) return false;
+  }
+  return true;
+}
+
+float ParseFloat(const char *&from) {
+  char *end;
+#ifdef sun
+  float ret = static_cast<float>(strtod(from, &end));
+#else
+  float ret = strtof(from, &end);
+#endif
+  if (end == from) {
+    const char *token = from;
+    while (*token && isspace(*token)) ++token;
+    const char *token_end = token;
+    while (*token_end && !isspace(*token_end)) ++token_end;
+    throw util::ParseNumberException(StringPiece(token, token_end - token));
+  }
+  from = end;
+  return ret;
+}
+
+// Same checks as ReadBackoff.  Lines end with '\0' where the file has '\n'.
+void ParseBackoff(const char *&from, Prob &/*weights*/) {
+  switch (*from) {
+    case '\t':
+      {
+        ++from;
+        float got = ParseFloat(from);
+        if (got != 0.0)
+          UTIL_THROW(FormatLoadException, "Non-zero backoff " << got << " provided for an n-gram that should have no backoff");
+      }
+      break;
+    case '\0':
+      break;
+    default:
+      UTIL_THROW(FormatLoadException, "Expected tab or newline for backoff");
+  }
+}
+
+void ParseBackoff(const char *&from, ProbBackoff &weights) {
+  switch (*from) {
+    case '\t':
+      ++from;
+      weights.backoff = ParseFloat(from);
+      if (weights.backoff == ngram::kExtensionBackoff) weights.backoff = ngram::kNoExtensionBackoff;
+      if (*from != '\0') UTIL_THROW(FormatLoadException, "Expected newline after backoff");
+      break;
+    case '\0':
+      weights.backoff = ngram::kNoExtensionBackoff;
+      break;
+    default:
+      UTIL_THROW(FormatLoadException, "Expected tab or newline for backoff");
+  }
+}
+
+// ReadNGram on a line in memory, except that a positive probability is left for the caller to warn about.
+template <class Voc, class Weights> void ParseNGram(const char *line, const unsigned char n, const Voc &vocab, WordIndex *const reverse_indices, Weights &weights) {
+  const char *from = line;
+  weights.prob = ParseFloat(from);
+  for (WordIndex *vocab_out = reverse_indices + n - 1; vocab_out >= reverse_indices; --vocab_out) {
+    while (kARPASpaces[static_cast<unsigned char>(*from)]) ++from;
+    const char *word = from;
+    while (*from && !kARPASpaces[static_cast<unsigned char>(*from)]) ++from;
+    *vocab_out = vocab.Index(StringPiece(word, from - word));
+  }
+  ParseBackoff(from, weights);
+}
+
+template <class Except> void Rethrow(const Except &e) {
+  throw e;
+}
+#endif // WITH_THREADS
+
+} // namespace
+
+#ifdef WITH_THREADS
+/* The chunks form a ring.  The reading thread fills every chunk with lines
+ * and queues it for parsing.  It then takes the n-grams out of the chunks in
+ * ring order, waiting for each to be parsed, and refills a chunk as soon as
+ * it is used up.
+ *
+ * Lines are copied out of the file piece instead of being handed out as
+ * pieces of the input: the file piece only maps a window of the file (and
+ * reads gzipped or piped input into a buffer), which moves while the workers
+ * still parse earlier chunks.
+ *
+ * An error reading the file, like a section shorter than its count, is kept
+ * in the chunk after the lines read before it, so errors come out in file
+ * order as they do when reading in one thread.
+ */
+template <class Voc, class Weights> class NGramReader<Voc, Weights>::Parallel {
+  public:
+    Parallel(util::FilePiece &f, unsigned char n, std::size_t count, const Voc &vocab, std::size_t threads)
+      : f_(f), n_(n), vocab_(vocab), remaining_(count), chunks_(2 * threads),
+        // Smaller sections are spread over all the chunks.
+        chunk_lines_(std::min(kChunkLines, (count + chunks_.size() - 1) / chunks_.size())),
+        current_(0), position_(0), stop_(false) {
+      // Fill first so that nothing is left to stop if filling throws.
+      for (typename std::vector<Chunk>::iterator i = chunks_.begin(); i != chunks_.end(); ++i) {
+        Fill(*i);
+      }
+      for (std::size_t i = 1; i < threads; ++i) {
+        workers_.create_thread(boost::bind(&Parallel::Work, this));
+      }
+    }
+
+    ~Parallel() {
+      {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        stop_ = true;
+        cond_.notify_all();
+      }
+      workers_.join_all();
+    }
+
+    // Returns the offset of the line in the file.
+    off_t Read(WordIndex *reverse_indices, Weights &weights) {
+      Chunk &chunk = chunks_[current_];
+      if (position_ == 0) {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        while (chunk.state != Chunk::PARSED) cond_.wait(lock);
+      }
+      if (chunk.error && position_ == chunk.error_line) chunk.error();
+      std::copy(&chunk.words[position_ * n_], &chunk.words[position_ * n_] + n_, reverse_indices);
+      weights = chunk.weights[position_];
+      off_t offset = chunk.offsets[position_];
+      // A chunk with an error after its last line is not refilled, so the next call throws it.
+      if (++position_ == chunk.lines && !chunk.error) {
+        Fill(chunk);
+        current_ = (current_ + 1) % chunks_.size();
+        position_ = 0;
+      }
+      return offset;
+    }
+
+  private:
+    struct Chunk {
+      Chunk() : lines(0), error_line(0), state(EMPTY) {}
+
+      // Lines, each followed by '\0' instead of '\n'.
+      std::string text;
+      // Where each line starts in the file.
+      std::vector<off_t> offsets;
+      std::size_t lines;
+
+      // Parsed n-grams: n words per line in reverse order and the weights.
+      std::vector<WordIndex> words;
+      std::vector<Weights> weights;
+
+      // Rethrows the exception that the line at error_line threw, if any.  Lines after it are not parsed.
+      // error_line is lines if reading the file failed after the last line.
+      std::size_t error_line;
+      boost::function<void()> error;
+
+      enum State {EMPTY, FILLED, PARSED} state;
+    };
+
+    void Fill(Chunk &chunk) {
+      chunk.text.clear();
+      chunk.offsets.clear();
+      chunk.lines = 0;
+      chunk.error.clear();
+      while (chunk.lines < chunk_lines_ && remaining_) {
+        off_t offset = f_.Offset();
+        StringPiece line;
+        try {
+          line = f_.ReadLine();
+        } catch (util::Exception &e) {
+          e << " in the " << static_cast<unsigned int>(n_) << "-gram at byte " << offset;
+          SetError(chunk, chunk.lines, e);
+          remaining_ = 0;
+          break;
+        }
+        // ReadNGram skips blank lines as spaces before the probability.
+        if (IsEntirelyWhiteSpace(line)) continue;
+        chunk.text.append(line.data(), line.size());
+        chunk.text.push_back('\0');
+        chunk.offsets.push_back(offset);
+        ++chunk.lines;
+        --remaining_;
+      }
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      if (chunk.lines || chunk.error) {
+        chunk.state = Chunk::FILLED;
+        queue_.push_back(&chunk);
+        cond_.notify_all();
+      } else {
+        chunk.state = Chunk::EMPTY;
+      }
+    }
+
+    static void SetError(Chunk &chunk, std::size_t line, util::Exception &e) {
+      chunk.error_line = line;
+      if (FormatLoadException *format = dynamic_cast<FormatLoadException*>(&e)) {
+        chunk.error = boost::bind(&Rethrow<FormatLoadException>, *format);
+      } else if (util::ParseNumberException *number = dynamic_cast<util::ParseNumberException*>(&e)) {
+        chunk.error = boost::bind(&Rethrow<util::ParseNumberException>, *number);
+      } else if (util::EndOfFileException *end = dynamic_cast<util::EndOfFileException*>(&e)) {
+        chunk.error = boost::bind(&Rethrow<util::EndOfFileException>, *end);
+      } else {
+        chunk.error = boost::bind(&Rethrow<util::Exception>, e);
+      }
+    }
+
+    void Parse(Chunk &chunk) {
+      chunk.words.resize(chunk.lines * n_);
+      chunk.weights.resize(chunk.lines);
+      const char *line = chunk.text.data();
+      for (std::size_t i = 0; i < chunk.lines; ++i, line += strlen(line) + 1) {
+        try {
+          ParseNGram(line, n_, vocab_, &chunk.words[i * n_], chunk.weights[i]);
+        } catch (util::Exception &e) {
+          e << " in the " << static_cast<unsigned int>(n_) << "-gram at byte " << chunk.offsets[i];
+          SetError(chunk, i, e);
+          return;
+        }
+      }
+    }
+
+    void Work() {
+      while (true) {
+        Chunk *chunk;
+        {
+          boost::unique_lock<boost::mutex> lock(mutex_);
+          while (queue_.empty() && !stop_) cond_.wait(lock);
+          if (stop_) return;
+          chunk = queue_.front();
+          queue_.pop_front();
+        }
+        Parse(*chunk);
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        chunk->state = Chunk::PARSED;
+        cond_.notify_all();
+      }
+    }
+
+    util::FilePiece &f_;
+    const unsigned char n_;
+    const Voc &vocab_;
+    std::size_t remaining_;
+
+    std::vector<Chunk> chunks_;
+    const std::size_t chunk_lines_;
+    // Chunk and line in it that Read returns next.
+    std::size_t current_, position_;
+
+    boost::mutex mutex_;
+    boost::condition_variable cond_;
+    std::deque<Chunk*> queue_;
+    bool stop_;
+    boost::thread_group workers_;
+};
+#else
+template <class Voc, class Weights> class NGramReader<Voc, Weights>::Parallel {
+  public:
+    off_t Read(WordIndex *, Weights &) { return 0; }
+};
+#endif // WITH_THREADS
+
+template <class Voc, class Weights> NGramReader<Voc, Weights>::NGramReader(util::FilePiece &f, unsigned char n, std::size_t count, const Voc &vocab, PositiveProbWarn &warn, std::size_t threads)
+  : f_(f), n_(n), vocab_(vocab), warn_(warn), parallel_(NULL), last_offset_(0) {
+  // Without WITH_THREADS, everything is read in the calling thread like trie building does.
+  if (threads > 1 && count) {
+#ifdef WITH_THREADS
+    parallel_ = new Parallel(f, n, count, vocab, threads);
+#endif
+  }
+}
+
+template <class Voc, class Weights> NGramReader<Voc, Weights>::~NGramReader() {
+  delete parallel_;
+}
+
+template <class Voc, class Weights> void NGramReader<Voc, Weights>::ReadParallel(WordIndex *reverse_indices, Weights &weights) {
+  last_offset_ = parallel_->Read(reverse_indices, weights);
+  if (weights.prob > 0.0) {
+    try {
+      warn_.Warn(weights.prob);
+    } catch(util::Exception &e) {
+      e << " in the " << static_cast<unsigned int>(n_) << "-gram at byte " << last_offset_;
+      throw;
+    }
+    weights.prob = 0.0;
+  }
+}
+
+template class NGramReader<ngram::ProbingVocabulary, Prob>;
+template class NGramReader<ngram::ProbingVocabulary, ProbBackoff>;
+template class NGramReader<ngram::SortedVocabulary, Prob>;
+template class NGramReader<ngram::SortedVocabulary, ProbBackoff>;
+
+} // namespace lm
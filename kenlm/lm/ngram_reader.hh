@@ -0,0 +1,60 @@
+#ifndef LM_NGRAM_READER__
+#define LM_NGRAM_READER__
+
+#include "lm/read_arpa.hh"
+#include "lm/word_index.hh"
+
+#include <cstddef>
+
+namespace lm {
+
+/* Reads the n-grams of one order from an ARPA file, like calling ReadNGram
+ * count times.  With more than one thread, the reading thread only cuts the
+ * file into chunks of lines.  The other threads parse the numbers and look up
+ * the words.  N-grams still come out in file order and positive log
+ * probabilities are passed to warn in that order, so callers that insert what
+ * they read build the same model with any number of threads.
+ */
+template <class Voc, class Weights> class NGramReader {
+  public:
+    // Call after ReadNGramHeader.  The vocabulary must not change while reading.
+    NGramReader(util::FilePiece &f, unsigned char n, std::size_t count, const Voc &vocab, PositiveProbWarn &warn, std::size_t threads);
+
+    ~NGramReader();
+
+    void Read(WordIndex *reverse_indices, Weights &weights) {
+      if (parallel_) {
+        ReadParallel(reverse_indices, weights);
+      } else {
+        ReadNGram(f_, n_, vocab_, reverse_indices, weights, warn_);
+      }
+    }
+
+    // Byte offset to report for an error in the n-gram last read.  With more
+    // than one thread the file piece has been read ahead, so this is where
+    // the line of that n-gram starts.
+    off_t Offset() const {
+      return parallel_ ? last_offset_ : f_.Offset();
+    }
+
+  private:
+    void ReadParallel(WordIndex *reverse_indices, Weights &weights);
+
+    util::FilePiece &f_;
+    const unsigned char n_;
+    const Voc &vocab_;
+    PositiveProbWarn &warn_;
+
+    class Parallel;
+    Parallel *parallel_;
+
+    off_t last_offset_;
+
+    // Ersatz boost::noncopyable.
+    NGramReader(const NGramReader &);
+    NGramReader &operator=(const NGramReader &);
+};
+
+} // namespace lm
+
+#endif // LM_NGRAM_READER__
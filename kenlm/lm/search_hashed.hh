@@ -145,6 +145,22 @@ template <class MiddleT, class LongestT> class TemplateHashedSearch : public Has
       return true;
     }
 
+    // Start loading the entries that scoring new_word after the context will
+    // look up.  The keys are hashes of the words, so all can load at once.
+    void Prefetch(const WordIndex *context_rbegin, const WordIndex *context_rend, const WordIndex new_word) const {
+      UTIL_PREFETCH(&unigram.Lookup(new_word));
+      Node node = static_cast<Node>(new_word);
+      const Middle *mid_iter = MiddleBegin();
+      for (const WordIndex *hist_iter = context_rbegin; hist_iter != context_rend; ++hist_iter, ++mid_iter) {
+        node = CombineWordHash(node, *hist_iter);
+        if (mid_iter == MiddleEnd()) {
+          longest.Prefetch(node);
+          return;
+        }
+        mid_iter->Prefetch(node);
+      }
+    }
+
     // Geenrate a node without necessarily checking that it actually exists.  
     // Optionally return false if it's know to not exist.  
     bool FastMakeNode(const WordIndex *begin, const WordIndex *end, Node &node) const {
@@ -626,6 +626,8 @@ template class TrieSearch<DontQuantize, DontBhiksha>;
 template class TrieSearch<DontQuantize, ArrayBhiksha>;
 template class TrieSearch<SeparatelyQuantize, DontBhiksha>;
 template class TrieSearch<SeparatelyQuantize, ArrayBhiksha>;
+template class TrieSearch<DontQuantize, EliasFanoBhiksha>;
+template class TrieSearch<SeparatelyQuantize, EliasFanoBhiksha>;
 
 } // namespace trie
 } // namespace ngram
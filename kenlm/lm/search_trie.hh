@@ -72,6 +72,11 @@ template <class Quant, class Bhiksha> class TrieSearch {
       ret.extend_left = static_cast<uint64_t>(word);
     }
 
+    // Only the unigram can be found without following pointers, so start loading that.
+    void Prefetch(const WordIndex * /*context_rbegin*/, const WordIndex * /*context_rend*/, const WordIndex new_word) const {
+      UTIL_PREFETCH(&unigram.Lookup(new_word));
+    }
+
     bool LookupMiddle(const Middle &mid, WordIndex word, float &backoff, Node &node, FullScoreReturn &ret) const {
       if (!mid.Find(word, ret.prob, backoff, node, ret.extend_left)) return false;
       ret.independent_left = (node.begin == node.end);
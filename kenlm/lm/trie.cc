@@ -141,6 +141,8 @@ template class BitPackedMiddle<DontQuantize::Middle, DontBhiksha>;
 template class BitPackedMiddle<DontQuantize::Middle, ArrayBhiksha>;
 template class BitPackedMiddle<SeparatelyQuantize::Middle, DontBhiksha>;
 template class BitPackedMiddle<SeparatelyQuantize::Middle, ArrayBhiksha>;
+template class BitPackedMiddle<DontQuantize::Middle, EliasFanoBhiksha>;
+template class BitPackedMiddle<SeparatelyQuantize::Middle, EliasFanoBhiksha>;
 template class BitPackedLongest<DontQuantize::Longest>;
 template class BitPackedLongest<SeparatelyQuantize::Longest>;
 
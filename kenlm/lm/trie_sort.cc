@@ -2,6 +2,7 @@
 
 #include "lm/config.hh"
 #include "lm/lm_exception.hh"
+#include "lm/ngram_reader.hh"
 #include "lm/read_arpa.hh"
 #include "lm/vocab.hh"
 #include "lm/weights.hh"
@@ -16,8 +17,17 @@
 #include <cstdio>
 #include <deque>
 #include <limits>
+#include <new>
 #include <vector>
 
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
 namespace lm {
 namespace ngram {
 namespace trie {
@@ -78,13 +88,16 @@ class PartialViewProxy {
 
 typedef util::ProxyIterator<PartialViewProxy> PartialIter;
 
-std::string DiskFlush(const void *mem_begin, const void *mem_end, const std::string &file_prefix, std::size_t batch, unsigned char order) {
+// Temporary file names: batches are <prefix><order>_<batch>, merges <prefix><order>_merge_<count>.  
+std::string TemporaryName(const std::string &file_prefix, unsigned char order, const char *kind, std::size_t number) {
   std::stringstream assembled;
-  assembled << file_prefix << static_cast<unsigned int>(order) << '_' << batch;
-  std::string ret(assembled.str());
-  util::scoped_fd out(util::CreateOrThrow(ret.c_str()));
+  assembled << file_prefix << static_cast<unsigned int>(order) << kind << number;
+  return assembled.str();
+}
+
+void DiskFlush(const void *mem_begin, const void *mem_end, const std::string &name) {
+  util::scoped_fd out(util::CreateOrThrow(name.c_str()));
   util::WriteOrThrow(out.get(), mem_begin, (uint8_t*)mem_end - (uint8_t*)mem_begin);
-  return ret;
 }
 
 void WriteContextFile(uint8_t *begin, uint8_t *end, const std::string &ngram_file_name, std::size_t entry_size, unsigned char order) {
@@ -151,59 +164,257 @@ template <class Combine> void MergeSortedFiles(const std::string &first_name, co
   }
 }
 
-void ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, util::scoped_memory &mem, const std::string &file_prefix, unsigned char order, PositiveProbWarn &warn) {
+// Sort full records by full n-gram, write them to name and the unique contexts to name + kContextSuffix.  
+void SortBatch(uint8_t *begin, uint8_t *end, const std::string &name, std::size_t entry_size, unsigned char order) {
+  util::SizedProxy proxy_begin(begin, entry_size), proxy_end(end, entry_size);
+  // parallel_sort uses too much RAM
+  std::sort(NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(order)));
+  DiskFlush(begin, end, name);
+  WriteContextFile(begin, end, name, entry_size, order);
+}
+
+// Merge sorted files pairwise until one is left, then rename it to <prefix><order>_merged.  Names are given without suffix.  
+template <class Combine> void MergeAll(std::deque<std::string> files, const std::string &file_prefix, const char *suffix, std::size_t weights_size, unsigned char file_order, unsigned char order, const Combine &combine) {
+  std::size_t merge_count = 0;
+  while (files.size() > 1) {
+    files.push_back(TemporaryName(file_prefix, file_order, "_merge_", merge_count++));
+    MergeSortedFiles(files[0] + suffix, files[1] + suffix, files.back() + suffix, weights_size, order, combine);
+    files.pop_front();
+    files.pop_front();
+  }
+  if (!files.empty()) {
+    std::stringstream assembled;
+    assembled << file_prefix << static_cast<unsigned int>(file_order) << "_merged" << suffix;
+    std::string merged_name(assembled.str());
+    std::string name(files[0] + suffix);
+    if (std::rename(name.c_str(), merged_name.c_str())) UTIL_THROW(util::ErrnoException, "Could not rename " << name << " to " << merged_name);
+  }
+}
+
+void MergeBatches(const std::deque<std::string> &files, const std::string &file_prefix, std::size_t weights_size, unsigned char order) {
+  MergeAll(files, file_prefix, "", weights_size, order, order, ThrowCombine());
+}
+
+void MergeContexts(const std::deque<std::string> &files, const std::string &file_prefix, unsigned char order) {
+  MergeAll(files, file_prefix, kContextSuffix, 0, order, order - 1, FirstCombine());
+}
+
+#ifdef WITH_THREADS
+template <class Except> void Rethrow(const Except &e) {
+  throw e;
+}
+#endif
+
+/* Sorts batches and merges them, in the background if there is more than one
+ * thread.  The sort buffer is split into one block per thread.  The reading
+ * thread fills a free block while the other threads sort the blocks read
+ * before, then merge the files of each order while the next order is read.  
+ * Merging happens in the same order as with one thread, so the files are the
+ * same.  
+ */
+class SortJobs {
+  public:
+    SortJobs(void *mem, std::size_t size, std::size_t threads)
+      : block_size_(size / threads)
+#ifdef WITH_THREADS
+      , running_(0), stop_(false)
+#endif
+    {
+      for (std::size_t i = 0; i < threads; ++i) {
+        free_.push_back(static_cast<uint8_t*>(mem) + i * block_size_);
+      }
+#ifdef WITH_THREADS
+      for (std::size_t i = 1; i < threads; ++i) {
+        workers_.create_thread(boost::bind(&SortJobs::Work, this));
+      }
+#endif
+    }
+
+    ~SortJobs() {
+#ifdef WITH_THREADS
+      {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        sorts_.clear();
+        merges_.clear();
+        stop_ = true;
+        cond_.notify_all();
+      }
+      workers_.join_all();
+#endif
+    }
+
+    std::size_t BlockSize() const { return block_size_; }
+
+    // Memory of BlockSize() bytes to read a batch into.  Waits for a sort to finish if all are in use.  
+    uint8_t *GetBlock() {
+#ifdef WITH_THREADS
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (free_.empty() && error_.empty()) cond_.wait(lock);
+      if (!error_.empty()) error_();
+#endif
+      uint8_t *ret = free_.back();
+      free_.pop_back();
+      return ret;
+    }
+
+    // Sort and write the batch in [begin, end), then give the block back.  
+    void Sort(uint8_t *begin, uint8_t *end, const std::string &name, std::size_t entry_size, unsigned char order) {
+#ifdef WITH_THREADS
+      if (workers_.size()) {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        if (pending_.size() <= order) pending_.resize(order + 1, 0);
+        ++pending_[order];
+        sorts_.push_back(boost::bind(&SortJobs::SortInBackground, this, begin, end, name, entry_size, order));
+        cond_.notify_all();
+        return;
+      }
+#endif
+      SortBatch(begin, end, name, entry_size, order);
+      free_.push_back(begin);
+    }
+
+    // Merge the sorted batches of an order once all of them have been written.  
+    void Merge(const std::deque<std::string> &files, const std::string &file_prefix, std::size_t weights_size, unsigned char order) {
+#ifdef WITH_THREADS
+      if (workers_.size()) {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        merges_.push_back(boost::bind(&SortJobs::MergeInBackground, this, files, file_prefix, weights_size, order, false));
+        merges_.push_back(boost::bind(&SortJobs::MergeInBackground, this, files, file_prefix, weights_size, order, true));
+        cond_.notify_all();
+        return;
+      }
+#endif
+      MergeBatches(files, file_prefix, weights_size, order);
+      MergeContexts(files, file_prefix, order);
+    }
+
+    // Wait for all jobs and rethrow the first exception one of them threw.  
+    void Join() {
+#ifdef WITH_THREADS
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while ((running_ || !sorts_.empty() || !merges_.empty()) && error_.empty()) cond_.wait(lock);
+      if (!error_.empty()) error_();
+#endif
+    }
+
+  private:
+#ifdef WITH_THREADS
+    void Work() {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      while (true) {
+        while (sorts_.empty() && merges_.empty() && !stop_) cond_.wait(lock);
+        if (stop_) return;
+        // Sorts first: they free blocks for reading and a merge waits for the sorts of its order.  
+        std::deque<boost::function<void()> > &queue = sorts_.empty() ? merges_ : sorts_;
+        boost::function<void()> job(queue.front());
+        queue.pop_front();
+        ++running_;
+        lock.unlock();
+        try {
+          job();
+        } catch (const FormatLoadException &e) {
+          Fail(boost::bind(&Rethrow<FormatLoadException>, e));
+        } catch (const util::ErrnoException &e) {
+          Fail(boost::bind(&Rethrow<util::ErrnoException>, e));
+        } catch (const util::Exception &e) {
+          Fail(boost::bind(&Rethrow<util::Exception>, e));
+        } catch (const std::bad_alloc &e) {
+          Fail(boost::bind(&Rethrow<std::bad_alloc>, e));
+        } catch (const std::exception &e) {
+          util::Exception copy;
+          copy << e.what();
+          Fail(boost::bind(&Rethrow<util::Exception>, copy));
+        }
+        lock.lock();
+        --running_;
+        cond_.notify_all();
+      }
+    }
+
+    void Fail(const boost::function<void()> &rethrow) {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      if (error_.empty()) error_ = rethrow;
+      cond_.notify_all();
+    }
+
+    void SortInBackground(uint8_t *begin, uint8_t *end, const std::string &name, std::size_t entry_size, unsigned char order) {
+      try {
+        SortBatch(begin, end, name, entry_size, order);
+      } catch (...) {
+        SortDone(begin, order);
+        throw;
+      }
+      SortDone(begin, order);
+    }
+
+    void SortDone(uint8_t *block, unsigned char order) {
+      boost::unique_lock<boost::mutex> lock(mutex_);
+      free_.push_back(block);
+      --pending_[order];
+      cond_.notify_all();
+    }
+
+    void MergeInBackground(const std::deque<std::string> &files, const std::string &file_prefix, std::size_t weights_size, unsigned char order, bool contexts) {
+      {
+        // The sorts of this order were queued first, so they are running or done.  
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        while (order < pending_.size() && pending_[order] && !stop_) cond_.wait(lock);
+        if (stop_) return;
+      }
+      if (contexts) {
+        MergeContexts(files, file_prefix, order);
+      } else {
+        MergeBatches(files, file_prefix, weights_size, order);
+      }
+    }
+#endif
+
+    const std::size_t block_size_;
+    std::vector<uint8_t*> free_;
+
+#ifdef WITH_THREADS
+    boost::mutex mutex_;
+    boost::condition_variable cond_;
+    std::deque<boost::function<void()> > sorts_, merges_;
+    std::vector<std::size_t> pending_;
+    std::size_t running_;
+    bool stop_;
+    boost::function<void()> error_;
+    boost::thread_group workers_;
+#endif
+};
+
+void ConvertToSorted(util::FilePiece &f, const SortedVocabulary &vocab, const std::vector<uint64_t> &counts, SortJobs &jobs, const std::string &file_prefix, unsigned char order, PositiveProbWarn &warn, std::size_t threads) {
   ReadNGramHeader(f, order);
   const size_t count = counts[order - 1];
+  NGramReader<SortedVocabulary, Prob> longest(f, order, (order == counts.size()) ? count : 0, vocab, warn, threads);
+  NGramReader<SortedVocabulary, ProbBackoff> middle(f, order, (order == counts.size()) ? 0 : count, vocab, warn, threads);
   // Size of weights.  Does it include backoff?  
   const size_t words_size = sizeof(WordIndex) * order;
   const size_t weights_size = sizeof(float) + ((order == counts.size()) ? 0 : sizeof(float));
   const size_t entry_size = words_size + weights_size;
-  const size_t batch_size = std::min(count, mem.size() / entry_size);
-  uint8_t *const begin = reinterpret_cast<uint8_t*>(mem.get());
+  const size_t batch_size = std::min(count, jobs.BlockSize() / entry_size);
   std::deque<std::string> files;
   for (std::size_t batch = 0, done = 0; done < count; ++batch) {
+    uint8_t *const begin = jobs.GetBlock();
     uint8_t *out = begin;
     uint8_t *out_end = out + std::min(count - done, batch_size) * entry_size;
     if (order == counts.size()) {
       for (; out != out_end; out += entry_size) {
-        ReadNGram(f, order, vocab, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<Prob*>(out + words_size), warn);
+        longest.Read(reinterpret_cast<WordIndex*>(out), *reinterpret_cast<Prob*>(out + words_size));
       }
     } else {
       for (; out != out_end; out += entry_size) {
-        ReadNGram(f, order, vocab, reinterpret_cast<WordIndex*>(out), *reinterpret_cast<ProbBackoff*>(out + words_size), warn);
+        middle.Read(reinterpret_cast<WordIndex*>(out), *reinterpret_cast<ProbBackoff*>(out + words_size));
       }
     }
-    // Sort full records by full n-gram.  
-    util::SizedProxy proxy_begin(begin, entry_size), proxy_end(out_end, entry_size);
-    // parallel_sort uses too much RAM
-    std::sort(NGramIter(proxy_begin), NGramIter(proxy_end), util::SizedCompare<EntryCompare>(EntryCompare(order)));
-    files.push_back(DiskFlush(begin, out_end, file_prefix, batch, order));
-    WriteContextFile(begin, out_end, files.back(), entry_size, order);
-
     done += (out_end - begin) / entry_size;
+    files.push_back(TemporaryName(file_prefix, order, "_", batch));
+    jobs.Sort(begin, out_end, files.back(), entry_size, order);
   }
 
   // All individual files created.  Merge them.  
-
-  std::size_t merge_count = 0;
-  while (files.size() > 1) {
-    std::stringstream assembled;
-    assembled << file_prefix << static_cast<unsigned int>(order) << "_merge_" << (merge_count++);
-    files.push_back(assembled.str());
-    MergeSortedFiles(files[0], files[1], files.back(), weights_size, order, ThrowCombine());
-    MergeSortedFiles(files[0] + kContextSuffix, files[1] + kContextSuffix, files.back() + kContextSuffix, 0, order - 1, FirstCombine());
-    files.pop_front();
-    files.pop_front();
-  }
-  if (!files.empty()) {
-    std::stringstream assembled;
-    assembled << file_prefix << static_cast<unsigned int>(order) << "_merged";
-    std::string merged_name(assembled.str());
-    if (std::rename(files[0].c_str(), merged_name.c_str())) UTIL_THROW(util::ErrnoException, "Could not rename " << files[0].c_str() << " to " << merged_name.c_str());
-    std::string context_name = files[0] + kContextSuffix;
-    merged_name += kContextSuffix;
-    if (std::rename(context_name.c_str(), merged_name.c_str())) UTIL_THROW(util::ErrnoException, "Could not rename " << context_name << " to " << merged_name.c_str());
-  }
+  jobs.Merge(files, file_prefix, weights_size, order);
 }
 
 } // namespace
@@ -244,16 +455,24 @@ void ARPAToSortedFiles(const Config &config, util::FilePiece &f, std::vector<uin
     buffer_use = std::max<size_t>(buffer_use, static_cast<size_t>((sizeof(WordIndex) * order + 2 * sizeof(float)) * counts[order - 1]));
   }
   buffer_use = std::max<size_t>(buffer_use, static_cast<size_t>((sizeof(WordIndex) * counts.size() + sizeof(float)) * counts.back()));
-  buffer = std::min<size_t>(buffer, buffer_use);
+#ifdef WITH_THREADS
+  const std::size_t threads = std::max<std::size_t>(1, config.building_threads);
+#else
+  const std::size_t threads = 1;
+#endif
+  // Each thread gets a block of the buffer.  
+  buffer = std::min<size_t>(buffer, buffer_use * threads);
 
   util::scoped_memory mem;
   mem.reset(malloc(buffer), buffer, util::scoped_memory::MALLOC_ALLOCATED);
   if (!mem.get()) UTIL_THROW(util::ErrnoException, "malloc failed for sort buffer size " << buffer);
 
+  SortJobs jobs(mem.get(), buffer, threads);
   for (unsigned char order = 2; order <= counts.size(); ++order) {
-    ConvertToSorted(f, vocab, counts, mem, file_prefix, order, warn);
+    ConvertToSorted(f, vocab, counts, jobs, file_prefix, order, warn, config.arpa_threads);
   }
   ReadEnd(f);
+  jobs.Join();
 }
 
 } // namespace trie
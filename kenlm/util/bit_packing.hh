@@ -118,6 +118,29 @@ inline void WriteNonPositiveFloat31(void *base, uint64_t bit_off, float value) {
 
 void BitPackingSanity();
 
+// Number of set bits.  
+inline unsigned int PopCount64(uint64_t value) {
+#ifdef __GNUC__
+  return __builtin_popcountll(value);
+#else
+  unsigned int ret = 0;
+  for (; value; value &= value - 1) ++ret;
+  return ret;
+#endif
+}
+
+// Position of the lowest set bit.  value must not be 0.  
+inline unsigned int LowestBit64(uint64_t value) {
+  assert(value);
+#ifdef __GNUC__
+  return __builtin_ctzll(value);
+#else
+  unsigned int ret = 0;
+  for (; !(value & 1); value >>= 1) ++ret;
+  return ret;
+#endif
+}
+
 // Return bits required to store integers upto max_value.  Not the most
 // efficient implementation, but this is only called a few times to size tries. 
 uint8_t RequiredBits(uint64_t max_value);
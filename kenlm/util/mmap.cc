@@ -6,11 +6,17 @@
 #include <iostream>
 
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <stdlib.h>
+#include <string.h>
 #include "util/portability.hh"
 
+#ifndef WIN32
+#include <sys/file.h>
+#endif
+
 namespace util {
 
 scoped_mmap::~scoped_mmap() {
@@ -92,8 +98,13 @@ void MapRead(LoadMethod method, FD fd, off_t offset, std::size_t size, scoped_me
     case POPULATE_OR_READ:
 #endif
     case READ:
-      out.reset(malloc(size), size, scoped_memory::MALLOC_ALLOCATED);
-      if (!out.get()) UTIL_THROW(util::ErrnoException, "Allocating " << size << " bytes with malloc");
+    case HUGE_READ:
+      if (method == HUGE_READ) {
+        HugeMalloc(size, out);
+      } else {
+        out.reset(malloc(size), size, scoped_memory::MALLOC_ALLOCATED);
+        if (!out.get()) UTIL_THROW(util::ErrnoException, "Allocating " << size << " bytes with malloc");
+      }
 #ifdef WIN32
 
 #else
@@ -114,6 +125,98 @@ void *MapAnonymous(std::size_t size) {
 	  | MAP_PRIVATE, false, kBadFD, 0);
 }
 
+void HugeMalloc(std::size_t size, scoped_memory &to) {
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+  // Ask for 2 MB pages explicitly so the rounding is right whatever the default huge page size is.  
+  const std::size_t kHugePage = 1 << 21;
+  std::size_t rounded = (size + kHugePage - 1) & ~(kHugePage - 1);
+  void *ret = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT), -1, 0);
+  if (ret != MAP_FAILED) {
+    to.reset(ret, rounded, scoped_memory::MMAP_ALLOCATED);
+    return;
+  }
+  // Not enough huge pages reserved.  
+#endif
+  to.reset(MapAnonymous(size), size, scoped_memory::MMAP_ALLOCATED);
+#ifdef MADV_HUGEPAGE
+  // Just a hint.  It fails harmlessly if transparent huge pages are disabled.  
+  madvise(to.get(), size, MADV_HUGEPAGE);
+#endif
+}
+
+namespace {
+// Appended to the copy of the file in a shared memory segment once it is completely loaded.  
+struct SharedTrailer {
+  uint64_t magic;
+  uint64_t file_size;
+  int64_t file_mtime;
+};
+
+const uint64_t kSharedMagic = 0x4d48534d4c6e654bULL;
+
+#ifndef WIN32
+void FileTrailer(FD fd, SharedTrailer &to) {
+  struct stat sb;
+  if (fstat(fd, &sb)) UTIL_THROW(ErrnoException, "fstat failed on fd " << fd);
+  to.magic = kSharedMagic;
+  to.file_size = sb.st_size;
+  to.file_mtime = sb.st_mtime;
+}
+#endif
+} // namespace
+
+void MapSharedRead(const char *name, bool huge, FD fd, off_t offset, std::size_t size, scoped_memory &out) {
+#ifdef WIN32
+  UTIL_THROW(Exception, "Shared memory segments are not implemented on Windows");
+#else
+  SharedTrailer expected;
+  FileTrailer(fd, expected);
+  const std::size_t total = size + sizeof(SharedTrailer);
+
+  {
+    scoped_fd created(shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH));
+    if (created.get() != kBadFD) {
+      try {
+        // Others wait for this lock, which is released when created is closed.  
+        if (flock(created.get(), LOCK_EX)) UTIL_THROW(ErrnoException, "flock failed on shared memory segment " << name);
+        if (-1 == ftruncate(created.get(), total)) UTIL_THROW(ErrnoException, "ftruncate on shared memory segment " << name << " to " << total << " failed");
+        scoped_mmap mem(MapOrThrow(total, true, kFileFlags, false, created.get(), 0), total);
+#ifdef MADV_HUGEPAGE
+        if (huge) madvise(mem.get(), total, MADV_HUGEPAGE);
+#endif
+        if (-1 == lseek(fd, offset, SEEK_SET)) UTIL_THROW(ErrnoException, "lseek to " << offset << " in fd " << fd << " failed.");
+        ReadOrThrow(fd, mem.get(), size);
+        memcpy(static_cast<uint8_t*>(mem.get()) + size, &expected, sizeof(SharedTrailer));
+      } catch (...) {
+        shm_unlink(name);
+        throw;
+      }
+    } else if (errno != EEXIST) {
+      UTIL_THROW(ErrnoException, "Failed to create shared memory segment " << name);
+    }
+  }
+
+  scoped_fd shared(shm_open(name, O_RDONLY, 0));
+  if (kBadFD == shared.get()) UTIL_THROW(ErrnoException, "Failed to open shared memory segment " << name);
+  off_t got;
+  // The creator may not have taken its lock or sized the segment yet.  
+  for (unsigned int attempt = 0; ; ++attempt) {
+    if (flock(shared.get(), LOCK_SH)) UTIL_THROW(ErrnoException, "flock failed on shared memory segment " << name);
+    got = SizeFile(shared.get());
+    if (got) break;
+    flock(shared.get(), LOCK_UN);
+    UTIL_THROW_IF(attempt == 100, Exception, "Shared memory segment " << name << " is still empty.  Remove it if the process that created it died.");
+    usleep(100000);
+  }
+  UTIL_THROW_IF(static_cast<uint64_t>(got) != total, Exception, "Shared memory segment " << name << " has " << got << " bytes instead of " << total << ".  It holds a different file; remove it or use another name.");
+  out.reset(MapOrThrow(total, false, kFileFlags, true, shared.get(), 0), total, scoped_memory::MMAP_ALLOCATED);
+  SharedTrailer trailer;
+  memcpy(&trailer, out.begin() + size, sizeof(SharedTrailer));
+  UTIL_THROW_IF(trailer.magic != kSharedMagic, Exception, "Loading shared memory segment " << name << " did not finish.  Remove it and try again.");
+  UTIL_THROW_IF(trailer.file_size != expected.file_size || trailer.file_mtime != expected.file_mtime, Exception, "Shared memory segment " << name << " was loaded from a different version of the file.  Remove it to load the new one.");
+#endif
+}
+
 void *MapZeroedWrite(const char *name, std::size_t size, scoped_fd &file) {
 #ifdef WIN32
 
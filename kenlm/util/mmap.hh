@@ -89,7 +89,11 @@ typedef enum {
   // Populate on Linux.  malloc and read on non-Linux.  
   POPULATE_OR_READ,
   // malloc and read.  
-  READ
+  READ,
+  // Read into anonymous memory on huge pages to save TLB misses: MAP_HUGETLB
+  // if the kernel has huge pages reserved, otherwise transparent huge pages.
+  // Same as READ where neither exists.  
+  HUGE_READ
 } LoadMethod;
 
 extern const int kFileFlags;
@@ -101,6 +105,21 @@ void MapRead(LoadMethod method, FD fd, off_t offset, std::size_t size, scoped_me
 
 void *MapAnonymous(std::size_t size);
 
+// Anonymous memory on huge pages if possible, for HUGE_READ.  size may be
+// rounded up to a whole number of huge pages.  
+void HugeMalloc(std::size_t size, scoped_memory &to);
+
+/* Map size bytes of fd from offset read-only through the named POSIX shared
+ * memory segment, so that processes loading the same file share one copy in
+ * memory.  The first process to ask for name creates the segment and reads
+ * the file into it.  The others wait for that to finish and then attach.
+ * huge asks for transparent huge pages on the segment.  The segment outlives
+ * the processes: remove it (on Linux, rm /dev/shm/name) to free the memory.
+ * Attaching to a segment that was loaded from a file of a different size or
+ * modification time throws.  
+ */
+void MapSharedRead(const char *name, bool huge, FD fd, off_t offset, std::size_t size, scoped_memory &out);
+
 // Open file name with mmap of size bytes, all of which are initially zero.  
 void *MapZeroedWrite(const char *name, std::size_t size, scoped_fd &file);
 
@@ -104,6 +104,13 @@ typedef off_t OFF_T;
 
 #endif
 
+/* Hint that the memory at address will be read soon. */
+#ifdef __GNUC__
+#define UTIL_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define UTIL_PREFETCH(address)
+#endif
+
 #ifdef __GNUC__
 #define UTIL_FUNC_NAME __PRETTY_FUNCTION__
 #else
@@ -2,6 +2,7 @@
 #define UTIL_PROBING_HASH_TABLE__
 
 #include "util/exception.hh"
+#include "util/portability.hh"
 
 #include <algorithm>
 #include <cstddef>
@@ -99,6 +100,12 @@ template <class PackingT, class HashT, class EqualT = std::equal_to<typename Pac
       }    
     }
 
+    // Hint that Find(key) is coming, so the bucket can be loaded meanwhile.
+    template <class Key> void Prefetch(const Key key) const {
+      ConstIterator i(begin_ + (hash_(key) % buckets_));
+      UTIL_PREFETCH(&*i);
+    }
+
   private:
     MutableIterator begin_;
     std::size_t buckets_;
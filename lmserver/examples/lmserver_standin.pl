@@ -0,0 +1,102 @@
+#!/usr/bin/perl -w
+use strict;
+
+# Stand-in for lmserver, to test clients (such as the decoder's remote language
+# model) on the loopback interface without SRILM. Answers prob and bprob
+# requests with the log10 probabilities of an ARPA file, in a process per
+# connection.
+#
+# usage: lmserver_standin.pl model.arpa[.gz] [port]
+# then in moses.ini: [lmodel-file] 6 0 <order> localhost:<port>
+
+use IO::Socket::INET;
+
+my ($arpa, $port) = @ARGV;
+die "usage: $0 model.arpa[.gz] [port]\n" unless defined $arpa;
+$port = 6666 unless defined $port;
+
+# probabilities and backoff weights, keyed by n-gram (oldest word first)
+my (%prob, %bow);
+my $open = $arpa =~ /\.gz$/ ? "gzip -dc $arpa |" : $arpa;
+open(ARPA, $open) or die "can't read $arpa: $!\n";
+my $order = 0;
+while (<ARPA>) {
+  chomp;
+  if (/^\\(\d+)-grams:/) {
+    $order = $1;
+    next;
+  }
+  next if !$order || /^\\/ || !/\S/;
+  my @f = split(/\t/);
+  $prob{$f[1]} = $f[0];
+  $bow{$f[1]} = $f[2] if defined $f[2];
+}
+close(ARPA);
+
+# log10 p(word | context), most recent context word first, like lmserver
+sub word_prob {
+  my ($word, @context) = @_;
+  return -999 unless defined $prob{$word};
+  # the context stops at the first unknown word
+  for (my $i = 0; $i < @context; $i++) {
+    if (!defined $prob{$context[$i]}) {
+      splice(@context, $i);
+      last;
+    }
+  }
+  my $backoff = 0;
+  while (1) {
+    my $ngram = join(' ', reverse(@context), $word);
+    return $backoff + $prob{$ngram} if defined $prob{$ngram};
+    $backoff += $bow{join(' ', reverse(@context))} || 0;
+    pop(@context);
+  }
+}
+
+sub serve {
+  my $client = shift;
+  binmode($client);
+  while (defined(my $line = <$client>)) {
+    my ($command, @args) = split(' ', $line);
+    next unless defined $command;
+    if ($command eq 'prob') {
+      print $client pack('f', word_prob(@args)), "\r\n";
+    } elsif ($command eq 'bprob' && @args == 1) {
+      # number of n-grams, then each one's length and NUL-terminated words
+      my $data;
+      return unless read($client, $data, $args[0]) == $args[0];
+      my $count = unpack('N', $data);
+      my $pos = 4;
+      my @probs;
+      for (1 .. $count) {
+        my $n = unpack('C', substr($data, $pos++, 1));
+        my @words;
+        for (1 .. $n) {
+          my $end = index($data, "\0", $pos);
+          push(@words, substr($data, $pos, $end - $pos));
+          $pos = $end + 1;
+        }
+        push(@probs, word_prob(@words));
+      }
+      # big-endian like the count
+      print $client "PROBS $count\r\n", pack('f>*', @probs);
+    } elsif ($command eq 'quit') {
+      return;
+    } else {
+      print $client "ERROR\r\n";
+    }
+  }
+}
+
+my $server = IO::Socket::INET->new(LocalAddr => 'localhost', LocalPort => $port
+                                   , Listen => 16, ReuseAddr => 1)
+  or die "can't listen on port $port: $!\n";
+$SIG{CHLD} = 'IGNORE';
+print STDERR "serving $arpa on port $port\n";
+while (my $client = $server->accept()) {
+  if (fork() == 0) {
+    serve($client);
+    exit(0);
+  }
+  close($client);
+}
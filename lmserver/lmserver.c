@@ -396,6 +396,11 @@ static void conn_cleanup(conn *c) {
         free(c->write_and_free);
         c->write_and_free = 0;
     }
+
+    if (c->item) {
+        free(c->item);
+        c->item = 0;
+    }
 }
 
 /*
@@ -905,6 +910,109 @@ static inline void process_srilm_command(conn *c, token_t *tokens, size_t ntoken
     c->write_and_go = conn_read;
 }
 
+/* longest n-gram and largest request accepted by bprob */
+#define BPROB_MAX_ORDER 16
+#define BPROB_MAX_BYTES (64 * 1024 * 1024)
+
+/*
+ * bprob <bytes>\r\n is followed by a request of that many bytes: the number of
+ * n-grams (uint32 in network byte order), then for each n-gram its length (uint8) and its words as
+ * NUL-terminated strings, in the order of the prob arguments. The request is
+ * read in the nread state and answered by complete_nread().
+ */
+static void process_srilm_batch_command(conn *c, token_t *tokens, size_t ntokens) {
+    char *end;
+    long vlen = strtol(tokens[1].value, &end, 10);
+
+    if (*end != '\0' || vlen < (long)sizeof(uint32_t) || vlen > BPROB_MAX_BYTES) {
+        out_string(c, "CLIENT_ERROR bad request size");
+        return;
+    }
+
+    c->item = malloc(vlen);
+    if (c->item == 0) {
+        out_string(c, "SERVER_ERROR out of memory storing request");
+        /* swallow the request */
+        c->write_and_go = conn_swallow;
+        c->sbytes = vlen;
+        return;
+    }
+
+    c->ritem = c->item;
+    c->rlbytes = vlen;
+    conn_set_state(c, conn_nread);
+}
+
+/*
+ * answers a bprob request with PROBS <count>\r\n, then the bits of the log
+ * probabilities (IEEE floats) as uint32s in network byte order.
+ */
+static void complete_nread(conn *c) {
+    char *p = c->item;
+    char *end = c->ritem;
+    char *reply;
+    uint32_t *probs;
+    uint32_t count, bits, i;
+    int header;
+
+    assert(c != NULL);
+
+    memcpy(&count, p, sizeof(uint32_t));
+    count = ntohl(count);
+    p += sizeof(uint32_t);
+    if (count > (end - p) / 2) {
+        free(c->item);
+        c->item = 0;
+        out_string(c, "CLIENT_ERROR bad data chunk");
+        return;
+    }
+
+    reply = malloc(32 + count * sizeof(uint32_t));
+    if (reply == 0) {
+        free(c->item);
+        c->item = 0;
+        out_string(c, "SERVER_ERROR out of memory writing probabilities");
+        return;
+    }
+    header = sprintf(reply, "PROBS %u\r\n", count);
+    probs = (uint32_t*)(reply + header);
+
+    for (i = 0; i < count; ++i) {
+        int context[BPROB_MAX_ORDER + 1];
+        int n, j;
+        float prob = -999.0f;
+
+        if (p == end || (n = (unsigned char)*p++) > BPROB_MAX_ORDER)
+            break;
+        for (j = 0; j < n; ++j) {
+            char *word_end = memchr(p, '\0', end - p);
+            if (word_end == NULL)
+                break;
+            context[j] = srilm_getvoc(p);
+            p = word_end + 1;
+        }
+        if (j < n)
+            break;
+        if (n > 0 && context[0] != -1) {
+            context[n] = -1;
+            prob = srilm_wordprob(context[0], &context[1]);
+        }
+        memcpy(&bits, &prob, sizeof(uint32_t));
+        bits = htonl(bits);
+        memcpy(&probs[i], &bits, sizeof(uint32_t));
+    }
+
+    free(c->item);
+    c->item = 0;
+
+    if (i < count) {
+        free(reply);
+        out_string(c, "CLIENT_ERROR bad data chunk");
+        return;
+    }
+    write_and_free(c, reply, header + count * sizeof(uint32_t));
+}
+
 static void process_command(conn *c, char *command) {
 
     token_t tokens[MAX_TOKENS];
@@ -933,6 +1041,9 @@ static void process_command(conn *c, char *command) {
     if (ntokens >1 &&
       strcmp(tokens[COMMAND_TOKEN].value, "prob") == 0) {
         process_srilm_command(c, tokens, ntokens);
+    } else if (ntokens == 3 &&
+      strcmp(tokens[COMMAND_TOKEN].value, "bprob") == 0) {
+        process_srilm_batch_command(c, tokens, ntokens);
     } else if (ntokens >= 2 && (strcmp(tokens[COMMAND_TOKEN].value, "stats") == 0)) {
 
         process_stat(c, tokens, ntokens);
@@ -1257,7 +1368,50 @@ static void drive_machine(conn *c) {
             break;
 
         case conn_nread:
-	    assert(!"nread should not be possible");
+            /* we are reading rlbytes into ritem; */
+            if (c->rlbytes == 0) {
+                complete_nread(c);
+                break;
+            }
+            /* first check if we have leftovers in the conn_read buffer */
+            if (c->rbytes > 0) {
+                int tocopy = c->rbytes > c->rlbytes ? c->rlbytes : c->rbytes;
+                memcpy(c->ritem, c->rcurr, tocopy);
+                c->ritem += tocopy;
+                c->rlbytes -= tocopy;
+                c->rcurr += tocopy;
+                c->rbytes -= tocopy;
+                break;
+            }
+
+            /*  now try reading from the socket */
+            res = read(c->sfd, c->ritem, c->rlbytes);
+            if (res > 0) {
+                STATS_LOCK();
+                stats.bytes_read += res;
+                STATS_UNLOCK();
+                c->ritem += res;
+                c->rlbytes -= res;
+                break;
+            }
+            if (res == 0) { /* end of stream */
+                conn_set_state(c, conn_closing);
+                break;
+            }
+            if (res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (!update_event(c, EV_READ | EV_PERSIST)) {
+                    if (settings.verbose > 0)
+                        fprintf(stderr, "Couldn't update event\n");
+                    conn_set_state(c, conn_closing);
+                    break;
+                }
+                stop = true;
+                break;
+            }
+            /* otherwise we have a real error, on which we close the connection */
+            if (settings.verbose > 0)
+                fprintf(stderr, "Failed to read, and not due to blocking\n");
+            conn_set_state(c, conn_closing);
             break;
 
         case conn_swallow:
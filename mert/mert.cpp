@@ -388,12 +388,14 @@ int main (int argc, char **argv)
     for (size_t j = 0; j < startingPoints.size(); ++j) {
       OptimizationTask* task = new OptimizationTask(O,startingPoints[j]);
       tasks.push_back(task);
+    }
 #ifdef WITH_THREADS
-      pool.Submit(task);
+    pool.SubmitBatch(std::vector<Moses::Task*>(tasks.begin(), tasks.end()));
 #else
-      task->Run();
-#endif
+    for (size_t j = 0; j < tasks.size(); ++j) {
+      tasks[j]->Run();
     }
+#endif
   }
 
     
@@ -0,0 +1,42 @@
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+#include "MMapPhraseTable.h"
+#include "Timer.h"
+
+using namespace std;
+using namespace Moses;
+
+int main(int argc,char **argv)
+{
+  std::string fti, fto;
+  unsigned quantizeBits=0;
+  for(int i=1; i<argc; ++i) {
+    std::string s(argv[i]);
+    if(s=="-ttable" && i+1<argc) fti=argv[++i];
+    else if(s=="-out" && i+1<argc) fto=argv[++i];
+    else if(s=="-quantize" && i+1<argc) quantizeBits=atoi(argv[++i]);
+    else if(s=="-h") {
+      fti.clear();
+      break;
+    } else {
+      std::cerr<<"ERROR: unknown option '"<<s<<"'\n";
+      return 1;
+    }
+  }
+  if(fti.empty() || fto.empty()) {
+    std::cerr<<"usage "<<argv[0]<<" -ttable string -out string [-quantize int]\n\n"
+             "options:\n"
+             "\t-ttable string   -- text translation table, sorted by source phrase (may be gzipped)\n"
+             "\t-out string      -- binary translation table to create, use with ttable type 9\n"
+             "\t-quantize int    -- store each score in 1 to 8 bits instead of as a float\n"
+             "\n";
+    return 1;
+  }
+
+  Timer timer;
+  timer.start();
+  if(!MMapPhraseTable::Create(fti,fto,quantizeBits)) return 1;
+  std::cerr<<"created "<<fto<<" in "<<timer.get_elapsed_time()<<" seconds\n";
+  return 0;
+}
@@ -82,6 +82,12 @@ public:
     delete m_source;
   }
 
+  //! with -threads-longest-first, long sentences are started first so they
+  //! don't hold up the end of a threaded run
+  int GetPriority() const {
+    return StaticData::Instance().ThreadsLongestFirst() ? m_source->GetSize() : 0;
+  }
+
   void Run() {
     const StaticData &staticData = StaticData::Instance();
     const TranslationSystem &system = staticData.GetTranslationSystem(TranslationSystem::DEFAULT);
@@ -9,6 +9,7 @@
 
 #include "LatticeMBR.h"
 #include "StaticData.h"
+#include "ThreadPool.h"
 #include <algorithm>
 #include <set>
 
@@ -16,6 +17,199 @@ using namespace std;
 
 size_t bleu_order = 4;
 float UNKNGRAMLOGPROB = -20;
+
+namespace
+{
+/** Forward pass of calcNgramExpectations() over a lattice sorted by coverage.
+* An edge always covers more source words, so the nodes with the same coverage
+* only read the scores of nodes that are done, and can be scored in any order.
+*/
+class NgramForwardPass
+{
+public:
+  NgramForwardPass(const Lattice& lattice, map<const Hypothesis*, vector<Edge> >& incomingEdges, NgramIds& ngramIds, bool posteriors)
+    : m_lattice(lattice), m_incomingEdges(incomingEdges), m_ngramIds(ngramIds), m_posteriors(posteriors)
+    , m_forwardScores(lattice.size(), 0.0f), m_ngramScores(lattice.size()) {
+    for (size_t i = 0; i < lattice.size(); ++i) {
+      m_nodeIndex[lattice[i]] = i;
+      //so that the threads only look up edges
+      m_incomingEdges[lattice[i]];
+    }
+  }
+
+  //the ngrams of the edges, done in one thread since they are interned
+  void CalcEdgeNgrams() {
+    for (size_t i = 1; i < m_lattice.size(); ++i) {
+      vector <Edge> & edges = m_incomingEdges.find(m_lattice[i])->second;
+      for (size_t e = 0; e < edges.size(); ++e) {
+        edges[e].GetNgrams(m_incomingEdges, m_ngramIds);
+      }
+    }
+  }
+
+  //score nodes first, first + step, ... before end
+  void ScoreNodes(size_t first, size_t end, size_t step) {
+    for (size_t i = first; i < end; i += step) {
+      ScoreNode(i);
+    }
+  }
+
+  float GetForwardScore(size_t node) const {
+    return m_forwardScores[node];
+  }
+
+  const NgramScores& GetNgramScores() const {
+    return m_ngramScores;
+  }
+
+private:
+  const Lattice& m_lattice;
+  map<const Hypothesis*, vector<Edge> >& m_incomingEdges;
+  NgramIds& m_ngramIds;
+  bool m_posteriors;
+  boost::unordered_map<const Hypothesis*, size_t> m_nodeIndex;
+  vector<float> m_forwardScores;
+  NgramScores m_ngramScores;
+
+  size_t GetNodeIndex(const Hypothesis* hypo) const {
+    boost::unordered_map<const Hypothesis*, size_t>::const_iterator it = m_nodeIndex.find(hypo);
+    assert(it != m_nodeIndex.end());
+    return it->second;
+  }
+
+  void ScoreNode(size_t node);
+};
+
+void NgramForwardPass::ScoreNode(size_t node)
+{
+  const Hypothesis* currHyp = m_lattice[node];
+  VERBOSE(3, "Processing hyp: " << currHyp->GetId() << ", num words cov= " << currHyp->GetWordsBitmap().GetNumWordsCovered() <<  endl)
+
+  vector <Edge> & edges = m_incomingEdges.find(currHyp)->second;
+  float& forwardScore = m_forwardScores[node];
+  for (size_t e = 0; e < edges.size(); ++e) {
+    const Edge& edge = edges[e];
+    float tailScore = m_forwardScores[GetNodeIndex(edge.GetTailNode())];
+    if (e == 0) {
+      forwardScore = tailScore + edge.GetScore();
+      VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] = fwdScore["<<edge.GetTailNode()->GetId() << "] + edge Score: " << edge.GetScore() << endl)
+    } else {
+      forwardScore = log_sum(forwardScore, tailScore + edge.GetScore());
+      VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] += fwdScore["<<edge.GetTailNode()->GetId() << "] + edge Score: " << edge.GetScore() << endl)
+    }
+  }
+
+  //Process ngrams now
+  for (size_t j =0 ; j < edges.size(); ++j) {
+    Edge& edge = edges[j];
+    const NgramHistory & incomingPhrases = edge.GetNgrams(m_incomingEdges, m_ngramIds);
+
+    //let's first score ngrams introduced by this edge
+    for (NgramHistory::const_iterator it = incomingPhrases.begin(); it != incomingPhrases.end(); ++it) {
+      NgramId ngram = it->first;
+      const PathCounts& pathCounts = it->second;
+
+      for (PathCounts::const_iterator pathCountIt = pathCounts.begin(); pathCountIt != pathCounts.end(); ++pathCountIt) {
+        //Score of an n-gram is forward score of head node of leftmost edge + all edge scores
+        const Path&  path = pathCountIt->first;
+        float score = m_forwardScores[GetNodeIndex(path[0]->GetTailNode())];
+        for (size_t i = 0; i < path.size(); ++i) {
+          score += path[i]->GetScore();
+        }
+        //if we're doing expectations, then the number of times the ngram
+        //appears on the path is relevant.
+        size_t count = m_posteriors ? 1 : pathCountIt->second;
+        for (size_t k = 0; k < count; ++k) {
+          m_ngramScores.addScore(node,ngram,score);
+        }
+      }
+    }
+
+    //Now score ngrams that are just being propagated from the history
+    size_t tail = GetNodeIndex(edge.GetTailNode());
+    for (NgramScores::NodeScoreIterator it = m_ngramScores.nodeBegin(tail);
+         it != m_ngramScores.nodeEnd(tail); ++it) {
+      NgramId currNgram = it->first;
+      float currNgramScore = it->second;
+
+      // For posteriors, don't double count ngrams
+      if (!m_posteriors || incomingPhrases.find(currNgram) == incomingPhrases.end()) {
+        float score = edge.GetScore() + currNgramScore;
+        m_ngramScores.addScore(node,currNgram,score);
+      }
+    }
+  }
+}
+
+#ifdef WITH_THREADS
+//! scores one share of the nodes with the same coverage
+class ScoreNodesShare
+{
+public:
+  ScoreNodesShare(NgramForwardPass &forwardPass, size_t begin, size_t end, size_t numShares)
+    : m_forwardPass(forwardPass), m_begin(begin), m_end(end), m_numShares(numShares)
+  {}
+
+  void operator()(size_t share) {
+    m_forwardPass.ScoreNodes(m_begin + share, m_end, m_numShares);
+  }
+
+private:
+  NgramForwardPass &m_forwardPass;
+  size_t m_begin, m_end, m_numShares;
+};
+
+//! scores the nodes [begin, end) with the search threads
+void ScoreNodesInParallel(NgramForwardPass &forwardPass, size_t begin, size_t end)
+{
+  const size_t numShares = min((size_t) StaticData::Instance().SearchThreadCount(), end - begin);
+
+  RunShares(StaticData::Instance().GetSearchThreadPool(), numShares, ScoreNodesShare(forwardPass, begin, end, numShares));
+}
+#endif
+}
+
+const NgramId NgramIds::EMPTY;
+
+NgramIds::NgramIds()
+{
+  Entry empty;
+  empty.prefix = EMPTY;
+  empty.order = 0;
+  m_entries.push_back(empty);
+}
+
+NgramId NgramIds::Extend(NgramId prefix, const Word &word)
+{
+  pair<boost::unordered_map<pair<NgramId, Word>, NgramId>::iterator, bool> inserted
+    = m_ids.insert(make_pair(make_pair(prefix, word), (NgramId) m_entries.size()));
+  if (inserted.second) {
+    Entry entry;
+    entry.prefix = prefix;
+    entry.word = word;
+    entry.order = m_entries[prefix].order + 1;
+    m_entries.push_back(entry);
+  }
+  return inserted.first->second;
+}
+
+NgramId NgramIds::Find(NgramId prefix, const Word &word) const
+{
+  boost::unordered_map<pair<NgramId, Word>, NgramId>::const_iterator it = m_ids.find(make_pair(prefix, word));
+  return (it == m_ids.end()) ? NOT_FOUND : it->second;
+}
+
+void NgramIds::GetNgram(NgramId id, Phrase &ngram) const
+{
+  vector<const Word*> words;
+  for (; id != EMPTY; id = GetPrefix(id)) {
+    words.push_back(&GetLastWord(id));
+  }
+  for (size_t i = words.size(); i > 0; --i) {
+    ngram.AddWord(*words[i-1]);
+  }
+}
+
 void GetOutputWords(const TrellisPath &path, vector <Word> &translation)
 {
   const std::vector<const Hypothesis *> &edges = path.GetEdges();
@@ -32,13 +226,19 @@ void GetOutputWords(const TrellisPath &path, vector <Word> &translation)
 }
 
 
-void extract_ngrams(const vector<Word >& sentence, map < Phrase, int >  & allngrams)
+void extract_ngrams(const vector<Word >& sentence, const NgramIds& ngramIds, boost::unordered_map < NgramId, int >  & allngrams, vector<int>& unknownCounts)
 {
-  for (int k = 0; k < (int)bleu_order; k++) {
-    for(int i =0; i < max((int)sentence.size()-k,0); i++) {
-      Phrase ngram(Output, k+1);
-      for ( int j = i; j<= i+k; j++) {
-        ngram.AddWord(sentence[j]);
+  unknownCounts.assign(bleu_order, 0);
+  for (int i = 0; i < (int)sentence.size(); i++) {
+    NgramId ngram = NgramIds::EMPTY;
+    for (int k = 0; k < (int)bleu_order && i+k < (int)sentence.size(); k++) {
+      ngram = ngramIds.Find(ngram, sentence[i+k]);
+      if (ngram == NOT_FOUND) {
+        //neither are the longer ngrams starting here
+        for (; k < (int)bleu_order && i+k < (int)sentence.size(); k++) {
+          ++unknownCounts[k];
+        }
+        break;
       }
       ++allngrams[ngram];
     }
@@ -47,32 +247,15 @@ void extract_ngrams(const vector<Word >& sentence, map < Phrase, int >  & allngr
 
 
 
-void NgramScores::addScore(const Hypothesis* node, const Phrase& ngram, float score)
+void NgramScores::addScore(size_t node, NgramId ngram, float score)
 {
-  set<Phrase>::const_iterator ngramIter = m_ngrams.find(ngram);
-  if (ngramIter == m_ngrams.end()) {
-    ngramIter = m_ngrams.insert(ngram).first;
-  }
-  map<const Phrase*,float>& ngramScores = m_scores[node];
-  map<const Phrase*,float>::iterator scoreIter = ngramScores.find(&(*ngramIter));
-  if (scoreIter == ngramScores.end()) {
-    ngramScores[&(*ngramIter)] = score;
-  } else {
-    ngramScores[&(*ngramIter)] = log_sum(score,scoreIter->second);
+  boost::unordered_map<NgramId,float>& ngramScores = m_scores[node];
+  pair<boost::unordered_map<NgramId,float>::iterator, bool> inserted = ngramScores.insert(make_pair(ngram, score));
+  if (!inserted.second) {
+    inserted.first->second = log_sum(score,inserted.first->second);
   }
 }
 
-NgramScores::NodeScoreIterator NgramScores::nodeBegin(const Hypothesis* node)
-{
-  return m_scores[node].begin();
-}
-
-
-NgramScores::NodeScoreIterator NgramScores::nodeEnd(const Hypothesis* node)
-{
-  return m_scores[node].end();
-}
-
 LatticeMBRSolution::LatticeMBRSolution(const TrellisPath& path, bool isMap) :
   m_score(0.0f)
 {
@@ -94,26 +277,32 @@ LatticeMBRSolution::LatticeMBRSolution(const TrellisPath& path, bool isMap) :
 }
 
 
-void LatticeMBRSolution::CalcScore(map<Phrase, float>& finalNgramScores, const vector<float>& thetas, float mapWeight)
+void LatticeMBRSolution::CalcScore(const NgramIds& ngramIds, const NgramExpectations& finalNgramScores, const vector<float>& thetas, float mapWeight)
 {
   m_ngramScores.assign(thetas.size()-1, -10000);
 
-  map < Phrase, int > counts;
-  extract_ngrams(m_words,counts);
+  boost::unordered_map < NgramId, int > counts;
+  vector<int> unknownCounts;
+  extract_ngrams(m_words,ngramIds,counts,unknownCounts);
 
   //Now score this translation
   m_score = thetas[0] * m_words.size();
 
   //Calculate the ngramScores, working in log space at first
-  for (map < Phrase, int >::iterator ngrams = counts.begin(); ngrams != counts.end(); ++ngrams) {
+  for (boost::unordered_map < NgramId, int >::iterator ngrams = counts.begin(); ngrams != counts.end(); ++ngrams) {
     float ngramPosterior = UNKNGRAMLOGPROB;
-    map<Phrase,float>::const_iterator ngramPosteriorIt = finalNgramScores.find(ngrams->first);
+    NgramExpectations::const_iterator ngramPosteriorIt = finalNgramScores.find(ngrams->first);
     if (ngramPosteriorIt != finalNgramScores.end()) {
       ngramPosterior = ngramPosteriorIt->second;
     }
-    size_t ngramSize = ngrams->first.GetSize();
+    size_t ngramSize = ngramIds.GetOrder(ngrams->first);
     m_ngramScores[ngramSize-1] = log_sum(log((float)ngrams->second) + ngramPosterior,m_ngramScores[ngramSize-1]);
   }
+  for (size_t i = 0; i < unknownCounts.size(); ++i) {
+    if (unknownCounts[i] > 0) {
+      m_ngramScores[i] = log_sum(log((float)unknownCounts[i]) + UNKNGRAMLOGPROB,m_ngramScores[i]);
+    }
+  }
 
   //convert from log to probability and create weighted sum
   for (size_t i = 0; i < m_ngramScores.size(); ++i) {
@@ -273,141 +462,93 @@ void pruneLatticeFB(Lattice & connectedHyp, map < const Hypothesis*, set <const
 }
 
 void calcNgramExpectations(Lattice & connectedHyp, map<const Hypothesis*, vector<Edge> >& incomingEdges,
-                           map<Phrase, float>& finalNgramScores, bool posteriors)
+                           NgramIds& ngramIds, NgramExpectations& finalNgramScores, bool posteriors)
 {
 
   sort(connectedHyp.begin(),connectedHyp.end(),ascendingCoverageCmp); //sort by increasing source word cov
 
-  /*cerr << "Lattice:" << endl;
-  for (Lattice::const_iterator i = connectedHyp.begin(); i != connectedHyp.end(); ++i) {
-      const Hypothesis* h = *i;
-      cerr << *h << endl;
-      const vector<Edge>& edges = incomingEdges[h];
-      for (size_t e = 0; e < edges.size(); ++e) {
-          cerr << edges[e];
-      }
-  }*/
-
-  map<const Hypothesis*, float> forwardScore;
-  forwardScore[connectedHyp[0]] = 0.0f; //forward score of hyp 0 is 1 (or 0 in logprob space)
-  set< const Hypothesis *> finalHyps; //store completed hyps
-
-  NgramScores ngramScores;//ngram scores for each hyp
-
-  for (size_t i = 1; i < connectedHyp.size(); ++i) {
-    const Hypothesis* currHyp = connectedHyp[i];
-    if (currHyp->GetWordsBitmap().IsComplete()) {
-      finalHyps.insert(currHyp);
+  //forward score of hyp 0 is 1 (or 0 in logprob space)
+  NgramForwardPass forwardPass(connectedHyp, incomingEdges, ngramIds, posteriors);
+  forwardPass.CalcEdgeNgrams();
+
+  //nodes with the same coverage only depend on nodes with less
+#ifdef WITH_THREADS
+  const StaticData &staticData = StaticData::Instance();
+  // the node traces are not thread-safe
+  const size_t threadCount = staticData.GetVerboseLevel() < 2 ? staticData.SearchThreadCount() : 1;
+#endif
+  for (size_t begin = 1; begin < connectedHyp.size(); ) {
+    size_t coverage = connectedHyp[begin]->GetWordsBitmap().GetNumWordsCovered();
+    size_t end = begin + 1;
+    while (end < connectedHyp.size() && connectedHyp[end]->GetWordsBitmap().GetNumWordsCovered() == coverage) {
+      ++end;
     }
-
-    VERBOSE(3, "Processing hyp: " << currHyp->GetId() << ", num words cov= " << currHyp->GetWordsBitmap().GetNumWordsCovered() <<  endl)
-
-    vector <Edge> & edges = incomingEdges[currHyp];
-    for (size_t e = 0; e < edges.size(); ++e) {
-      const Edge& edge = edges[e];
-      if (forwardScore.find(currHyp) == forwardScore.end()) {
-        forwardScore[currHyp] = forwardScore[edge.GetTailNode()] + edge.GetScore();
-        VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] = fwdScore["<<edge.GetTailNode()->GetId() << "] + edge Score: " << edge.GetScore() << endl)
-      } else {
-        forwardScore[currHyp] = log_sum(forwardScore[currHyp], forwardScore[edge.GetTailNode()] + edge.GetScore());
-        VERBOSE(3, "Fwd score["<<currHyp->GetId()<<"] += fwdScore["<<edge.GetTailNode()->GetId() << "] + edge Score: " << edge.GetScore() << endl)
-      }
+#ifdef WITH_THREADS
+    if (threadCount > 1 && end - begin > 1) {
+      ScoreNodesInParallel(forwardPass, begin, end);
+    } else
+#endif
+    {
+      forwardPass.ScoreNodes(begin, end, 1);
     }
+    begin = end;
+  }
 
-    //Process ngrams now
-    for (size_t j =0 ; j < edges.size(); ++j) {
-      Edge& edge = edges[j];
-      const NgramHistory & incomingPhrases = edge.GetNgrams(incomingEdges);
-
-      //let's first score ngrams introduced by this edge
-      for (NgramHistory::const_iterator it = incomingPhrases.begin(); it != incomingPhrases.end(); ++it) {
-        const Phrase& ngram = it->first;
-        const PathCounts& pathCounts = it->second;
-        VERBOSE(4, "Calculating score for: " << it->first << endl)
-
-        for (PathCounts::const_iterator pathCountIt = pathCounts.begin(); pathCountIt != pathCounts.end(); ++pathCountIt) {
-          //Score of an n-gram is forward score of head node of leftmost edge + all edge scores
-          const Path&  path = pathCountIt->first;
-          //cerr << "path count for " << ngram << " is " << pathCountIt->second << endl;
-          float score = forwardScore[path[0]->GetTailNode()];
-          for (size_t i = 0; i < path.size(); ++i) {
-            score += path[i]->GetScore();
-          }
-          //if we're doing expectations, then the number of times the ngram
-          //appears on the path is relevant.
-          size_t count = posteriors ? 1 : pathCountIt->second;
-          for (size_t k = 0; k < count; ++k) {
-            ngramScores.addScore(currHyp,ngram,score);
-          }
-        }
-      }
-
-      //Now score ngrams that are just being propagated from the history
-      for (NgramScores::NodeScoreIterator it = ngramScores.nodeBegin(edge.GetTailNode());
-           it != ngramScores.nodeEnd(edge.GetTailNode()); ++it) {
-        const Phrase & currNgram = *(it->first);
-        float currNgramScore = it->second;
-        VERBOSE(4, "Calculating score for: " << currNgram << endl)
-
-        // For posteriors, don't double count ngrams
-        if (!posteriors || incomingPhrases.find(currNgram) == incomingPhrases.end()) {
-          float score = edge.GetScore() + currNgramScore;
-          ngramScores.addScore(currHyp,currNgram,score);
-        }
-      }
-
+  vector< size_t > finalHyps; //store completed hyps
+  for (size_t i = 1; i < connectedHyp.size(); ++i) {
+    if (connectedHyp[i]->GetWordsBitmap().IsComplete()) {
+      finalHyps.push_back(i);
     }
   }
 
   float Z = 9999999; //the total score of the lattice
 
   //Done - Print out ngram posteriors for final hyps
-  for (set< const Hypothesis *>::iterator finalHyp = finalHyps.begin(); finalHyp != finalHyps.end(); ++finalHyp) {
-    const Hypothesis* hyp = *finalHyp;
+  const NgramScores& ngramScores = forwardPass.GetNgramScores();
+  for (vector< size_t >::iterator finalHyp = finalHyps.begin(); finalHyp != finalHyps.end(); ++finalHyp) {
+    size_t hyp = *finalHyp;
 
     for (NgramScores::NodeScoreIterator it = ngramScores.nodeBegin(hyp); it != ngramScores.nodeEnd(hyp); ++it) {
-      const Phrase& ngram = *(it->first);
-      if (finalNgramScores.find(ngram) == finalNgramScores.end()) {
-        finalNgramScores[ngram] = it->second;
-      } else {
-        finalNgramScores[ngram] = log_sum(it->second,  finalNgramScores[ngram]);
+      pair<NgramExpectations::iterator, bool> inserted = finalNgramScores.insert(*it);
+      if (!inserted.second) {
+        inserted.first->second = log_sum(it->second,  inserted.first->second);
       }
     }
 
     if (Z == 9999999) {
-      Z = forwardScore[hyp];
+      Z = forwardPass.GetForwardScore(hyp);
     } else {
-      Z = log_sum(Z, forwardScore[hyp]);
+      Z = log_sum(Z, forwardPass.GetForwardScore(hyp));
     }
   }
 
   //Z *= scale;  //scale the score
 
-  for (map<Phrase, float>::iterator finalScoresIt = finalNgramScores.begin();  finalScoresIt != finalNgramScores.end(); ++finalScoresIt) {
+  for (NgramExpectations::iterator finalScoresIt = finalNgramScores.begin();  finalScoresIt != finalNgramScores.end(); ++finalScoresIt) {
     finalScoresIt->second =  finalScoresIt->second - Z;
     IFVERBOSE(2) {
-      VERBOSE(2,finalScoresIt->first << " [" << finalScoresIt->second << "]" << endl);
+      Phrase ngram(Output, ngramIds.GetOrder(finalScoresIt->first));
+      ngramIds.GetNgram(finalScoresIt->first, ngram);
+      VERBOSE(2,ngram << " [" << finalScoresIt->second << "]" << endl);
     }
   }
 
 }
 
-const NgramHistory& Edge::GetNgrams(map<const Hypothesis*, vector<Edge> > & incomingEdges)
+const NgramHistory& Edge::GetNgrams(map<const Hypothesis*, vector<Edge> > & incomingEdges, NgramIds &ngramIds)
 {
 
-  if (m_ngrams.size() > 0)
+  if (m_ngramsDone)
     return m_ngrams;
+  m_ngramsDone = true;
 
   const Phrase& currPhrase = GetWords();
   //Extract the n-grams local to this edge
   for (size_t start = 0; start < currPhrase.GetSize(); ++start) {
+    NgramId edgeNgram = NgramIds::EMPTY;
     for (size_t end = start; end < start + bleu_order; ++end) {
       if (end < currPhrase.GetSize()) {
-        Phrase edgeNgram(Output, end-start+1);
-        for (size_t index = start; index <= end; ++index) {
-          edgeNgram.AddWord(currPhrase.GetWord(index));
-        }
-        //cout << "Inserting Phrase : " << edgeNgram << endl;
+        edgeNgram = ngramIds.Extend(edgeNgram, currPhrase.GetWord(end));
         vector<const Edge*> edgeHistory;
         edgeHistory.push_back(this);
         storeNgramHistory(edgeNgram, edgeHistory);
@@ -422,32 +563,25 @@ const NgramHistory& Edge::GetNgrams(map<const Hypothesis*, vector<Edge> > & inco
     vector<Edge> & inEdges = it->second;
 
     for (vector<Edge>::iterator edge = inEdges.begin(); edge != inEdges.end(); ++edge) {//add the ngrams straddling prev and curr edge
-      const NgramHistory & edgeIncomingNgrams = edge->GetNgrams(incomingEdges);
+      const NgramHistory & edgeIncomingNgrams = edge->GetNgrams(incomingEdges, ngramIds);
       for (NgramHistory::const_iterator edgeInNgramHist = edgeIncomingNgrams.begin(); edgeInNgramHist != edgeIncomingNgrams.end(); ++edgeInNgramHist) {
-        const Phrase& edgeIncomingNgram = edgeInNgramHist->first;
+        NgramId edgeIncomingNgram = edgeInNgramHist->first;
         const PathCounts &  edgeIncomingNgramPaths = edgeInNgramHist->second;
-        size_t back = min(edgeIncomingNgram.GetSize(), edge->GetWordsSize());
+        size_t  edgeInNgramSize =  ngramIds.GetOrder(edgeIncomingNgram);
+        size_t back = min(edgeInNgramSize, edge->GetWordsSize());
         const Phrase&  edgeWords = edge->GetWords();
         IFVERBOSE(3) {
+          Phrase ngram(Output, edgeInNgramSize);
+          ngramIds.GetNgram(edgeIncomingNgram, ngram);
           cerr << "Edge: "<< *edge <<endl;
           cerr << "edgeWords: " << edgeWords << endl;
-          cerr << "edgeInNgram: " << edgeIncomingNgram << endl;
+          cerr << "edgeInNgram: " << ngram << endl;
         }
 
-        Phrase edgeSuffix(Output, ARRAY_SIZE_INCR);
-        Phrase ngramSuffix(Output, ARRAY_SIZE_INCR);
-        GetPhraseSuffix(edgeWords,back,edgeSuffix);
-        GetPhraseSuffix(edgeIncomingNgram,back,ngramSuffix);
-
-        if (ngramSuffix == edgeSuffix) { //we've got the suffix of previous edge
-          size_t  edgeInNgramSize =  edgeIncomingNgram.GetSize();
-
+        if (EndsWithSuffix(ngramIds,edgeIncomingNgram,edgeWords,back)) { //we've got the suffix of previous edge
+          NgramId newNgram = edgeIncomingNgram;
           for (size_t i = 0; i < GetWordsSize() && i + edgeInNgramSize < bleu_order ; ++i) {
-            Phrase newNgram(edgeIncomingNgram);
-            for (size_t j = 0; j <= i ; ++j) {
-              newNgram.AddWord(GetWords().GetWord(j));
-            }
-            VERBOSE(3, "Inserting New Phrase : " << newNgram << endl)
+            newNgram = ngramIds.Extend(newNgram, GetWords().GetWord(i));
 
             for (PathCounts::const_iterator pathIt = edgeIncomingNgramPaths.begin(); pathIt !=  edgeIncomingNgramPaths.end(); ++pathIt) {
               Path newNgramPath = pathIt->first;
@@ -462,14 +596,14 @@ const NgramHistory& Edge::GetNgrams(map<const Hypothesis*, vector<Edge> > & inco
   return m_ngrams;
 }
 
-//Add the last lastN words of origPhrase to targetPhrase
-void Edge::GetPhraseSuffix(const Phrase&  origPhrase, size_t lastN, Phrase& targetPhrase) const
+bool Edge::EndsWithSuffix(const NgramIds& ngramIds, NgramId ngram, const Phrase&  origPhrase, size_t lastN) const
 {
   size_t origSize = origPhrase.GetSize();
-  size_t startIndex = origSize - lastN;
-  for (size_t index = startIndex; index < origPhrase.GetSize(); ++index) {
-    targetPhrase.AddWord(origPhrase.GetWord(index));
+  for (size_t i = 0; i < lastN; ++i, ngram = ngramIds.GetPrefix(ngram)) {
+    if (ngramIds.GetLastWord(ngram) != origPhrase.GetWord(origSize - 1 - i))
+      return false;
   }
+  return true;
 }
 
 bool Edge::operator< (const Edge& compare ) const
@@ -502,13 +636,14 @@ void getLatticeMBRNBest(Manager& manager, TrellisPathList& nBestList,
   const StaticData& staticData = StaticData::Instance();
   std::map < int, bool > connected;
   std::vector< const Hypothesis *> connectedList;
-  map<Phrase, float> ngramPosteriors;
+  NgramIds ngramIds;
+  NgramExpectations ngramPosteriors;
   std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
   map<const Hypothesis*, vector<Edge> > incomingEdges;
   vector< float> estimatedScores;
   manager.GetForwardBackwardSearchGraph(&connected, &connectedList, &outgoingHyps, &estimatedScores);
   pruneLatticeFB(connectedList, outgoingHyps, incomingEdges, estimatedScores, manager.GetBestHypothesis(), staticData.GetLatticeMBRPruningFactor(),staticData.GetMBRScale());
-  calcNgramExpectations(connectedList, incomingEdges, ngramPosteriors,true);
+  calcNgramExpectations(connectedList, incomingEdges, ngramIds, ngramPosteriors,true);
 
   vector<float> mbrThetas = staticData.GetLatticeMBRThetas();
   float p = staticData.GetLatticeMBRPrecision();
@@ -529,16 +664,15 @@ void getLatticeMBRNBest(Manager& manager, TrellisPathList& nBestList,
     VERBOSE(2,endl);
   }
   TrellisPathList::const_iterator iter;
-  size_t ctr = 0;
-  LatticeMBRSolutionComparator comparator;
-  for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter, ++ctr) {
+  for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter) {
     const TrellisPath &path = **iter;
     solutions.push_back(LatticeMBRSolution(path,iter==nBestList.begin()));
-    solutions.back().CalcScore(ngramPosteriors,mbrThetas,mapWeight);
-    sort(solutions.begin(), solutions.end(), comparator);
-    while (solutions.size() > n) {
-      solutions.pop_back();
-    }
+    solutions.back().CalcScore(ngramIds,ngramPosteriors,mbrThetas,mapWeight);
+  }
+  //of equally scored solutions, keep the ones that came first in the n-best list
+  stable_sort(solutions.begin(), solutions.end(), LatticeMBRSolutionComparator());
+  if (solutions.size() > n) {
+    solutions.erase(solutions.begin() + n, solutions.end());
   }
   VERBOSE(2,"LMBR Score: " << solutions[0].GetScore() << endl);
 }
@@ -560,22 +694,21 @@ const TrellisPath doConsensusDecoding(Manager& manager, TrellisPathList& nBestLi
   const StaticData& staticData = StaticData::Instance();
   std::map < int, bool > connected;
   std::vector< const Hypothesis *> connectedList;
-  map<Phrase, float> ngramExpectations;
+  NgramIds ngramIds;
+  NgramExpectations ngramExpectations;
   std::map < const Hypothesis*, set <const Hypothesis*> > outgoingHyps;
   map<const Hypothesis*, vector<Edge> > incomingEdges;
   vector< float> estimatedScores;
   manager.GetForwardBackwardSearchGraph(&connected, &connectedList, &outgoingHyps, &estimatedScores);
   pruneLatticeFB(connectedList, outgoingHyps, incomingEdges, estimatedScores, manager.GetBestHypothesis(), staticData.GetLatticeMBRPruningFactor(),staticData.GetMBRScale());
-  calcNgramExpectations(connectedList, incomingEdges, ngramExpectations,false);
+  calcNgramExpectations(connectedList, incomingEdges, ngramIds, ngramExpectations,false);
 
   //expected length is sum of expected unigram counts
   //cerr << "Thread " << pthread_self() <<  " Ngram expectations size: " << ngramExpectations.size() << endl;
   float ref_length = 0.0f;
-  for (map<Phrase,float>::const_iterator ref_iter = ngramExpectations.begin();
+  for (NgramExpectations::const_iterator ref_iter = ngramExpectations.begin();
        ref_iter != ngramExpectations.end(); ++ref_iter) {
-    //cerr << "Ngram: " << ref_iter->first << " score: " <<
-    //    ref_iter->second << endl;
-    if (ref_iter->first.GetSize() == 1) {
+    if (ngramIds.GetOrder(ref_iter->first) == 1) {
       ref_length += exp(ref_iter->second);
       //    cerr << "Expected for " << ref_iter->first << " is " << exp(ref_iter->second) << endl;
     }
@@ -591,14 +724,15 @@ const TrellisPath doConsensusDecoding(Manager& manager, TrellisPathList& nBestLi
   for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter) {
     const TrellisPath &path = **iter;
     vector<Word> words;
-    map<Phrase,int> ngrams;
+    boost::unordered_map<NgramId,int> ngrams;
+    vector<int> unknownCounts;
     GetOutputWords(path,words);
     /*for (size_t i = 0; i < words.size(); ++i) {
         cerr << words[i].GetFactor(0)->GetString() << " ";
     }
     cerr << endl;
     */
-    extract_ngrams(words,ngrams);
+    extract_ngrams(words,ngramIds,ngrams,unknownCounts);
 
     vector<float> comps(2*BLEU_ORDER+1);
     float logbleu = 0.0;
@@ -609,11 +743,12 @@ const TrellisPath doConsensusDecoding(Manager& manager, TrellisPathList& nBestLi
       comps[2*i+1] = max(hyp_length-i,0);
     }
 
-    for (map<Phrase,int>::const_iterator hyp_iter = ngrams.begin();
+    //the unknown ngrams have no matches
+    for (boost::unordered_map<NgramId,int>::const_iterator hyp_iter = ngrams.begin();
          hyp_iter != ngrams.end(); ++hyp_iter) {
-      map<Phrase,float>::const_iterator ref_iter = ngramExpectations.find(hyp_iter->first);
+      NgramExpectations::const_iterator ref_iter = ngramExpectations.find(hyp_iter->first);
       if (ref_iter != ngramExpectations.end()) {
-        comps[2*(hyp_iter->first.GetSize()-1)] += min(exp(ref_iter->second), (float)(hyp_iter->second));
+        comps[2*(ngramIds.GetOrder(hyp_iter->first)-1)] += min(exp(ref_iter->second), (float)(hyp_iter->second));
       }
 
     }
@@ -13,6 +13,7 @@
 #include <map>
 #include <vector>
 #include <set>
+#include <boost/unordered_map.hpp>
 #include "Hypothesis.h"
 #include "Manager.h"
 #include "TrellisPathList.h"
@@ -26,7 +27,55 @@ class Edge;
 typedef std::vector< const Hypothesis *> Lattice;
 typedef std::vector<const Edge*> Path;
 typedef std::map<Path, size_t> PathCounts;
-typedef std::map<Phrase, PathCounts > NgramHistory;
+typedef size_t NgramId;
+typedef boost::unordered_map<NgramId, PathCounts > NgramHistory;
+//! log expected count (or posterior) of each n-gram of the lattice
+typedef boost::unordered_map<NgramId, float> NgramExpectations;
+
+/**
+* Interns the n-grams of a lattice. An n-gram is stored as the id of its
+* prefix and its last word, so extending an n-gram by a word is a single hash
+* lookup, and the tables of the forward pass are keyed on ids instead of phrases.
+*/
+class NgramIds
+{
+public:
+  //! the empty n-gram, which all n-grams extend
+  static const NgramId EMPTY = 0;
+
+  NgramIds();
+
+  //! id of prefix followed by word, added if it is new
+  NgramId Extend(NgramId prefix, const Word &word);
+
+  //! id of prefix followed by word, NOT_FOUND if it is not in the table
+  NgramId Find(NgramId prefix, const Word &word) const;
+
+  NgramId GetPrefix(NgramId id) const {
+    return m_entries[id].prefix;
+  }
+
+  const Word &GetLastWord(NgramId id) const {
+    return m_entries[id].word;
+  }
+
+  size_t GetOrder(NgramId id) const {
+    return m_entries[id].order;
+  }
+
+  //! words of the n-gram, for debugging output
+  void GetNgram(NgramId id, Phrase &ngram) const;
+
+private:
+  struct Entry {
+    NgramId prefix;
+    Word word;
+    size_t order;
+  };
+
+  std::vector<Entry> m_entries;
+  boost::unordered_map<std::pair<NgramId, Word>, NgramId> m_ids;
+};
 
 class Edge
 {
@@ -35,9 +84,10 @@ class Edge
   float m_score;
   TargetPhrase m_targetPhrase;
   NgramHistory m_ngrams;
+  bool m_ngramsDone;
 
 public:
-  Edge(const Hypothesis* from, const Hypothesis* to, float score, const TargetPhrase& targetPhrase) : m_tailNode(from), m_headNode(to), m_score(score), m_targetPhrase(targetPhrase) {
+  Edge(const Hypothesis* from, const Hypothesis* to, float score, const TargetPhrase& targetPhrase) : m_tailNode(from), m_headNode(to), m_score(score), m_targetPhrase(targetPhrase), m_ngramsDone(false) {
     //cout << "Creating new edge from Node " << from->GetId() << ", to Node : " << to->GetId() << ", score: " << score << " phrase: " << targetPhrase << endl;
   }
 
@@ -63,37 +113,45 @@ public:
 
   friend std::ostream& operator<< (std::ostream& out, const Edge& edge);
 
-  const NgramHistory&  GetNgrams(  std::map<const Hypothesis*, std::vector<Edge> > & incomingEdges) ;
+  /** ngrams ending on this edge, with the paths they span. Computed on the
+  * first call, after which the edge is only read */
+  const NgramHistory&  GetNgrams(  std::map<const Hypothesis*, std::vector<Edge> > & incomingEdges, NgramIds &ngramIds) ;
 
   bool operator < (const Edge & compare) const;
 
-  void GetPhraseSuffix(const Phrase& origPhrase, size_t lastN, Phrase& targetPhrase) const;
+  //! does the ngram end with the last lastN words of origPhrase?
+  bool EndsWithSuffix(const NgramIds& ngramIds, NgramId ngram, const Phrase& origPhrase, size_t lastN) const;
 
-  void storeNgramHistory(const Phrase& phrase, Path & path, size_t count = 1) {
-    m_ngrams[phrase][path]+= count;
+  void storeNgramHistory(NgramId ngram, Path & path, size_t count = 1) {
+    m_ngrams[ngram][path]+= count;
   }
 
 };
 
 /**
-* Data structure to hold the ngram scores as we traverse the lattice. Maps (hypo,ngram) to score
+* Data structure to hold the ngram scores as we traverse the lattice. Maps (node,ngram) to score,
+* where node is the position of the hypothesis in the lattice. Nodes can be scored by different
+* threads, as long as each node is scored by one of them.
 */
 class NgramScores
 {
 public:
-  NgramScores() {}
+  NgramScores(size_t numNodes) : m_scores(numNodes) {}
 
   /** logsum this score to the existing score */
-  void addScore(const Hypothesis* node, const Phrase& ngram, float score);
+  void addScore(size_t node, NgramId ngram, float score);
 
   /** Iterate through ngrams for selected node */
-  typedef std::map<const Phrase*, float>::const_iterator NodeScoreIterator;
-  NodeScoreIterator nodeBegin(const Hypothesis* node);
-  NodeScoreIterator nodeEnd(const Hypothesis* node);
+  typedef boost::unordered_map<NgramId, float>::const_iterator NodeScoreIterator;
+  NodeScoreIterator nodeBegin(size_t node) const {
+    return m_scores[node].begin();
+  }
+  NodeScoreIterator nodeEnd(size_t node) const {
+    return m_scores[node].end();
+  }
 
 private:
-  std::set<Phrase> m_ngrams;
-  std::map<const Hypothesis*, std::map<const Phrase*, float> > m_scores;
+  std::vector< boost::unordered_map<NgramId, float> > m_scores;
 };
 
 
@@ -117,7 +175,7 @@ public:
   }
 
   /** Initialise ngram scores */
-  void CalcScore(std::map<Phrase, float>& finalNgramScores, const std::vector<float>& thetas, float mapWeight);
+  void CalcScore(const NgramIds& ngramIds, const NgramExpectations& finalNgramScores, const std::vector<float>& thetas, float mapWeight);
 
 private:
   std::vector<Word> m_words;
@@ -138,10 +196,11 @@ void pruneLatticeFB(Lattice & connectedHyp, std::map < const Hypothesis*, std::s
 //Use the ngram scores to rerank the nbest list, return at most n solutions
 void getLatticeMBRNBest(Manager& manager, TrellisPathList& nBestList, std::vector<LatticeMBRSolution>& solutions, size_t n);
 //calculate expectated ngram counts, clipping at 1 (ie calculating posteriors) if posteriors==true.
-void calcNgramExpectations(Lattice & connectedHyp, std::map<const Hypothesis*, std::vector<Edge> >& incomingEdges, std::map<Phrase,
-                           float>& finalNgramScores, bool posteriors);
+void calcNgramExpectations(Lattice & connectedHyp, std::map<const Hypothesis*, std::vector<Edge> >& incomingEdges, NgramIds& ngramIds,
+                           NgramExpectations& finalNgramScores, bool posteriors);
 void GetOutputFactors(const TrellisPath &path, std::vector <Word> &translation);
-void extract_ngrams(const std::vector<Word >& sentence, std::map < Phrase, int >  & allngrams);
+//count the ngrams of sentence that are in ngramIds, and per order the ones that are not.
+void extract_ngrams(const std::vector<Word >& sentence, const NgramIds& ngramIds, boost::unordered_map < NgramId, int >  & allngrams, std::vector<int>& unknownCounts);
 bool ascendingCoverageCmp(const Hypothesis* a, const Hypothesis* b);
 std::vector<Word> doLatticeMBR(Manager& manager, TrellisPathList& nBestList);
 const TrellisPath doConsensusDecoding(Manager& manager, TrellisPathList& nBestList);
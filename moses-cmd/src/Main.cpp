@@ -83,6 +83,12 @@ public:
     m_detailedTranslationCollector(detailedTranslationCollector),
     m_alignmentInfoCollector(alignmentInfoCollector) {}
 
+  //! with -threads-longest-first, long sentences are started first so they
+  //! don't hold up the end of a threaded run
+  int GetPriority() const {
+    return StaticData::Instance().ThreadsLongestFirst() ? m_source->GetSize() : 0;
+  }
+
 	/** Translate one sentence
    * gets called by main function implemented at end of this source file */
   void Run() {
@@ -496,6 +502,13 @@ int main(int argc, char** argv)
   pool.Stop(true); //flush remaining jobs
 #endif
 
+  IFVERBOSE(1) {
+    if (staticData.GetUseTransOptCache()) {
+      TRACE_ERR("Persistent translation option cache: " << staticData.GetTransOptCache().GetHits() << " hits, "
+                << staticData.GetTransOptCache().GetMisses() << " misses" << endl);
+    }
+  }
+
 #ifndef EXIT_RETURN
   //This avoids that destructors are called (it can take a long time)
   exit(EXIT_SUCCESS);
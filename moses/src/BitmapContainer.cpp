@@ -90,6 +90,55 @@ public:
 
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// HypothesisQueue Code
+////////////////////////////////////////////////////////////////////////////////
+
+void
+HypothesisQueue::Push(const HypothesisQueueItem &item)
+{
+  // sift up from the new leaf, moving parents down into the hole
+  m_items.push_back(item);
+  size_t hole = m_items.size() - 1;
+  while (hole > 0) {
+    size_t parent = (hole - 1) / s_arity;
+    if (!(m_items[parent].GetScore() < item.GetScore()))
+      break;
+    m_items[hole] = m_items[parent];
+    hole = parent;
+  }
+  m_items[hole] = item;
+}
+
+void
+HypothesisQueue::Pop()
+{
+  // sift the last item down from the root, moving the best child up each time
+  const HypothesisQueueItem last = m_items.back();
+  m_items.pop_back();
+  const size_t size = m_items.size();
+  if (size == 0)
+    return;
+
+  size_t hole = 0;
+  while (true) {
+    size_t child = hole * s_arity + 1;
+    if (child >= size)
+      break;
+    size_t best = child;
+    const size_t end = std::min(child + s_arity, size);
+    for (++child; child < end; ++child) {
+      if (m_items[best].GetScore() < m_items[child].GetScore())
+        best = child;
+    }
+    if (!(last.GetScore() < m_items[best].GetScore()))
+      break;
+    m_items[hole] = m_items[best];
+    hole = best;
+  }
+  m_items[hole] = last;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // BackwardsEdge Code
 ////////////////////////////////////////////////////////////////////////////////
@@ -106,6 +155,7 @@ BackwardsEdge::BackwardsEdge(const BitmapContainer &prevBitmapContainer
   , m_translations(translations)
   , m_futurescore(futureScore)
   , m_seenPosition()
+  , m_seenRowSize((translations.size() + 63) / 64)
 {
 
   // If either dimension is empty, we haven't got anything to do.
@@ -195,17 +245,21 @@ Hypothesis *BackwardsEdge::CreateHypothesis(const Hypothesis &hypothesis, const
 bool
 BackwardsEdge::SeenPosition(const size_t x, const size_t y)
 {
-  std::set< int >::iterator iter = m_seenPosition.find((x<<16) + y);
-  return (iter != m_seenPosition.end());
+  const size_t block = x * m_seenRowSize + (y >> 6);
+  return block < m_seenPosition.size() && (m_seenPosition[block] >> (y & 63)) & 1;
 }
 
 void
 BackwardsEdge::SetSeenPosition(const size_t x, const size_t y)
 {
-  assert(x < (1<<17));
-  assert(y < (1<<17));
+  assert(x < m_hypotheses.size());
+  assert(y < m_translations.size());
 
-  m_seenPosition.insert((x<<16) + y);
+  const size_t block = x * m_seenRowSize + (y >> 6);
+  if (block >= m_seenPosition.size()) {
+    m_seenPosition.resize((x + 1) * m_seenRowSize, 0);
+  }
+  m_seenPosition[block] |= (UINT64)1 << (y & 63);
 }
 
 
@@ -261,14 +315,10 @@ BitmapContainer::BitmapContainer(const WordsBitmap &bitmap
 
 BitmapContainer::~BitmapContainer()
 {
-  // As we have created the square position objects we clean up now.
-  HypothesisQueueItem *item = NULL;
-
-  while (!m_queue.empty()) {
-    item = m_queue.top();
-    FREEHYPO(item->GetHypothesis());
-    delete item;
-    m_queue.pop();
+  // Free the hypotheses still waiting in the queue.
+  while (!m_queue.Empty()) {
+    FREEHYPO(m_queue.Top().GetHypothesis());
+    m_queue.Pop();
   }
 
   // Delete all edges.
@@ -280,50 +330,33 @@ BitmapContainer::~BitmapContainer()
 
 
 void
-BitmapContainer::Enqueue(int hypothesis_pos
-                         , int translation_pos
+BitmapContainer::Enqueue(size_t hypothesis_pos
+                         , size_t translation_pos
                          , Hypothesis *hypothesis
                          , BackwardsEdge *edge)
 {
-  HypothesisQueueItem *item = new HypothesisQueueItem(hypothesis_pos
-      , translation_pos
-      , hypothesis
-      , edge);
-  m_queue.push(item);
+  m_queue.Push(HypothesisQueueItem(hypothesis_pos
+                                   , translation_pos
+                                   , hypothesis
+                                   , edge));
 }
 
-HypothesisQueueItem*
-BitmapContainer::Dequeue(bool keepValue)
-{
-  if (!m_queue.empty()) {
-    HypothesisQueueItem *item = m_queue.top();
-
-    if (!keepValue) {
-      m_queue.pop();
-    }
-
-    return item;
-  }
-
-  return NULL;
-}
-
-HypothesisQueueItem*
+const HypothesisQueueItem&
 BitmapContainer::Top() const
 {
-  return m_queue.top();
+  return m_queue.Top();
 }
 
 size_t
 BitmapContainer::Size()
 {
-  return m_queue.size();
+  return m_queue.Size();
 }
 
 bool
 BitmapContainer::Empty() const
 {
-  return m_queue.empty();
+  return m_queue.Empty();
 }
 
 
@@ -374,7 +407,7 @@ BitmapContainer::AddHypothesis(Hypothesis *hypothesis)
 void
 BitmapContainer::AddBackwardsEdge(BackwardsEdge *edge)
 {
-  m_edges.insert(edge);
+  m_edges.push_back(edge);
 }
 
 void
@@ -402,30 +435,25 @@ BitmapContainer::EnsureMinStackHyps(const size_t minNumHyps)
 void
 BitmapContainer::ProcessBestHypothesis()
 {
-  if (m_queue.empty()) {
+  if (m_queue.Empty()) {
     return;
   }
 
   // Get the currently best hypothesis from the queue.
-  HypothesisQueueItem *item = Dequeue();
-
-  // If the priority queue is exhausted, we are done and should have exited
-  assert(item != NULL);
+  const HypothesisQueueItem item = m_queue.Top();
+  m_queue.Pop();
 
   // check we are pulling things off of priority queue in right order
-  if (!Empty()) {
-    HypothesisQueueItem *check = Dequeue(true);
-    assert(item->GetHypothesis()->GetTotalScore() >= check->GetHypothesis()->GetTotalScore());
-  }
+  assert(m_queue.Empty() || item.GetScore() >= m_queue.Top().GetScore());
 
   // Logging for the criminally insane
   IFVERBOSE(3) {
     //		const StaticData &staticData = StaticData::Instance();
-    item->GetHypothesis()->PrintHypothesis();
+    item.GetHypothesis()->PrintHypothesis();
   }
 
   // Add best hypothesis to hypothesis stack.
-  const bool newstackentry = m_stack.AddPrune(item->GetHypothesis());
+  const bool newstackentry = m_stack.AddPrune(item.GetHypothesis());
   if (newstackentry)
     m_numStackInsertions++;
 
@@ -434,10 +462,7 @@ BitmapContainer::ProcessBestHypothesis()
   }
 
   // Create new hypotheses for the two successors of the hypothesis just added.
-  item->GetBackwardsEdge()->PushSuccessors(item->GetHypothesisPos(), item->GetTranslationPos());
-
-  // We are done with the queue item, we delete it.
-  delete item;
+  item.GetBackwardsEdge()->PushSuccessors(item.GetHypothesisPos(), item.GetTranslationPos());
 }
 
 void
@@ -22,8 +22,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_BitmapContainer_h
 #define moses_BitmapContainer_h
 
-#include <queue>
-#include <set>
 #include <vector>
 
 #include "Hypothesis.h"
@@ -40,12 +38,9 @@ class BitmapContainer;
 class BackwardsEdge;
 class Hypothesis;
 class HypothesisStackCubePruning;
-class HypothesisQueueItem;
-class QueueItemOrderer;
 
 typedef std::vector< Hypothesis* > HypothesisSet;
-typedef std::set< BackwardsEdge* > BackwardsEdgeSet;
-typedef std::priority_queue< HypothesisQueueItem*, std::vector< HypothesisQueueItem* >, QueueItemOrderer> HypothesisQueue;
+typedef std::vector< BackwardsEdge* > BackwardsEdgeSet;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Hypothesis Priority Queue Code
@@ -54,6 +49,7 @@ typedef std::priority_queue< HypothesisQueueItem*, std::vector< HypothesisQueueI
 class HypothesisQueueItem
 {
 private:
+  float m_score; // total score of m_hypothesis, kept here for the heap comparisons
   size_t m_hypothesis_pos, m_translation_pos;
   Hypothesis *m_hypothesis;
   BackwardsEdge *m_edge;
@@ -65,55 +61,59 @@ public:
                       , const size_t translation_pos
                       , Hypothesis *hypothesis
                       , BackwardsEdge *edge)
-    : m_hypothesis_pos(hypothesis_pos)
+    : m_score(hypothesis->GetTotalScore())
+    , m_hypothesis_pos(hypothesis_pos)
     , m_translation_pos(translation_pos)
     , m_hypothesis(hypothesis)
     , m_edge(edge) {
   }
 
-  ~HypothesisQueueItem() {
+  float GetScore() const {
+    return m_score;
   }
 
-  int GetHypothesisPos() {
+  size_t GetHypothesisPos() const {
     return m_hypothesis_pos;
   }
 
-  int GetTranslationPos() {
+  size_t GetTranslationPos() const {
     return m_translation_pos;
   }
 
-  Hypothesis *GetHypothesis() {
+  Hypothesis *GetHypothesis() const {
     return m_hypothesis;
   }
 
-  BackwardsEdge *GetBackwardsEdge() {
+  BackwardsEdge *GetBackwardsEdge() const {
     return m_edge;
   }
 };
 
-// Allows to compare two HypothesisQueueItem objects by the corresponding scores.
-class QueueItemOrderer
+// Max-heap of queue items by score, with four children per node.  The items
+// are held by value in one vector whose memory is kept when they are popped,
+// so once a container's queue has grown, pushing and popping don't allocate,
+// and comparisons don't follow pointers to the hypotheses.
+class HypothesisQueue
 {
+private:
+  static const size_t s_arity = 4;
+  std::vector< HypothesisQueueItem > m_items;
+
 public:
-  bool operator()(HypothesisQueueItem* itemA, HypothesisQueueItem* itemB) const {
-    float scoreA = itemA->GetHypothesis()->GetTotalScore();
-    float scoreB = itemB->GetHypothesis()->GetTotalScore();
+  bool Empty() const {
+    return m_items.empty();
+  }
 
-    return (scoreA < scoreB);
+  size_t Size() const {
+    return m_items.size();
+  }
 
-    /*
-    {
-    	return true;
-    }
-    else if (scoreA < scoreB)
-    {
-    	return false;
-    }
-    else
-    {
-    	return itemA < itemB;
-    }*/
+  const HypothesisQueueItem &Top() const {
+    return m_items.front();
   }
+
+  void Push(const HypothesisQueueItem &item);
+  void Pop();
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -163,7 +163,11 @@ private:
   const SquareMatrix &m_futurescore;
 
   std::vector< const Hypothesis* > m_hypotheses;
-  std::set< int > m_seenPosition;
+
+  // One bit per cube cell, row x holding the cells that expand m_hypotheses[x].
+  // Rows are only allocated as far down as the search has gone.
+  std::vector< UINT64 > m_seenPosition;
+  size_t m_seenRowSize; // in 64-bit blocks
 
   // We don't want to instantiate "empty" objects.
   BackwardsEdge();
@@ -219,9 +223,8 @@ public:
   // connected to this BitmapContainer.
   ~BitmapContainer();
 
-  void Enqueue(int hypothesis_pos, int translation_pos, Hypothesis *hypothesis, BackwardsEdge *edge);
-  HypothesisQueueItem *Dequeue(bool keepValue=false);
-  HypothesisQueueItem *Top() const;
+  void Enqueue(size_t hypothesis_pos, size_t translation_pos, Hypothesis *hypothesis, BackwardsEdge *edge);
+  const HypothesisQueueItem &Top() const;
   size_t Size();
   bool Empty() const;
 
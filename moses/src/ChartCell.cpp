@@ -43,6 +43,7 @@ ChartCell::ChartCell(size_t startPos, size_t endPos, ChartManager &manager)
   ,m_sourceWordLabel(NULL)
   ,m_targetLabelSet(m_coverage)
   ,m_manager(manager)
+  ,m_hypothesisId(0)
 {
   const StaticData &staticData = StaticData::Instance();
   m_nBestIsEnabled = staticData.IsNBestEnabled();
@@ -159,6 +160,29 @@ void ChartCell::CleanupArcList()
   }
 }
 
+/** Shift the ids of all remaining hypotheses, including recombined ones,
+ * that were numbered by this cell */
+void ChartCell::OffsetHypothesisIds(unsigned offset)
+{
+  std::map<Word, ChartHypothesisCollection>::iterator iter;
+  for (iter = m_hypoColl.begin(); iter != m_hypoColl.end(); ++iter) {
+    const ChartHypothesisCollection &coll = iter->second;
+    ChartHypothesisCollection::const_iterator iterHypo;
+    for (iterHypo = coll.begin(); iterHypo != coll.end(); ++iterHypo) {
+      ChartHypothesis *hypo = *iterHypo;
+      hypo->OffsetId(offset);
+
+      const ChartArcList *arcList = hypo->GetArcList();
+      if (arcList) {
+        ChartArcList::const_iterator iterArc;
+        for (iterArc = arcList->begin(); iterArc != arcList->end(); ++iterArc) {
+          (*iterArc)->OffsetId(offset);
+        }
+      }
+    }
+  }
+}
+
 void ChartCell::OutputSizes(std::ostream &out) const
 {
   std::map<Word, ChartHypothesisCollection>::const_iterator iter;
@@ -55,6 +55,7 @@ protected:
 
   bool m_nBestIsEnabled; /**< flag to determine whether to keep track of old arcs */
   ChartManager &m_manager;
+  unsigned m_hypothesisId; /**< hypotheses numbered by this cell, see ChartManager::GetNextHypoId() */
 
 public:
   ChartCell(size_t startPos, size_t endPos, ChartManager &manager);
@@ -82,6 +83,14 @@ public:
 
   void CleanupArcList();
 
+  unsigned GetNextHypoId() {
+    return m_hypothesisId++;
+  }
+  unsigned GetNumHyposCreated() const {
+    return m_hypothesisId;
+  }
+  void OffsetHypothesisIds(unsigned offset);
+
   void OutputSizes(std::ostream &out) const;
   size_t GetSize() const;
 
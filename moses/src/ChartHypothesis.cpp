@@ -21,6 +21,7 @@
 
 #include <algorithm>
 #include <vector>
+#include <boost/functional/hash.hpp>
 #include "ChartHypothesis.h"
 #include "RuleCubeItem.h"
 #include "ChartCell.h"
@@ -51,7 +52,8 @@ ChartHypothesis::ChartHypothesis(const ChartTranslationOption &transOpt,
   ,m_arcList(NULL)
   ,m_winningHypo(NULL)
   ,m_manager(manager)
-  ,m_id(manager.GetNextHypoId())
+  ,m_recombinationHash(0)
+  ,m_id(manager.GetNextHypoId(m_currSourceWordsRange))
 {
   // underlying hypotheses for sub-spans
   const std::vector<HypothesisDimension> &childEntries = item.GetHypothesisDimensions();
@@ -170,6 +172,12 @@ void ChartHypothesis::CalcScore()
 		m_ffStates[i] = ffs[i]->EvaluateChart(*this,i,&m_scoreBreakdown);
   }
 
+  size_t seed = 0;
+  for (unsigned i = 0; i < m_ffStates.size(); ++i) {
+    boost::hash_combine(seed, m_ffStates[i] ? m_ffStates[i]->Hash() : 0);
+  }
+  m_recombinationHash = seed;
+
   m_totalScore	= m_scoreBreakdown.GetWeightedScore();
 }
 
@@ -67,6 +67,7 @@ protected:
   std::vector<const ChartHypothesis*> m_prevHypos;
 
   ChartManager& m_manager;
+  size_t m_recombinationHash; /*! hash of the feature function states, consistent with RecombineCompare() */
 
   unsigned m_id; /* pkoehn wants to log the order in which hypotheses were generated */
 
@@ -95,6 +96,7 @@ public:
   ~ChartHypothesis();
 
   unsigned GetId() const { return m_id; }
+  void OffsetId(unsigned offset) { m_id += offset; }
 
   const ChartTranslationOption &GetTranslationOption()const {
     return m_transOpt;
@@ -117,6 +119,9 @@ public:
   Phrase GetOutputPhrase() const;
 
 	int RecombineCompare(const ChartHypothesis &compare) const;
+  size_t GetRecombinationHash() const {
+    return m_recombinationHash;
+  }
 
   void CalcScore();
 
@@ -55,7 +55,7 @@ bool ChartHypothesisCollection::AddHypothesis(ChartHypothesis *hypo, ChartManage
 {
   if (hypo->GetTotalScore() < m_bestScore + m_beamWidth) {
     // really bad score. don't bother adding hypo into collection
-    manager.GetSentenceStats().AddDiscarded();
+    manager.AddDiscarded();
     VERBOSE(3,"discarded, too bad for stack" << std::endl);
     ChartHypothesis::Delete(hypo);
     return false;
@@ -75,13 +75,14 @@ bool ChartHypothesisCollection::AddHypothesis(ChartHypothesis *hypo, ChartManage
   ChartHypothesis *hypoExisting = *iterExisting;
   assert(iterExisting != m_hypos.end());
 
-  //StaticData::Instance().GetSentenceStats().AddRecombination(*hypo, **iterExisting);
-
   // found existing hypo with same target ending.
   // keep the best 1
   if (hypo->GetTotalScore() > hypoExisting->GetTotalScore()) {
     // incoming hypo is better than the one we have
     VERBOSE(3,"better than matching hyp " << hypoExisting->GetId() << ", recombining, ");
+    IFVERBOSE(1) {
+      manager.AddRecombination(*hypoExisting, *hypo);
+    }
     if (m_nBestIsEnabled) {
       hypo->AddArc(hypoExisting);
       Detach(iterExisting);
@@ -99,6 +100,9 @@ bool ChartHypothesisCollection::AddHypothesis(ChartHypothesis *hypo, ChartManage
   } else {
     // already storing the best hypo. discard current hypo
     VERBOSE(3,"worse than matching hyp " << hypoExisting->GetId() << ", recombining" << std::endl)
+    IFVERBOSE(1) {
+      manager.AddRecombination(*hypo, *hypoExisting);
+    }
     if (m_nBestIsEnabled) {
       hypoExisting->AddArc(hypo);
     } 
@@ -196,7 +200,7 @@ void ChartHypothesisCollection::PruneToSize(ChartManager &manager)
       if (score < scoreThreshold) {
         HCType::iterator iterRemove = iter++;
         Remove(iterRemove);
-        manager.GetSentenceStats().AddPruning();
+        manager.AddPruning();
       } else {
         ++iter;
       }
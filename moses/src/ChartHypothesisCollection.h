@@ -20,7 +20,7 @@
  ***********************************************************************/
 #pragma once
 
-#include <set>
+#include <boost/unordered_set.hpp>
 #include "ChartHypothesis.h"
 #include "RuleCube.h"
 
@@ -57,13 +57,33 @@ public:
   }
 };
 
+/** hash and equality predicate for the hashed recombination set.
+ * RecombineCompare() is only called when the precomputed hashes match
+ */
+class ChartHypothesisRecombinationHasher
+{
+public:
+  size_t operator()(const ChartHypothesis* hypo) const {
+    return hypo->GetRecombinationHash();
+  }
+};
+
+class ChartHypothesisRecombinationEqualityPred
+{
+public:
+  bool operator()(const ChartHypothesis* hypoA, const ChartHypothesis* hypoB) const {
+    return hypoA->GetRecombinationHash() == hypoB->GetRecombinationHash()
+           && hypoA->RecombineCompare(*hypoB) == 0;
+  }
+};
+
 // 1 of these for each target LHS in each cell
 class ChartHypothesisCollection
 {
   friend std::ostream& operator<<(std::ostream&, const ChartHypothesisCollection&);
 
 protected:
-  typedef std::set<ChartHypothesis*, ChartHypothesisRecombinationOrderer> HCType;
+  typedef boost::unordered_set<ChartHypothesis*, ChartHypothesisRecombinationHasher, ChartHypothesisRecombinationEqualityPred> HCType;
   HCType m_hypos;
   HypoList m_hyposOrdered;
 
@@ -28,6 +28,7 @@
 #include "ChartTrellisPathCollection.h"
 #include "StaticData.h"
 #include "DecodeStep.h"
+#include "ThreadPool.h"
 
 using namespace std;
 using namespace Moses;
@@ -36,6 +37,29 @@ namespace Moses
 {
 extern bool g_debug;
 
+#ifdef WITH_THREADS
+/** processes every numChunks-th cell of a span width, starting at the chunk,
+ * see ChartManager::ProcessCellsInParallel() */
+class ProcessCells
+{
+public:
+  ProcessCells(ChartManager &manager, size_t width, size_t numChunks)
+    : m_manager(manager), m_width(width), m_numChunks(numChunks)
+  {}
+
+  void operator()(size_t chunk) {
+    size_t size = m_manager.m_source.GetSize();
+    for (size_t startPos = chunk; startPos <= size-m_width; startPos += m_numChunks) {
+      m_manager.ProcessCell(startPos, startPos + m_width - 1);
+    }
+  }
+
+private:
+  ChartManager &m_manager;
+  size_t m_width, m_numChunks;
+};
+#endif
+
 ChartManager::ChartManager(InputType const& source, const TranslationSystem* system)
   :m_source(source)
   ,m_hypoStackColl(source, *this)
@@ -43,7 +67,15 @@ ChartManager::ChartManager(InputType const& source, const TranslationSystem* sys
   ,m_system(system)
   ,m_start(clock())
   ,m_hypothesisId(0)
+  ,m_numCellThreads(1)
+  ,m_cellLocalHypoIds(false)
 {
+  const StaticData &staticData = StaticData::Instance();
+  // hypothesis logging is not thread-safe
+  if (staticData.GetVerboseLevel() < 2) {
+    m_numCellThreads = staticData.SearchThreadCount();
+  }
+
   m_system->InitializeBeforeSentenceProcessing(source);
   const std::vector<PhraseDictionaryFeature*> &dictionaries = m_system->GetPhraseDictionaries();
   m_ruleLookupManagers.reserve(dictionaries.size());
@@ -81,28 +113,15 @@ void ChartManager::ProcessSentence()
   // MAIN LOOP
   size_t size = m_source.GetSize();
   for (size_t width = 1; width <= size; ++width) {
+#ifdef WITH_THREADS
+    // all cells of the same width only depend on narrower cells
+    if (m_numCellThreads > 1 && size-width > 0) {
+      ProcessCellsInParallel(width);
+      continue;
+    }
+#endif
     for (size_t startPos = 0; startPos <= size-width; ++startPos) {
-      size_t endPos = startPos + width - 1;
-      WordsRange range(startPos, endPos);
-      //TRACE_ERR(" " << range << "=");
-
-      // create trans opt
-      m_transOptColl.CreateTranslationOptionsForRange(startPos, endPos);
-      //if (g_debug)
-      //	cerr << m_transOptColl.GetTranslationOptionList(WordsRange(startPos, endPos));
-
-      // decode
-      ChartCell &cell = m_hypoStackColl.Get(range);
-
-      cell.ProcessSentence(m_transOptColl.GetTranslationOptionList(range)
-                           ,m_hypoStackColl);
-      cell.PruneToSize();
-      cell.CleanupArcList();
-      cell.SortHypotheses();
-
-      //cerr << cell.GetSize();
-      //cerr << cell << endl;
-      //cell.OutputSizes(cerr);
+      ProcessCell(startPos, startPos + width - 1);
     }
   }
 
@@ -124,9 +143,85 @@ void ChartManager::ProcessSentence()
       }
       cerr << endl;
     }
+    cerr << "Recombined " << m_sentenceStats->GetNumHyposRecombined()
+         << " of " << m_hypothesisId << " hypotheses" << endl;
   }
 }
 
+/** Decoding of one span: collect the applicable rules and fill its chart cell */
+void ChartManager::ProcessCell(size_t startPos, size_t endPos)
+{
+  WordsRange range(startPos, endPos);
+  //TRACE_ERR(" " << range << "=");
+
+  // create trans opt
+  m_transOptColl.CreateTranslationOptionsForRange(startPos, endPos);
+  //if (g_debug)
+  //	cerr << m_transOptColl.GetTranslationOptionList(WordsRange(startPos, endPos));
+
+  // decode
+  ChartCell &cell = m_hypoStackColl.Get(range);
+
+  cell.ProcessSentence(m_transOptColl.GetTranslationOptionList(range)
+                       ,m_hypoStackColl);
+  cell.PruneToSize();
+  cell.CleanupArcList();
+  cell.SortHypotheses();
+
+  //cerr << cell.GetSize();
+  //cerr << cell << endl;
+  //cell.OutputSizes(cerr);
+}
+
+#ifdef WITH_THREADS
+/**
+ * Process the cells of one span width concurrently, each thread taking every
+ * n-th cell. The cells number their hypotheses from 0; afterwards they are
+ * renumbered in the order of the serial search, so the hypothesis ids, and
+ * with them the search graph, don't depend on the number of threads
+ */
+void ChartManager::ProcessCellsInParallel(size_t width)
+{
+  size_t size = m_source.GetSize();
+  const size_t numChunks = std::min(m_numCellThreads, size-width+1);
+
+  m_cellLocalHypoIds = true;
+  RunShares(StaticData::Instance().GetSearchThreadPool(), numChunks, ProcessCells(*this, width, numChunks));
+  m_cellLocalHypoIds = false;
+
+  for (size_t startPos = 0; startPos <= size-width; ++startPos) {
+    ChartCell &cell = m_hypoStackColl.Get(WordsRange(startPos, startPos + width - 1));
+    cell.OffsetHypothesisIds(m_hypothesisId);
+    m_hypothesisId += cell.GetNumHyposCreated();
+  }
+}
+#endif
+
+void ChartManager::AddDiscarded()
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_sentenceStatsMutex);
+#endif
+  m_sentenceStats->AddDiscarded();
+}
+
+void ChartManager::AddRecombination(const ChartHypothesis &worseHypo, const ChartHypothesis &betterHypo)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_sentenceStatsMutex);
+#endif
+  m_sentenceStats->AddRecombination(worseHypo.GetCurrSourceRange().GetNumWordsCovered()
+                                    ,betterHypo.GetTotalScore(), worseHypo.GetTotalScore());
+}
+
+void ChartManager::AddPruning()
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_sentenceStatsMutex);
+#endif
+  m_sentenceStats->AddPruning();
+}
+
 const ChartHypothesis *ChartManager::GetBestHypothesis() const
 {
   size_t size = m_source.GetSize();
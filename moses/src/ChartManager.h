@@ -32,14 +32,21 @@
 #include "TranslationSystem.h"
 #include "ChartRuleLookupManager.h"
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 namespace Moses
 {
 
 class ChartHypothesis;
 class ChartTrellisPathList;
+class ProcessCells;
 
 class ChartManager
 {
+  friend class ProcessCells;
+
 private:
   InputType const& m_source; /**< source sentence to be translated */
   ChartCellCollection m_hypoStackColl;
@@ -49,6 +56,16 @@ private:
   clock_t m_start; /**< starting time, used for logging */
   std::vector<ChartRuleLookupManager*> m_ruleLookupManagers;
   unsigned m_hypothesisId; /* For handing out hypothesis ids to ChartHypothesis */
+  size_t m_numCellThreads; /**< threads processing the cells of one span width, 1 if serial */
+  bool m_cellLocalHypoIds; /**< cells number their own hypotheses, see ProcessCellsInParallel() */
+#ifdef WITH_THREADS
+  boost::mutex m_sentenceStatsMutex;
+#endif
+
+  void ProcessCell(size_t startPos, size_t endPos);
+#ifdef WITH_THREADS
+  void ProcessCellsInParallel(size_t width);
+#endif
 
 public:
   ChartManager(InputType const& source, const TranslationSystem* system);
@@ -78,7 +95,15 @@ public:
     m_sentenceStats = std::auto_ptr<SentenceStats>(new SentenceStats(source));
   }
 
-  unsigned GetNextHypoId() { return m_hypothesisId++; }
+  unsigned GetNextHypoId(const WordsRange &range) {
+    return m_cellLocalHypoIds ? m_hypoStackColl.Get(range).GetNextHypoId() : m_hypothesisId++;
+  }
+
+  //! sentence statistics that may be updated by the threads processing cells
+  void AddDiscarded();
+  void AddPruning();
+  //! only called at verbose level 1 and above, where the count is printed
+  void AddRecombination(const ChartHypothesis &worseHypo, const ChartHypothesis &betterHypo);
 };
 
 }
@@ -46,7 +46,7 @@ ChartRuleLookupManagerMemory::ChartRuleLookupManagerMemory(
 
   for (size_t ind = 0; ind < m_dottedRuleColls.size(); ++ind) {
 #ifdef USE_BOOST_POOL
-    DottedRuleInMemory *initDottedRule = m_dottedRulePool.malloc();
+    DottedRuleInMemory *initDottedRule = MallocDottedRule();
     new (initDottedRule) DottedRuleInMemory(rootNode);
 #else
     DottedRuleInMemory *initDottedRule = new DottedRuleInMemory(rootNode);
@@ -104,7 +104,7 @@ void ChartRuleLookupManagerMemory::GetChartRuleCollection(
       if (node != NULL) {
 				// create the rule
 #ifdef USE_BOOST_POOL
-        DottedRuleInMemory *dottedRule = m_dottedRulePool.malloc();
+        DottedRuleInMemory *dottedRule = MallocDottedRule();
         new (dottedRule) DottedRuleInMemory(*node, sourceWordLabel,
                                             prevDottedRule);
 #else
@@ -173,6 +173,16 @@ void ChartRuleLookupManagerMemory::GetChartRuleCollection(
   outColl.CreateChartRules(rulesLimit);
 }
 
+#ifdef USE_BOOST_POOL
+DottedRuleInMemory *ChartRuleLookupManagerMemory::MallocDottedRule()
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_dottedRulePoolMutex);
+#endif
+  return m_dottedRulePool.malloc();
+}
+#endif
+
 // Given a partial rule application ending at startPos-1 and given the sets of
 // source and target non-terminals covering the span [startPos, endPos],
 // determines the full or partial rule applications that can be produced through
@@ -238,7 +248,7 @@ void ChartRuleLookupManagerMemory::ExtendPartialRuleApplication(
 
         // create new rule
 #ifdef USE_BOOST_POOL
-        DottedRuleInMemory *rule = m_dottedRulePool.malloc();
+        DottedRuleInMemory *rule = MallocDottedRule();
         new (rule) DottedRuleInMemory(*child, cellLabel, prevDottedRule);
 #else
         DottedRuleInMemory *rule = new DottedRuleInMemory(*child, cellLabel,
@@ -270,7 +280,7 @@ void ChartRuleLookupManagerMemory::ExtendPartialRuleApplication(
       // create new rule
       const PhraseDictionaryNodeSCFG &child = p->second;
 #ifdef USE_BOOST_POOL
-      DottedRuleInMemory *rule = m_dottedRulePool.malloc();
+      DottedRuleInMemory *rule = MallocDottedRule();
       new (rule) DottedRuleInMemory(child, *cellLabel, prevDottedRule);
 #else
       DottedRuleInMemory *rule = new DottedRuleInMemory(child, *cellLabel,
@@ -27,6 +27,9 @@
 #include "config.h"
 #ifdef USE_BOOST_POOL
 #include <boost/pool/object_pool.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
 #endif
 #endif
 
@@ -73,6 +76,13 @@ private:
   // allocate a lot of them and this has been seen to significantly improve
   // performance, especially for multithreaded decoding.
   boost::object_pool<DottedRuleInMemory> m_dottedRulePool;
+#ifdef WITH_THREADS
+  // Spans with different start positions are independent and may be looked
+  // up concurrently, but they share the pool.
+  boost::mutex m_dottedRulePoolMutex;
+#endif
+
+  DottedRuleInMemory *MallocDottedRule();
 #endif
 };
 
@@ -120,9 +120,10 @@ void ChartRuleLookupManagerOnDisk::GetChartRuleCollection(
           //const Word &sourceWord = node->GetSourceWord();
           DottedRuleOnDisk *dottedRule = new DottedRuleOnDisk(*node, sourceWordLabel, prevDottedRule);
           expandableDottedRuleList.Add(relEndPos+1, dottedRule);
+          node->Prefetch(m_dbWrapper);
 
           // cache for cleanup
-          m_sourcePhraseNode.push_back(node);
+          AddSourcePhraseNode(node);
         }
 
         delete sourceWordBerkeleyDb;
@@ -199,8 +200,9 @@ void ChartRuleLookupManagerOnDisk::GetChartRuleCollection(
           //const Word &sourceWord = node->GetSourceWord();
           DottedRuleOnDisk *dottedRule = new DottedRuleOnDisk(*node, cellLabel, prevDottedRule);
           expandableDottedRuleList.Add(stackInd, dottedRule);
+          node->Prefetch(m_dbWrapper);
 
-          m_sourcePhraseNode.push_back(node);
+          AddSourcePhraseNode(node);
         }
       } // for (iterChartNonTerm
 
@@ -236,8 +238,8 @@ void ChartRuleLookupManagerOnDisk::GetChartRuleCollection(
         const OnDiskPt::PhraseNode *node = prevNode.GetChild(*sourceLHSBerkeleyDb, m_dbWrapper);
         if (node) {
           UINT64 tpCollFilePos = node->GetValue();
-          std::map<UINT64, const TargetPhraseCollection*>::const_iterator iterCache = m_cache.find(tpCollFilePos);
-          if (iterCache == m_cache.end()) {
+          targetPhraseCollection = FindInCache(tpCollFilePos);
+          if (targetPhraseCollection == NULL) {
 
             const OnDiskPt::TargetPhraseCollection *tpcollBerkeleyDb = node->GetTargetPhraseCollection(m_dictionary.GetTableLimit(), m_dbWrapper);
 
@@ -252,10 +254,7 @@ void ChartRuleLookupManagerOnDisk::GetChartRuleCollection(
                                                , m_dbWrapper.GetVocab());
 
             delete tpcollBerkeleyDb;
-            m_cache[tpCollFilePos] = targetPhraseCollection;
-          } else {
-            // just get out of cache
-            targetPhraseCollection = iterCache->second;
+            targetPhraseCollection = AddToCache(tpCollFilePos, targetPhraseCollection);
           }
 
           assert(targetPhraseCollection);
@@ -277,4 +276,35 @@ void ChartRuleLookupManagerOnDisk::GetChartRuleCollection(
   //cerr << numDerivations << " ";
 }
 
+const TargetPhraseCollection *ChartRuleLookupManagerOnDisk::FindInCache(UINT64 tpCollFilePos)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_accessLock);
+#endif
+  std::map<UINT64, const TargetPhraseCollection*>::const_iterator iterCache = m_cache.find(tpCollFilePos);
+  return (iterCache == m_cache.end()) ? NULL : iterCache->second;
+}
+
+const TargetPhraseCollection *ChartRuleLookupManagerOnDisk::AddToCache(UINT64 tpCollFilePos, const TargetPhraseCollection *targetPhraseCollection)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_accessLock);
+#endif
+  std::pair<std::map<UINT64, const TargetPhraseCollection*>::iterator, bool> ret
+  = m_cache.insert(std::make_pair(tpCollFilePos, targetPhraseCollection));
+  if (!ret.second) {
+    // another cell converted the same collection in the meantime
+    delete targetPhraseCollection;
+  }
+  return ret.first->second;
+}
+
+void ChartRuleLookupManagerOnDisk::AddSourcePhraseNode(const OnDiskPt::PhraseNode *node)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_accessLock);
+#endif
+  m_sourcePhraseNode.push_back(node);
+}
+
 } // namespace Moses
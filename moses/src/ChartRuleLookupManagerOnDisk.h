@@ -29,6 +29,10 @@
 #include "InputType.h"
 #include "PhraseDictionaryOnDisk.h"
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 namespace Moses
 {
 
@@ -65,6 +69,16 @@ private:
   std::vector<DottedRuleStackOnDisk*> m_expandableDottedRuleListVec;
   std::map<UINT64, const TargetPhraseCollection*> m_cache;
   std::list<const OnDiskPt::PhraseNode*> m_sourcePhraseNode;
+#ifdef WITH_THREADS
+  // Cells of the same width may be processed concurrently. Each uses the
+  // dotted rules of its own start position, but they share the caches above.
+  boost::mutex m_accessLock;
+#endif
+
+  const TargetPhraseCollection *FindInCache(UINT64 tpCollFilePos);
+  //! returns the cached collection, which is not targetPhraseCollection if another cell added one first
+  const TargetPhraseCollection *AddToCache(UINT64 tpCollFilePos, const TargetPhraseCollection *targetPhraseCollection);
+  void AddSourcePhraseNode(const OnDiskPt::PhraseNode *node);
 };
 
 }  // namespace Moses
@@ -174,6 +174,9 @@ void ChartTranslationOptionCollection::ProcessUnknownWord(size_t sourcePos)
 //! special handling of ONE unknown words.
 void ChartTranslationOptionCollection::ProcessOneUnknownWord(const Word &sourceWord, size_t sourcePos, size_t /* length */)
 {
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_unknownWordMutex);
+#endif
   // unknown word, add as trans opt
   const StaticData &staticData = StaticData::Instance();
   const UnknownWordPenaltyProducer *unknownWordPenaltyProducer = m_system->GetUnknownWordPenaltyProducer();
@@ -27,6 +27,10 @@
 #include "ChartTranslationOptionList.h"
 #include "ChartRuleLookupManager.h"
 
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
 namespace Moses
 {
 class DecodeGraph;
@@ -50,6 +54,9 @@ protected:
   std::vector<Phrase*> m_unksrcs;
   std::list<TargetPhraseCollection*> m_cacheTargetPhraseCollection;
   std::list<std::vector<DottedRule*>* > m_dottedRuleCache;
+#ifdef WITH_THREADS
+  boost::mutex m_unknownWordMutex; /*< guards the caches above, cells may be processed in parallel */
+#endif
 
   // for adding 1 trans opt in unknown word proc
   void Add(ChartTranslationOption *transOpt, size_t pos);
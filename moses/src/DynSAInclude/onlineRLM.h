@@ -24,6 +24,7 @@ public:
     assert(vocab_ != 0);
     //instantiate quantizer class here
     cache_ = new Cache<float>(8888.8888, 9999.9999); // unknown_value, null_value
+    pfCache_ = new Cache<int>(-1, -1);
     alpha_ = new float[order_ + 1];
     for(count_t i = 0; i <= order_; ++i) 
       alpha_[i] = i * log10(0.4);
@@ -35,6 +36,7 @@ public:
     PerfectHash<T>(fin), bAdapting_(true), order_(order), corpusSize_(0) {
     load(fin);
     cache_ = new Cache<float>(8888.8888, 9999.9999); // unknown_value, null_value
+    pfCache_ = new Cache<int>(-1, -1);
     alpha_ = new float[order_ + 1];
     for(count_t i = 0; i <= order_; ++i) 
       alpha_[i] = i * log10(0.4);
@@ -44,6 +46,7 @@ public:
     if(bAdapting_) delete vocab_;
     else vocab_ = NULL;
     if(cache_) delete cache_;
+    delete pfCache_;
     delete bPrefix_;
     delete bHit_;
   }
@@ -83,6 +86,7 @@ private:
   uint64_t corpusSize_; // total training corpus size
   float* alpha_;  // backoff constant
   Cache<float>* cache_;
+  Cache<int>* pfCache_; // prefix cache of markPrefix(), one per model
   BitFilter* bPrefix_;
   BitFilter* bHit_;
 };
@@ -146,9 +150,8 @@ int OnlineRLM<T>::query(const wordID_t* IDs, int len) {
 template<typename T>
 bool OnlineRLM<T>::markPrefix(const wordID_t* IDs, const int len, bool bSet) {
   if(len <= 1) return true; // only do this for for ngrams with context 
-  static Cache<int> pfCache(-1, -1); // local prefix cache 
   int code(0);
-  if(!pfCache.checkCacheNgram(IDs, len - 1, &code, NULL)) { 
+  if(!pfCache_->checkCacheNgram(IDs, len - 1, &code, NULL)) { 
     hpdEntry_t hpdItr; 
     uint64_t filterIndex(0);
     code = PerfectHash<T>::query(IDs, len - 1, hpdItr, filterIndex); // hash IDs[0..len-1]
@@ -166,8 +169,8 @@ bool OnlineRLM<T>::markPrefix(const wordID_t* IDs, const int len, bool bSet) {
       assert(filterIndex == this->cells_ + 1);
       //how to handle hpd prefixes? 
     }
-    if(pfCache.nodes() > 10000) pfCache.clear();
-    pfCache.setCacheNgram(IDs, len - 1, code, NULL);
+    if(pfCache_->nodes() > 10000) pfCache_->clear();
+    pfCache_->setCacheNgram(IDs, len - 1, code, NULL);
   }
   return true;
 }
@@ -2,6 +2,7 @@
 #define moses_FFState_h
 
 #include <cassert>
+#include <cstddef>
 #include <vector>
 
 
@@ -13,6 +14,8 @@ class FFState
 public:
   virtual ~FFState();
   virtual int Compare(const FFState& other) const = 0;
+  //! hash of the state. states that Compare() equal must have the same hash
+  virtual size_t Hash() const = 0;
 };
 
 }
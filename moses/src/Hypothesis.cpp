@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <limits>
 #include <vector>
 #include <algorithm>
+#include <boost/functional/hash.hpp>
 
 #include "FFState.h"
 #include "TranslationOption.h"
@@ -44,10 +45,6 @@ using namespace std;
 namespace Moses
 {
 
-#ifdef USE_HYPO_POOL
-ObjectPool<Hypothesis> Hypothesis::s_objectPool("Hypothesis", 300000);
-#endif
-
 Hypothesis::Hypothesis(Manager& manager, InputType const& source, const TargetPhrase &emptyTarget)
   : m_prevHypo(NULL)
   , m_targetPhrase(emptyTarget)
@@ -63,6 +60,8 @@ Hypothesis::Hypothesis(Manager& manager, InputType const& source, const TargetPh
   , m_arcList(NULL)
   , m_transOpt(NULL)
   , m_manager(manager)
+  , m_pool(&manager.GetHypothesisPool())
+  , m_recombinationHash(0)
 
   , m_id(m_manager.GetNextHypoId())
 {
@@ -74,13 +73,14 @@ Hypothesis::Hypothesis(Manager& manager, InputType const& source, const TargetPh
   const vector<const StatefulFeatureFunction*>& ffs = m_manager.GetTranslationSystem()->GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i)
     m_ffStates[i] = ffs[i]->EmptyHypothesisState(source);
+  CalcRecombinationHash();
   m_manager.GetSentenceStats().AddCreated();
 }
 
 /***
  * continue prevHypo by appending the phrases in transOpt
  */
-Hypothesis::Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt)
+Hypothesis::Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt, ObjectPool<Hypothesis> &pool)
   : m_prevHypo(&prevHypo)
   , m_targetPhrase(transOpt.GetTargetPhrase())
   , m_sourcePhrase(transOpt.GetSourcePhrase())
@@ -97,7 +97,9 @@ Hypothesis::Hypothesis(const Hypothesis &prevHypo, const TranslationOption &tran
   , m_arcList(NULL)
   , m_transOpt(&transOpt)
   , m_manager(prevHypo.GetManager())
-  , m_id(m_manager.GetNextHypoId())
+  , m_pool(&pool)
+  , m_recombinationHash(0)
+  , m_id(-1)
 {
   // assert that we are not extending our hypothesis by retranslating something
   // that this hypothesis has already translated!
@@ -106,7 +108,6 @@ Hypothesis::Hypothesis(const Hypothesis &prevHypo, const TranslationOption &tran
   //_hash_computed = false;
   m_sourceCompleted.SetValue(m_currSourceWordsRange.GetStartPos(), m_currSourceWordsRange.GetEndPos(), true);
   m_wordDeleted = transOpt.IsDeletionOption();
-  m_manager.GetSentenceStats().AddCreated();
 }
 
 Hypothesis::~Hypothesis()
@@ -114,6 +115,17 @@ Hypothesis::~Hypothesis()
   for (unsigned i = 0; i < m_ffStates.size(); ++i)
     delete m_ffStates[i];
 
+  ReleaseArcList();
+}
+
+void Hypothesis::AssignId()
+{
+  m_id = m_manager.GetNextHypoId();
+  m_manager.GetSentenceStats().AddCreated();
+}
+
+void Hypothesis::ReleaseArcList()
+{
   if (m_arcList) {
     ArcList::iterator iter;
     for (iter = m_arcList->begin() ; iter != m_arcList->end() ; ++iter) {
@@ -121,11 +133,19 @@ Hypothesis::~Hypothesis()
     }
     m_arcList->clear();
 
-    delete m_arcList;
+    m_manager.GetArcListPool().freeObject(m_arcList);
     m_arcList = NULL;
   }
 }
 
+void Hypothesis::Free(Hypothesis *hypo)
+{
+  // the destructor only runs once the memory is reused, which may be in a
+  // worker thread. Hand the arcs back now, while we are in the search thread
+  hypo->ReleaseArcList();
+  hypo->m_pool->freeObject(hypo);
+}
+
 void Hypothesis::AddArc(Hypothesis *loserHypo)
 {
   if (!m_arcList) {
@@ -133,7 +153,7 @@ void Hypothesis::AddArc(Hypothesis *loserHypo)
       this->m_arcList = loserHypo->m_arcList;  // take ownership, we'll delete
       loserHypo->m_arcList = 0;                // prevent a double deletion
     } else {
-      this->m_arcList = new ArcList();
+      this->m_arcList = m_manager.GetArcListPool().get();
     }
   } else {
     if (loserHypo->m_arcList) {  // both have an arc list: merge. delete loser
@@ -141,7 +161,7 @@ void Hypothesis::AddArc(Hypothesis *loserHypo)
       size_t add_size = loserHypo->m_arcList->size();
       this->m_arcList->resize(my_size + add_size, 0);
       std::memcpy(&(*m_arcList)[0] + my_size, &(*loserHypo->m_arcList)[0], add_size * sizeof(Hypothesis *));
-      delete loserHypo->m_arcList;
+      m_manager.GetArcListPool().freeObject(loserHypo->m_arcList);
       loserHypo->m_arcList = 0;
     } else { // loserHypo doesn't have any arcs
       // DO NOTHING
@@ -158,10 +178,24 @@ Hypothesis* Hypothesis::CreateNext(const TranslationOption &transOpt, const Phra
   return Create(*this, transOpt, constraint);
 }
 
+Hypothesis* Hypothesis::CreateNext(const TranslationOption &transOpt, const Phrase* constraint, ObjectPool<Hypothesis> &pool) const
+{
+  return Create(*this, transOpt, constraint, pool);
+}
+
+Hypothesis* Hypothesis::Create(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Phrase* constrainingPhrase)
+{
+  Hypothesis *hypo = Create(prevHypo, transOpt, constrainingPhrase, prevHypo.GetManager().GetHypothesisPool());
+  if (hypo) {
+    hypo->AssignId();
+  }
+  return hypo;
+}
+
 /***
  * return the subclass of Hypothesis most appropriate to the given translation option
  */
-Hypothesis* Hypothesis::Create(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Phrase* constrainingPhrase)
+Hypothesis* Hypothesis::Create(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Phrase* constrainingPhrase, ObjectPool<Hypothesis> &pool)
 {
 
   // This method includes code for constraint decoding
@@ -197,12 +231,8 @@ Hypothesis* Hypothesis::Create(const Hypothesis &prevHypo, const TranslationOpti
 
   if (createHypothesis) {
 
-#ifdef USE_HYPO_POOL
-    Hypothesis *ptr = s_objectPool.getPtr();
-    return new(ptr) Hypothesis(prevHypo, transOpt);
-#else
-    return new Hypothesis(prevHypo, transOpt);
-#endif
+    Hypothesis *ptr = pool.getPtr();
+    return new(ptr) Hypothesis(prevHypo, transOpt, pool);
 
   } else {
     // If the previous hypothesis plus the proposed translation option
@@ -218,12 +248,8 @@ Hypothesis* Hypothesis::Create(const Hypothesis &prevHypo, const TranslationOpti
 
 Hypothesis* Hypothesis::Create(Manager& manager, InputType const& m_source, const TargetPhrase &emptyTarget)
 {
-#ifdef USE_HYPO_POOL
-  Hypothesis *ptr = s_objectPool.getPtr();
+  Hypothesis *ptr = manager.GetHypothesisPool().getPtr();
   return new(ptr) Hypothesis(manager, m_source, emptyTarget);
-#else
-  return new Hypothesis(manager, m_source, emptyTarget);
-#endif
 }
 
 /** check, if two hypothesis can be recombined.
@@ -252,6 +278,15 @@ int Hypothesis::RecombineCompare(const Hypothesis &compare) const
   return 0;
 }
 
+void Hypothesis::CalcRecombinationHash()
+{
+  size_t seed = m_sourceCompleted.hash();
+  for (unsigned i = 0; i < m_ffStates.size(); ++i) {
+    boost::hash_combine(seed, m_ffStates[i] ? m_ffStates[i]->Hash() : 0);
+  }
+  m_recombinationHash = seed;
+}
+
 void Hypothesis::ResetScore()
 {
   m_scoreBreakdown.ZeroAll();
@@ -269,7 +304,6 @@ void Hypothesis::CalcScore(const SquareMatrix &futureScore)
   // phrase are also included here
   m_scoreBreakdown.PlusEquals(m_transOpt->GetScoreBreakdown());
 
-  const StaticData &staticData = StaticData::Instance();
   clock_t t=0; // used to track time
 
   // compute values of stateless feature functions that were not
@@ -288,6 +322,7 @@ void Hypothesis::CalcScore(const SquareMatrix &futureScore)
                       m_prevHypo ? m_prevHypo->m_ffStates[i] : NULL,
                       &m_scoreBreakdown);
   }
+  CalcRecombinationHash();
 
   IFVERBOSE(2) {
     t = clock();  // track time excluding LM
@@ -297,7 +332,7 @@ void Hypothesis::CalcScore(const SquareMatrix &futureScore)
   m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted );
 
   // TOTAL
-  m_totalScore = m_scoreBreakdown.InnerProduct(staticData.GetAllWeights()) + m_futureScore;
+  m_totalScore = m_scoreBreakdown.GetWeightedScore() + m_futureScore;
 
   IFVERBOSE(2) {
     m_manager.GetSentenceStats().AddTimeOtherScore( clock()-t );
@@ -312,7 +347,6 @@ void Hypothesis::CalcScore(const SquareMatrix &futureScore)
  */
 float Hypothesis::CalcExpectedScore( const SquareMatrix &futureScore )
 {
-  const StaticData &staticData = StaticData::Instance();
   clock_t t=0;
   IFVERBOSE(2) {
     t = clock();  // track time excluding LM
@@ -322,13 +356,13 @@ float Hypothesis::CalcExpectedScore( const SquareMatrix &futureScore )
   //CalcDistortionScore();
 
   // LANGUAGE MODEL ESTIMATE (includes word penalty cost)
-  float estimatedLMScore = m_transOpt->GetFutureScore() - m_transOpt->GetScoreBreakdown().InnerProduct(staticData.GetAllWeights());
+  float estimatedLMScore = m_transOpt->GetFutureScore() - m_transOpt->GetScoreBreakdown().GetWeightedScore();
 
   // FUTURE COST
   m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted );
 
   // TOTAL
-  float total = m_scoreBreakdown.InnerProduct(staticData.GetAllWeights()) + m_futureScore + estimatedLMScore;
+  float total = m_scoreBreakdown.GetWeightedScore() + m_futureScore + estimatedLMScore;
 
   IFVERBOSE(2) {
     m_manager.GetSentenceStats().AddTimeEstimateScore( clock()-t );
@@ -338,7 +372,6 @@ float Hypothesis::CalcExpectedScore( const SquareMatrix &futureScore )
 
 void Hypothesis::CalcRemainingScore()
 {
-  const StaticData &staticData = StaticData::Instance();
   clock_t t=0; // used to track time
 
   // LANGUAGE MODEL COST
@@ -354,7 +387,7 @@ void Hypothesis::CalcRemainingScore()
                               , - (float)m_currTargetWordsRange.GetNumWordsCovered());
 
   // TOTAL
-  m_totalScore = m_scoreBreakdown.InnerProduct(staticData.GetAllWeights()) + m_futureScore;
+  m_totalScore = m_scoreBreakdown.GetWeightedScore() + m_futureScore;
 
   IFVERBOSE(2) {
     m_manager.GetSentenceStats().AddTimeOtherScore( clock()-t );
@@ -63,8 +63,6 @@ class Hypothesis
   friend std::ostream& operator<<(std::ostream&, const Hypothesis&);
 
 protected:
-  static ObjectPool<Hypothesis> s_objectPool;
-
   const Hypothesis* m_prevHypo; /*! backpointer to previous hypothesis (from which this one was created) */
 //	const Phrase			&m_targetPhrase; /*! target phrase being created at the current decoding step */
   const TargetPhrase			&m_targetPhrase; /*! target phrase being created at the current decoding step */
@@ -84,24 +82,34 @@ protected:
   ArcList 					*m_arcList; /*! all arcs that end at the same trellis point as this hypothesis */
   const TranslationOption *m_transOpt;
   Manager& m_manager;
+  ObjectPool<Hypothesis> *m_pool; /*! pool this hypothesis was allocated from, see Free() */
+  size_t m_recombinationHash; /*! hash of coverage and feature function states, see RecombineCompare() */
 
   int m_id; /*! numeric ID of this hypothesis, used for logging */
 
+  void CalcRecombinationHash();
+  void ReleaseArcList();
+
   /*! used by initial seeding of the translation process */
   Hypothesis(Manager& manager, InputType const& source, const TargetPhrase &emptyTarget);
-  /*! used when creating a new hypothesis using a translation option (phrase translation) */
-  Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt);
+  /*! used when creating a new hypothesis using a translation option (phrase translation).
+   * The new hypothesis has no ID until AssignId() is called */
+  Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt, ObjectPool<Hypothesis> &pool);
 
 public:
-  static ObjectPool<Hypothesis> &GetObjectPool() {
-    return s_objectPool;
-  }
-
   ~Hypothesis();
 
+  /** return hypothesis to the pool it was allocated from.
+   * Its memory is only reclaimed when that pool is destroyed */
+  static void Free(Hypothesis *hypo);
+
   /** return the subclass of Hypothesis most appropriate to the given translation option */
   static Hypothesis* Create(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Phrase* constraint);
 
+  /** as above, but allocated from pool and without an ID. Doesn't touch the Manager,
+   * so it can be called from worker threads, see SearchNormal */
+  static Hypothesis* Create(const Hypothesis &prevHypo, const TranslationOption &transOpt, const Phrase* constraint, ObjectPool<Hypothesis> &pool);
+
   static Hypothesis* Create(Manager& manager, const WordsBitmap &initialCoverage);
 
   /** return the subclass of Hypothesis most appropriate to the given target phrase */
@@ -109,6 +117,10 @@ public:
 
   /** return the subclass of Hypothesis most appropriate to the given translation option */
   Hypothesis* CreateNext(const TranslationOption &transOpt, const Phrase* constraint) const;
+  Hypothesis* CreateNext(const TranslationOption &transOpt, const Phrase* constraint, ObjectPool<Hypothesis> &pool) const;
+
+  //! number the hypothesis in order of creation and count it in the sentence statistics
+  void AssignId();
 
   void PrintHypothesis() const;
 
@@ -137,6 +149,10 @@ public:
     return m_manager;
   }
 
+  inline const FFState* GetFFState(size_t featureID) const {
+    return m_ffStates[featureID];
+  }
+
   /** output length of the translation option used to create this hypothesis */
   inline size_t GetCurrTargetLength() const {
     return m_currTargetWordsRange.GetNumWordsCovered();
@@ -207,6 +223,11 @@ public:
 
   int RecombineCompare(const Hypothesis &compare) const;
 
+  //! hash consistent with RecombineCompare(). Valid once the feature function states are set
+  size_t GetRecombinationHash() const {
+    return m_recombinationHash;
+  }
+
   void ToStream(std::ostream& out) const {
     if (m_prevHypo != NULL) {
       m_prevHypo->ToStream(out);
@@ -264,17 +285,7 @@ struct CompareHypothesisTotalScore {
   }
 };
 
-#ifdef USE_HYPO_POOL
-
-#define FREEHYPO(hypo) \
-{ \
-	ObjectPool<Hypothesis> &pool = Hypothesis::GetObjectPool(); \
-	pool.freeObject(hypo); \
-} \
- 
-#else
-#define FREEHYPO(hypo) delete hypo
-#endif
+#define FREEHYPO(hypo) Hypothesis::Free(hypo)
 
 /** defines less-than relation on hypotheses.
 * The particular order is not important for us, we need just to figure out
@@ -293,5 +304,25 @@ public:
   }
 };
 
+/** hash and equality predicate for hashed hypothesis collections.
+ * RecombineCompare() is only called when the precomputed hashes match
+ */
+class HypothesisRecombinationHasher
+{
+public:
+  size_t operator()(const Hypothesis* hypo) const {
+    return hypo->GetRecombinationHash();
+  }
+};
+
+class HypothesisRecombinationEqualityPred
+{
+public:
+  bool operator()(const Hypothesis* hypoA, const Hypothesis* hypoB) const {
+    return hypoA->GetRecombinationHash() == hypoB->GetRecombinationHash()
+           && hypoA->RecombineCompare(*hypoB) == 0;
+  }
+};
+
 }
 #endif
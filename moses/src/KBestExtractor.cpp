@@ -0,0 +1,185 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include "KBestExtractor.h"
+#include "Hypothesis.h"
+#include "StaticData.h"
+#include "TrellisPath.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+//! orders the candidate heaps, best derivation on top
+bool WorseDerivation(const KBestExtractor::Derivation *a, const KBestExtractor::Derivation *b)
+{
+  return a->score < b->score;
+}
+
+//! score the edge of a derivation adds to the derivation of its tail
+float EdgeScore(const KBestExtractor::Derivation &derivation)
+{
+  if (derivation.edge == NULL)
+    return 0.0f;
+  if (derivation.tail == NULL)
+    return derivation.edge->GetTotalScore();
+  return derivation.edge->GetTotalScore() - derivation.tail->GetTotalScore();
+}
+}
+
+KBestExtractor::KBestExtractor(const vector<const Hypothesis*> &finalHypos)
+  : m_numEnumerated(0)
+  , m_finalHypos(finalHypos)
+{}
+
+const KBestExtractor::Derivation *KBestExtractor::Next()
+{
+  const Derivation *derivation = GetDerivation(NULL, m_numEnumerated);
+  if (derivation)
+    ++m_numEnumerated;
+  return derivation;
+}
+
+KBestExtractor::Derivation *KBestExtractor::NewDerivation(const Hypothesis *edge, const Hypothesis *tail, size_t tailIndex, float score)
+{
+  m_derivations.push_back(Derivation());
+  Derivation &derivation = m_derivations.back();
+  derivation.edge = edge;
+  derivation.tail = tail;
+  derivation.tailIndex = tailIndex;
+  derivation.score = score;
+  return &derivation;
+}
+
+/** the best derivation of each edge is the one the edge was built from,
+ * so its score is the total score of the edge's hypothesis.
+ * hypo is NULL for the top node */
+void KBestExtractor::Initialize(const Hypothesis *hypo, Node &node)
+{
+  node.initialized = true;
+  if (hypo == NULL) {
+    for (size_t i = 0 ; i < m_finalHypos.size() ; ++i) {
+      node.candidates.push_back(NewDerivation(NULL, m_finalHypos[i], 0, m_finalHypos[i]->GetTotalScore()));
+    }
+  } else {
+    node.candidates.push_back(NewDerivation(hypo, hypo->GetPrevHypo(), 0, hypo->GetTotalScore()));
+    const ArcList *arcList = hypo->GetArcList();
+    if (arcList) {
+      ArcList::const_iterator iterArc;
+      for (iterArc = arcList->begin() ; iterArc != arcList->end() ; ++iterArc) {
+        const Hypothesis *arc = *iterArc;
+        node.candidates.push_back(NewDerivation(arc, arc->GetPrevHypo(), 0, arc->GetTotalScore()));
+      }
+    }
+  }
+  make_heap(node.candidates.begin(), node.candidates.end(), WorseDerivation);
+}
+
+/** index-th best derivation of hypo, NULL if it has fewer derivations.
+ * Ranks the derivations of hypo, and recursively of the hypotheses before it,
+ * only as far as needed (LazyKthBest) */
+const KBestExtractor::Derivation *KBestExtractor::GetDerivation(const Hypothesis *hypo, size_t index)
+{
+  // references to the elements of an unordered_map stay valid when it grows
+  Node &node = (hypo == NULL) ? m_top : m_nodes[hypo];
+  if (!node.initialized)
+    Initialize(hypo, node);
+
+  while (node.derivations.size() <= index) {
+    // the next best derivation may use the next derivation of the tail of the last one
+    while (node.numExpanded < node.derivations.size()) {
+      PushSuccessor(node, *node.derivations[node.numExpanded++]);
+    }
+    if (node.candidates.empty())
+      return NULL;
+    pop_heap(node.candidates.begin(), node.candidates.end(), WorseDerivation);
+    const Derivation *best = node.candidates.back();
+    node.candidates.pop_back();
+    node.derivations.push_back(best);
+
+    // the first candidates were scored without ranking the derivations of
+    // their tails, rank the best one now that the derivation is used
+    if (best->tail != NULL && best->tailIndex == 0)
+      GetDerivation(best->tail, 0);
+  }
+  return node.derivations[index];
+}
+
+//! add the derivation with the same edge and the next derivation of its tail to the candidates (LazyNext)
+void KBestExtractor::PushSuccessor(Node &node, const Derivation &derivation)
+{
+  // the initial hypothesis has a single derivation
+  if (derivation.tail == NULL)
+    return;
+
+  const Derivation *nextTail = GetDerivation(derivation.tail, derivation.tailIndex + 1);
+  if (nextTail == NULL)
+    return;
+
+  node.candidates.push_back(NewDerivation(derivation.edge, derivation.tail, derivation.tailIndex + 1
+                                          , EdgeScore(derivation) + nextTail->score));
+  push_heap(node.candidates.begin(), node.candidates.end(), WorseDerivation);
+}
+
+const KBestExtractor::Derivation *KBestExtractor::GetPrevDerivation(const Derivation &derivation) const
+{
+  if (derivation.tail == NULL)
+    return NULL;
+  return m_nodes.find(derivation.tail)->second.derivations[derivation.tailIndex];
+}
+
+/** collected from the last target word to the first, which is enough to
+ * compare translations */
+void KBestExtractor::GetOutputFactors(const Derivation &derivation, vector<const Factor*> &factors) const
+{
+  const vector<FactorType> &outputFactor = StaticData::Instance().GetOutputFactorOrder();
+  factors.clear();
+
+  for (const Derivation *current = &derivation ; current != NULL ; current = GetPrevDerivation(*current)) {
+    // the initial hypothesis has no target words
+    if (current->edge == NULL || current->tail == NULL)
+      continue;
+    const Phrase &targetPhrase = current->edge->GetCurrTargetPhrase();
+    for (size_t pos = targetPhrase.GetSize() ; pos > 0 ; --pos) {
+      for (size_t i = 0 ; i < outputFactor.size() ; ++i) {
+        factors.push_back(targetPhrase.GetFactor(pos - 1, outputFactor[i]));
+      }
+    }
+  }
+}
+
+TrellisPath *KBestExtractor::CreateTrellisPath(const Derivation &derivation) const
+{
+  // TrellisPath wants the edges from the initial hypothesis on
+  vector<const Hypothesis*> edges;
+  for (const Derivation *current = &derivation ; current != NULL ; current = GetPrevDerivation(*current)) {
+    if (current->edge != NULL)
+      edges.push_back(current->edge);
+  }
+  reverse(edges.begin(), edges.end());
+  return new TrellisPath(edges);
+}
+
+}
@@ -0,0 +1,92 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_KBestExtractor_h
+#define moses_KBestExtractor_h
+
+#include <deque>
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+namespace Moses
+{
+
+class Factor;
+class Hypothesis;
+class TrellisPath;
+
+/** Enumerates the translations of a sentence in order of decreasing score,
+ * with the lazy k-best algorithm of Huang & Chiang 2005 (algorithm 3).
+ *
+ * The nodes of the graph are the hypotheses that won recombination. The
+ * incoming edges of a node are the node itself and its arcs, each coming
+ * from the previous hypothesis. A derivation of a node is an edge and the
+ * index of a derivation of the previous hypothesis, so derivations share
+ * their prefixes and are only ranked as far as they are asked for.
+ * Only the paths that are kept become TrellisPath objects.
+ */
+class KBestExtractor
+{
+public:
+  struct Derivation {
+    const Hypothesis *edge; //! the winning hypothesis or an arc, NULL for the final choice of hypothesis
+    const Hypothesis *tail; //! hypothesis the edge extends, NULL for the initial hypothesis
+    size_t tailIndex; //! derivation of tail that comes before this edge
+    float score;
+  };
+
+  //! finalHypos are the hypotheses of the last stack
+  KBestExtractor(const std::vector<const Hypothesis*> &finalHypos);
+
+  //! next best translation of the sentence, NULL once all are enumerated
+  const Derivation *Next();
+
+  //! output factors of all target words, eg. to tell distinct translations apart
+  void GetOutputFactors(const Derivation &derivation, std::vector<const Factor*> &factors) const;
+
+  //! full path of a derivation, owned by the caller
+  TrellisPath *CreateTrellisPath(const Derivation &derivation) const;
+
+protected:
+  struct Node {
+    Node() : numExpanded(0), initialized(false) {}
+    std::vector<const Derivation*> derivations; //! best derivations found so far, best first
+    std::vector<Derivation*> candidates; //! heap of the next derivations of each edge
+    size_t numExpanded; //! derivations whose successors are among the candidates
+    bool initialized;
+  };
+
+  //! the top node, whose edges go to the final hypotheses
+  Node m_top;
+  size_t m_numEnumerated;
+  std::vector<const Hypothesis*> m_finalHypos;
+  boost::unordered_map<const Hypothesis*, Node> m_nodes;
+  std::deque<Derivation> m_derivations; //! owns all derivations, deque keeps their addresses
+
+  Derivation *NewDerivation(const Hypothesis *edge, const Hypothesis *tail, size_t tailIndex, float score);
+  void Initialize(const Hypothesis *hypo, Node &node);
+  const Derivation *GetDerivation(const Hypothesis *hypo, size_t index);
+  void PushSuccessor(Node &node, const Derivation &derivation);
+  const Derivation *GetPrevDerivation(const Derivation &derivation) const;
+};
+
+}
+#endif
@@ -24,6 +24,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <string>
 #include <cstddef>
+#include <utility>
+#include <vector>
 #include "../FeatureFunction.h"
 
 namespace Moses
@@ -33,6 +35,9 @@ class FactorCollection;
 class Factor;
 class Phrase;
 class ScoreIndexManager;
+class Hypothesis;
+class ChartHypothesis;
+class TranslationOptionList;
 
 //! Abstract base class which represent a language model on a contiguous phrase
 class LanguageModel : public StatefulFeatureFunction {
@@ -84,6 +89,26 @@ public:
    * \param oovCount number of LM OOVs
    */
   virtual void CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, std::size_t &oovCount) const = 0;
+
+  //! hypotheses about to be extended with each option of a list
+  typedef std::vector<std::pair<const Hypothesis*, const TranslationOptionList*> > Extensions;
+
+  /* hints that CalcScore() is about to be called on each of these phrases.
+   * Models with expensive lookups (e.g. over the network) can fetch the n-grams of all of them at once.
+   */
+  virtual void PrefetchPhrases(const std::vector<const Phrase*> &) const {}
+
+  /* hints that the hypotheses are about to be extended with these translation options, see PrefetchPhrases()
+   */
+  virtual void PrefetchExtensions(const Extensions &) const {}
+
+  /* hints that these extensions are scored next. Unlike PrefetchExtensions(), this is called on
+   * a few at a time just ahead of scoring them, so models can start loading the memory they read.
+   */
+  virtual void PrefetchMemory(const Extensions &) const {}
+
+  //! same for chart hypotheses that are built but not scored yet
+  virtual void PrefetchChartMemory(const std::vector<const ChartHypothesis*> &) const {}
 };
 
 }
@@ -25,6 +25,9 @@ public:
         else
             return 0;
     }
+    size_t Hash() const {
+        return m_last_succeeding_order;
+    }
     uint8_t m_last_succeeding_order;
 };
 
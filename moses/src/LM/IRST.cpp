@@ -92,6 +92,9 @@ bool LanguageModelIRST::Load(const std::string &filePath,
 
   if (m_lmtb_dub > 0) m_lmtb->setlogOOVpenalty(m_lmtb_dub);
 
+  // cmaxsuffptr() points into the table, so the states can be shared
+  UseNGramCache(StaticData::Instance().GetLMNGramCacheBytes());
+
   return true;
 }
 
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <boost/functional/hash.hpp>
 
 #include "FFState.h"
 #include "LM/Implementation.h"
@@ -35,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "StaticData.h"
 #include "ChartManager.h"
 #include "ChartHypothesis.h"
+#include "TranslationOption.h"
 
 using namespace std;
 
@@ -113,6 +115,65 @@ void LanguageModelImplementation::CalcScore(const Phrase &phrase, float &fullSco
   }
 }
 
+void LanguageModelImplementation::GetPhraseNGrams(const Phrase &phrase, std::vector<std::vector<const Word*> > &ngrams) const
+{
+  if (!Useable(phrase))
+    return;
+
+  // same n-grams as CalcScore()
+  vector<const Word*> contextFactor;
+  contextFactor.reserve(GetNGramOrder());
+  for (size_t currPos = 0 ; currPos < phrase.GetSize() ; currPos++) {
+    const Word &word = phrase.GetWord(currPos);
+    if (word.IsNonTerminal()) {
+      contextFactor.clear();
+    } else {
+      ShiftOrPush(contextFactor, word);
+      if (!(word == GetSentenceStartArray())) {
+        ngrams.push_back(contextFactor);
+      }
+    }
+  }
+}
+
+void LanguageModelImplementation::GetExtensionNGrams(const Hypothesis &hypo, const TranslationOption &transOpt, std::vector<std::vector<const Word*> > &ngrams) const
+{
+  const Phrase &phrase = transOpt.GetTargetPhrase();
+  if (GetNGramOrder() <= 1 || phrase.GetSize() == 0)
+    return;
+
+  // same n-grams as Evaluate() on the new hypothesis, whose words start after those of hypo
+  const size_t startPos = hypo.GetSize();
+  const size_t currEndPos = startPos + phrase.GetSize() - 1;
+  const size_t endPos = std::min(startPos + GetNGramOrder() - 2, currEndPos);
+  const WordsBitmap &bitmap = hypo.GetWordsBitmap();
+  const bool completed = bitmap.GetNumWordsCovered() + transOpt.GetSize() == bitmap.GetSize();
+
+  // n-grams ending at the first words of the phrase, then either the end of
+  // sentence or the state of the last word
+  vector<size_t> lastPositions;
+  for (size_t currPos = startPos ; currPos <= endPos ; currPos++)
+    lastPositions.push_back(currPos);
+  if (completed || endPos < currEndPos)
+    lastPositions.push_back(currEndPos + completed);
+
+  vector<const Word*> contextFactor(GetNGramOrder());
+  for (size_t n = 0 ; n < lastPositions.size() ; n++) {
+    for (size_t i = 0 ; i < GetNGramOrder() ; i++) {
+      int pos = (int) lastPositions[n] - (int) GetNGramOrder() + 1 + (int) i;
+      if (pos < 0)
+        contextFactor[i] = &GetSentenceStartArray();
+      else if ((size_t) pos < startPos)
+        contextFactor[i] = &hypo.GetWord(pos);
+      else if ((size_t) pos <= currEndPos)
+        contextFactor[i] = &phrase.GetWord(pos - startPos);
+      else
+        contextFactor[i] = &GetSentenceEndArray();
+    }
+    ngrams.push_back(contextFactor);
+  }
+}
+
 FFState *LanguageModelImplementation::Evaluate(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out, const LanguageModel *feature) const {
   // In this function, we only compute the LM scores of n-grams that overlap a
   // phrase boundary. Phrase-internal scores are taken directly from the
@@ -220,6 +281,8 @@ private:
 
   const ChartHypothesis &m_hypo;
 
+  size_t m_hash; /**< Hash(), set with the right context since it depends on it */
+
   /** Construct the prefix string of up to specified size 
    * \param ret prefix string
    * \param size maximum size (typically max lm context window)
@@ -310,6 +373,7 @@ public:
       ,m_contextPrefix(Output, order - 1)
       ,m_contextSuffix(Output, order - 1)
       ,m_hypo(hypo)
+      ,m_hash(0)
   {
     m_numTargetTerminals = hypo.GetCurrTargetPhrase().GetNumTerminals();
 
@@ -329,6 +393,15 @@ public:
   void Set(float prefixScore, FFState *rightState) {
     m_prefixScore = prefixScore;
     m_lmRightContext = rightState;
+
+    // same conditions as Compare()
+    m_hash = 0;
+    if (m_hypo.GetCurrSourceRange().GetStartPos() > 0)
+      m_hash = HashFactors(GetPrefix(), StaticData::Instance().GetOutputFactorOrder());
+
+    size_t inputSize = m_hypo.GetManager().GetSource().GetSize();
+    if (m_hypo.GetCurrSourceRange().GetEndPos() < inputSize - 1)
+      boost::hash_combine(m_hash, m_lmRightContext->Hash());
   }
 
   float GetPrefixScore() const { return m_prefixScore; }
@@ -349,6 +422,10 @@ public:
     const LanguageModelChartState &other =
       dynamic_cast<const LanguageModelChartState &>( o );
 
+    // different hashes always mean different states, which saves comparing phrases
+    if (m_hash != other.m_hash)
+      return m_hash < other.m_hash ? -1 : 1;
+
     // prefix
     if (m_hypo.GetCurrSourceRange().GetStartPos() > 0) // not for "<s> ..."
     {
@@ -367,6 +444,10 @@ public:
     }
     return 0;
   }
+
+  size_t Hash() const {
+    return m_hash;
+  }
 };
 
 } // namespace
@@ -432,7 +513,7 @@ FFState* LanguageModelImplementation::EvaluateChart(const ChartHypothesis& hypo,
 
         // get prefixScore and finalizedScore
         prefixScore = prevState->GetPrefixScore();
-        finalizedScore = prevHypo->GetScoreBreakdown().GetScoresForProducer(scorer)[0] - prefixScore;
+        finalizedScore = prevHypo->GetScoreBreakdown().GetProducerView(scorer)[0] - prefixScore;
 
         // get language model state
         delete lmState;
@@ -468,7 +549,7 @@ FFState* LanguageModelImplementation::EvaluateChart(const ChartHypothesis& hypo,
         {
           // add its finalized language model score
           finalizedScore +=
-            prevHypo->GetScoreBreakdown().GetScoresForProducer(scorer)[0] // full score
+            prevHypo->GetScoreBreakdown().GetProducerView(scorer)[0] // full score
             - prevState->GetPrefixScore();                              // - prefix score
 
           // copy language model state
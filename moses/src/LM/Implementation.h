@@ -41,6 +41,7 @@ class LanguageModel;
 class FactorCollection;
 class Factor;
 class Phrase;
+class TranslationOption;
 
 struct LMResult {
   // log probability
@@ -94,6 +95,17 @@ public:
 
   void CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const;
 
+  //! append the n-grams that CalcScore() looks up for phrase
+  void GetPhraseNGrams(const Phrase &phrase, std::vector<std::vector<const Word*> > &ngrams) const;
+  //! append the n-grams that Evaluate() looks up when hypo is extended with transOpt
+  void GetExtensionNGrams(const Hypothesis &hypo, const TranslationOption &transOpt, std::vector<std::vector<const Word*> > &ngrams) const;
+
+  //! see LanguageModel::PrefetchPhrases()
+  virtual void PrefetchPhrases(const std::vector<const Phrase*> &) const {}
+  virtual void PrefetchExtensions(const LanguageModel::Extensions &) const {}
+  virtual void PrefetchMemory(const LanguageModel::Extensions &) const {}
+  virtual void PrefetchChartMemory(const std::vector<const ChartHypothesis*> &) const {}
+
   FFState *Evaluate(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out, const LanguageModel *feature) const;
 
   FFState* EvaluateChart(const ChartHypothesis& cur_hypo, int featureID, ScoreComponentCollection* accumulator, const LanguageModel *feature) const;
@@ -156,6 +168,22 @@ class LMRefCount : public LanguageModel {
       return m_impl->CalcScore(phrase, fullScore, ngramScore, oovCount);
     }
 
+    void PrefetchPhrases(const std::vector<const Phrase*> &phrases) const {
+      m_impl->PrefetchPhrases(phrases);
+    }
+
+    void PrefetchExtensions(const Extensions &extensions) const {
+      m_impl->PrefetchExtensions(extensions);
+    }
+
+    void PrefetchMemory(const Extensions &extensions) const {
+      m_impl->PrefetchMemory(extensions);
+    }
+
+    void PrefetchChartMemory(const std::vector<const ChartHypothesis*> &hypos) const {
+      m_impl->PrefetchChartMemory(hypos);
+    }
+
     FFState* Evaluate(const Hypothesis& cur_hypo, const FFState* prev_state, ScoreComponentCollection* accumulator) const {
       return m_impl->Evaluate(cur_hypo, prev_state, accumulator, this);
     }
@@ -19,6 +19,7 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <iostream>
@@ -39,7 +40,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "InputFileStream.h"
 #include "StaticData.h"
 #include "ChartHypothesis.h"
+#include "ChartManager.h"
+#include "Manager.h"
+#include "TranslationOption.h"
+#include "TranslationOptionList.h"
+#include "TranslationSystem.h"
 
+#include <boost/functional/hash.hpp>
 #include <boost/shared_ptr.hpp>
 
 using namespace std;
@@ -55,6 +62,9 @@ struct KenLMState : public FFState {
     if (state.length > other.state.length) return 1;
     return std::memcmp(state.words, other.state.words, sizeof(lm::WordIndex) * state.length);
   }
+  size_t Hash() const {
+    return lm::ngram::hash_value(state);
+  }
 };
 
 /*
@@ -88,6 +98,10 @@ template <class Model> class LanguageModelKen : public LanguageModel {
 
     FFState *EvaluateChart(const ChartHypothesis& cur_hypo, int featureID, ScoreComponentCollection *accumulator) const;
 
+    void PrefetchMemory(const Extensions &extensions) const;
+
+    void PrefetchChartMemory(const std::vector<const ChartHypothesis*> &hypos) const;
+
   private:
     LanguageModelKen(ScoreIndexManager &manager, const LanguageModelKen<Model> &copy_from);
 
@@ -111,6 +125,15 @@ template <class Model> class LanguageModelKen : public LanguageModel {
       }
     }
 
+    // Index of the states of this model in the hypotheses.  
+    std::size_t StateIndex(const TranslationSystem &system) const {
+      const std::vector<const StatefulFeatureFunction*> &ffs = system.GetStatefulFeatureFunctions();
+      return std::find(ffs.begin(), ffs.end(), this) - ffs.begin();
+    }
+
+    // Prefetch the n-grams ending with each of words, the first one following context.  
+    void PrefetchWords(const lm::ngram::State &context, const std::vector<lm::WordIndex> &words) const;
+
     boost::shared_ptr<Model> m_ngram;
     
     std::vector<lm::WordIndex> m_lmIdLookup;
@@ -149,7 +172,19 @@ template <class Model> LanguageModelKen<Model>::LanguageModelKen(const std::stri
   FactorCollection &collection = FactorCollection::Instance();
   MappingBuilder builder(collection, m_lmIdLookup);
   config.enumerate_vocab = &builder;
-  config.load_method = lazy ? util::LAZY : util::POPULATE_OR_READ;
+  const StaticData &staticData = StaticData::Instance();
+  if (lazy) {
+    config.load_method = util::LAZY;
+  } else {
+    config.load_method = staticData.GetKenLMHugePages() ? util::HUGE_READ : util::POPULATE_OR_READ;
+  }
+  // one segment per model file. POSIX only allows a slash at the start of the name
+  std::string sharedName;
+  if (!staticData.GetKenLMSharedMemory().empty()) {
+    sharedName = "/" + staticData.GetKenLMSharedMemory() + "-" + file;
+    std::replace(sharedName.begin() + 1, sharedName.end(), '/', '_');
+    config.shared_memory_name = sharedName.c_str();
+  }
 
   m_ngram.reset(new Model(file.c_str(), config));
 
@@ -260,6 +295,40 @@ template <class Model> FFState *LanguageModelKen<Model>::Evaluate(const Hypothes
   return ret.release();
 }
 
+template <class Model> void LanguageModelKen<Model>::PrefetchWords(const lm::ngram::State &context, const std::vector<lm::WordIndex> &words) const {
+  // Most recent word first, like State::words.  
+  lm::WordIndex history[lm::ngram::kMaxOrder];
+  std::size_t length = context.length;
+  std::copy(context.words, context.words + length, history);
+  for (std::vector<lm::WordIndex>::const_iterator i = words.begin(); i != words.end(); ++i) {
+    m_ngram->Prefetch(history, history + length, *i);
+    if (length < m_ngram->Order() - 1U) ++length;
+    if (length) {
+      std::copy_backward(history, history + length - 1, history + length);
+      history[0] = *i;
+    }
+  }
+}
+
+template <class Model> void LanguageModelKen<Model>::PrefetchMemory(const Extensions &extensions) const {
+  if (extensions.empty()) return;
+  const std::size_t stateIndex = StateIndex(*extensions.front().first->GetManager().GetTranslationSystem());
+  std::vector<lm::WordIndex> words;
+  for (Extensions::const_iterator i = extensions.begin(); i != extensions.end(); ++i) {
+    const lm::ngram::State &context = static_cast<const KenLMState&>(*i->first->GetFFState(stateIndex)).state;
+    const TranslationOptionList &transOptList = *i->second;
+    for (size_t j = 0; j < transOptList.size(); ++j) {
+      // Same n-grams as the first loop of Evaluate.  
+      const Phrase &phrase = transOptList.Get(j)->GetTargetPhrase();
+      words.clear();
+      for (size_t pos = 0; pos < std::min<size_t>(phrase.GetSize(), m_ngram->Order() - 1); ++pos) {
+        words.push_back(TranslateID(phrase.GetWord(pos)));
+      }
+      PrefetchWords(context, words);
+    }
+  }
+}
+
 class LanguageModelChartStateKenLM : public FFState {
   public:
     LanguageModelChartStateKenLM() {}
@@ -270,8 +339,12 @@ class LanguageModelChartStateKenLM : public FFState {
     int Compare(const FFState& o) const
     {
       const LanguageModelChartStateKenLM &other = static_cast<const LanguageModelChartStateKenLM&>(o);
-      int ret = m_state.Compare(other.m_state);
-      return ret;
+      return m_state.Compare(other.m_state);
+    }
+
+    size_t Hash() const
+    {
+      return lm::ngram::hash_value(m_state);
     }
 
   private:
@@ -296,7 +369,7 @@ template <class Model> FFState *LanguageModelKen<Model>::EvaluateChart(const Cha
       // Non-terminal is first so we can copy instead of rescoring.  
       const ChartHypothesis *prevHypo = hypo.GetPrevHypo(nonTermIndexMap[phrasePos]);
       const lm::ngram::ChartState &prevState = static_cast<const LanguageModelChartStateKenLM*>(prevHypo->GetFFState(featureID))->GetChartState();
-      ruleScore.BeginNonTerminal(prevState, prevHypo->GetScoreBreakdown().GetScoresForProducer(this)[0]);
+      ruleScore.BeginNonTerminal(prevState, prevHypo->GetScoreBreakdown().GetProducerView(this)[0]);
       phrasePos++;
     }
   }
@@ -306,7 +379,7 @@ template <class Model> FFState *LanguageModelKen<Model>::EvaluateChart(const Cha
     if (word.IsNonTerminal()) {
       const ChartHypothesis *prevHypo = hypo.GetPrevHypo(nonTermIndexMap[phrasePos]);
       const lm::ngram::ChartState &prevState = static_cast<const LanguageModelChartStateKenLM*>(prevHypo->GetFFState(featureID))->GetChartState();
-      ruleScore.NonTerminal(prevState, prevHypo->GetScoreBreakdown().GetScoresForProducer(this)[0]);
+      ruleScore.NonTerminal(prevState, prevHypo->GetScoreBreakdown().GetProducerView(this)[0]);
     } else {
       ruleScore.Terminal(TranslateID(word));
     }
@@ -316,6 +389,34 @@ template <class Model> FFState *LanguageModelKen<Model>::EvaluateChart(const Cha
   return newState;
 }
 
+template <class Model> void LanguageModelKen<Model>::PrefetchChartMemory(const std::vector<const ChartHypothesis*> &hypos) const {
+  if (hypos.empty()) return;
+  const std::size_t stateIndex = StateIndex(*hypos.front()->GetManager().GetTranslationSystem());
+  std::vector<lm::WordIndex> words;
+  for (std::vector<const ChartHypothesis*>::const_iterator i = hypos.begin(); i != hypos.end(); ++i) {
+    // The terminals following each non-terminal (or the start of the rule), as RuleScore sees them.  
+    const ChartHypothesis &hypo = **i;
+    const Phrase &phrase = hypo.GetCurrTargetPhrase();
+    const AlignmentInfo::NonTermIndexMap &nonTermIndexMap = hypo.GetCurrTargetPhrase().GetAlignmentInfo().GetNonTermIndexMap();
+    lm::ngram::State context = m_ngram->NullContextState();
+    words.clear();
+    for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+      const Word &word = phrase.GetWord(pos);
+      if (word.IsNonTerminal()) {
+        PrefetchWords(context, words);
+        words.clear();
+        const ChartHypothesis *prevHypo = hypo.GetPrevHypo(nonTermIndexMap[pos]);
+        context = static_cast<const LanguageModelChartStateKenLM*>(prevHypo->GetFFState(stateIndex))->GetChartState().right;
+      } else if (pos == 0 && word.GetFactor(m_factorType) == m_beginSentenceFactor) {
+        context = m_ngram->BeginSentenceState();
+      } else {
+        words.push_back(TranslateID(word));
+      }
+    }
+    PrefetchWords(context, words);
+  }
+}
+
 } // namespace
 
 LanguageModel *ConstructKenLM(const std::string &file, ScoreIndexManager &manager, FactorType factorType, bool lazy) {
@@ -333,6 +434,10 @@ LanguageModel *ConstructKenLM(const std::string &file, ScoreIndexManager &manage
           return new LanguageModelKen<lm::ngram::ArrayTrieModel>(file, manager, factorType, lazy);
         case lm::ngram::QUANT_ARRAY_TRIE_SORTED:
           return new LanguageModelKen<lm::ngram::QuantArrayTrieModel>(file, manager, factorType, lazy);
+        case lm::ngram::ELIAS_FANO_TRIE_SORTED:
+          return new LanguageModelKen<lm::ngram::EliasFanoTrieModel>(file, manager, factorType, lazy);
+        case lm::ngram::QUANT_ELIAS_FANO_TRIE_SORTED:
+          return new LanguageModelKen<lm::ngram::QuantEliasFanoTrieModel>(file, manager, factorType, lazy);
         default:
           std::cerr << "Unrecognized kenlm model type " << model_type << std::endl;
           abort();
@@ -0,0 +1,170 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/functional/hash.hpp>
+#include "LM/NGramCache.h"
+#include "Word.h"
+
+namespace Moses
+{
+
+NGramCache::NGramCache(size_t order, size_t maxBytes)
+  : m_order(order)
+{
+  const size_t slotBytes = sizeof(Slot) + m_order * sizeof(const Factor*);
+  m_numSets = maxBytes / (slotBytes * Ways * NumShards);
+
+  Slot empty;
+  empty.hash = 0;
+  empty.length = 0;
+  empty.referenced = false;
+  empty.state = NULL;
+  for (size_t i = 0; i < NumShards; ++i) {
+    Shard &shard = m_shards[i];
+    shard.slots.resize(m_numSets * Ways, empty);
+    shard.words.resize(m_numSets * Ways * m_order, NULL);
+    shard.hands.resize(m_numSets, 0);
+  }
+}
+
+size_t NGramCache::Hash(const std::vector<const Word*> &contextFactor, FactorType factorType) const
+{
+  size_t seed = contextFactor.size();
+  for (size_t i = 0; i < contextFactor.size(); ++i) {
+    boost::hash_combine(seed, (*contextFactor[i])[factorType]);
+  }
+  return seed;
+}
+
+size_t NGramCache::FindSlot(const Shard &shard, size_t set, size_t hash, const std::vector<const Word*> &contextFactor, FactorType factorType) const
+{
+  for (size_t way = 0; way < Ways; ++way) {
+    const size_t slot = set * Ways + way;
+    const Slot &candidate = shard.slots[slot];
+    if (candidate.hash != hash || candidate.length != contextFactor.size()) continue;
+    const Factor *const *words = &shard.words[slot * m_order];
+    size_t i = 0;
+    while (i < contextFactor.size() && words[i] == (*contextFactor[i])[factorType]) ++i;
+    if (i == contextFactor.size()) return way;
+  }
+  return Ways;
+}
+
+bool NGramCache::Find(const std::vector<const Word*> &contextFactor, FactorType factorType, LMResult &result, const void *&state) const
+{
+  if (m_numSets == 0 || contextFactor.empty() || contextFactor.size() > m_order)
+    return false;
+
+  const size_t hash = Hash(contextFactor, factorType);
+  Shard &shard = m_shards[hash % NumShards];
+  const size_t set = (hash / NumShards) % m_numSets;
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+  const size_t way = FindSlot(shard, set, hash, contextFactor, factorType);
+  if (way == Ways) {
+    ++shard.misses;
+    return false;
+  }
+  ++shard.hits;
+  Slot &slot = shard.slots[set * Ways + way];
+  slot.referenced = true;
+  result = slot.result;
+  state = slot.state;
+  return true;
+}
+
+void NGramCache::Add(const std::vector<const Word*> &contextFactor, FactorType factorType, const LMResult &result, const void *state)
+{
+  if (m_numSets == 0 || contextFactor.empty() || contextFactor.size() > m_order)
+    return;
+
+  const size_t hash = Hash(contextFactor, factorType);
+  Shard &shard = m_shards[hash % NumShards];
+  const size_t set = (hash / NumShards) % m_numSets;
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+  // another thread may have looked up the same n-gram meanwhile
+  if (FindSlot(shard, set, hash, contextFactor, factorType) != Ways)
+    return;
+
+  // clock: give slots that were hit since the hand last passed a second chance.
+  // Empty slots are never referenced, so they are taken first time round
+  size_t way = shard.hands[set];
+  while (shard.slots[set * Ways + way].referenced) {
+    shard.slots[set * Ways + way].referenced = false;
+    way = (way + 1) % Ways;
+  }
+  shard.hands[set] = (way + 1) % Ways;
+
+  const size_t slot = set * Ways + way;
+  Slot &entry = shard.slots[slot];
+  entry.hash = hash;
+  entry.length = contextFactor.size();
+  entry.referenced = false;
+  entry.result = result;
+  entry.state = state;
+  const Factor **words = &shard.words[slot * m_order];
+  for (size_t i = 0; i < contextFactor.size(); ++i) {
+    words[i] = (*contextFactor[i])[factorType];
+  }
+}
+
+void NGramCache::Clear()
+{
+  for (size_t i = 0; i < NumShards; ++i) {
+    Shard &shard = m_shards[i];
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+    for (size_t slot = 0; slot < shard.slots.size(); ++slot) {
+      shard.slots[slot].length = 0;
+      shard.slots[slot].referenced = false;
+    }
+  }
+}
+
+size_t NGramCache::GetHits() const
+{
+  size_t hits = 0;
+  for (size_t i = 0; i < NumShards; ++i) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_shards[i].mutex);
+#endif
+    hits += m_shards[i].hits;
+  }
+  return hits;
+}
+
+size_t NGramCache::GetMisses() const
+{
+  size_t misses = 0;
+  for (size_t i = 0; i < NumShards; ++i) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_shards[i].mutex);
+#endif
+    misses += m_shards[i].misses;
+  }
+  return misses;
+}
+
+}
@@ -0,0 +1,107 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_NGramCache_h
+#define moses_NGramCache_h
+
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "LM/Implementation.h"
+#include "TypeDef.h"
+
+namespace Moses
+{
+
+class Factor;
+class Word;
+
+/** Cache of the score and state of n-grams looked up in a language model,
+ * shared by all decoder threads and kept across sentences.
+ *
+ * All memory is allocated when the cache is created. The slots are spread
+ * over a fixed number of shards by hash, each with its own lock, and each
+ * n-gram can only be stored in one set of a few slots of its shard. When the
+ * set is full, a CLOCK hand gives the slots that were hit since it last passed
+ * a second chance, so frequent n-grams survive a long-running server session.
+ *
+ * The states are stored as they came from the model, so only models whose
+ * states stay valid while the model is loaded may use it.
+ */
+class NGramCache
+{
+public:
+  /** \param order longest n-gram that is looked up
+   *  \param maxBytes memory for slots and keys. Rounded down to whole sets
+   */
+  NGramCache(size_t order, size_t maxBytes);
+
+  //! score and state of the n-gram, if it is cached
+  bool Find(const std::vector<const Word*> &contextFactor, FactorType factorType, LMResult &result, const void *&state) const;
+  //! store the n-gram, possibly evicting one that wasn't used recently
+  void Add(const std::vector<const Word*> &contextFactor, FactorType factorType, const LMResult &result, const void *state);
+  void Clear();
+
+  //! number of n-grams the cache can hold
+  size_t GetCapacity() const {
+    return NumShards * m_numSets * Ways;
+  }
+  size_t GetHits() const;
+  size_t GetMisses() const;
+
+protected:
+  struct Slot {
+    size_t hash;
+    unsigned char length; //! 0 if the slot is empty
+    bool referenced;
+    LMResult result;
+    const void *state;
+  };
+
+  struct Shard {
+    std::vector<Slot> slots; //! m_numSets sets of Ways slots
+    std::vector<const Factor*> words; //! m_order words per slot
+    std::vector<unsigned char> hands; //! next slot the clock looks at, per set
+    size_t hits, misses;
+#ifdef WITH_THREADS
+    boost::mutex mutex;
+#endif
+    Shard() : hits(0), misses(0) {}
+  };
+
+  static const size_t NumShards = 16;
+  static const size_t Ways = 4;
+
+  size_t m_order;
+  size_t m_numSets; //! per shard
+  mutable Shard m_shards[NumShards];
+
+  size_t Hash(const std::vector<const Word*> &contextFactor, FactorType factorType) const;
+  //! slot of the n-gram in its set, or Ways if it isn't there
+  size_t FindSlot(const Shard &shard, size_t set, size_t hash, const std::vector<const Word*> &contextFactor, FactorType factorType) const;
+};
+
+}
+
+#endif
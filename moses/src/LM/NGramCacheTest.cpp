@@ -0,0 +1,160 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+// Looks up random n-grams through a small NGramCache from several threads,
+// so that slots are evicted all the time, and checks that every hit returns
+// the score and state an uncached lookup would.
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
+
+#include "LM/NGramCache.h"
+#include "FactorCollection.h"
+#include "Word.h"
+
+using namespace Moses;
+
+namespace
+{
+
+const size_t Order = 3;
+const size_t VocabSize = 20;
+const size_t NumThreads = 8;
+const size_t Lookups = 200000;
+
+std::vector<Word> vocab;
+
+//! stands in for the language model: score and state follow from the words
+void Lookup(const std::vector<const Word*> &contextFactor, LMResult &result, const void *&state)
+{
+  size_t code = 0;
+  for (size_t i = 0; i < contextFactor.size(); ++i) {
+    code = code * VocabSize + contextFactor[i]->GetFactor(0)->GetId();
+  }
+  result.score = -static_cast<float>(code) / 7.0f;
+  result.unknown = code % 3 == 0;
+  state = contextFactor.back()->GetFactor(0);
+}
+
+class Hammer
+{
+public:
+  Hammer(NGramCache &cache, unsigned int seed) : m_cache(cache), m_seed(seed), m_errors(0) {}
+
+  void operator()() {
+    std::vector<const Word*> contextFactor;
+    for (size_t i = 0; i < Lookups; ++i) {
+      // a small vocabulary, so that the threads look up the same n-grams
+      contextFactor.resize(1 + Next() % Order);
+      for (size_t j = 0; j < contextFactor.size(); ++j) {
+        contextFactor[j] = &vocab[Next() % VocabSize];
+      }
+
+      LMResult expected, cached;
+      const void *expectedState, *cachedState;
+      Lookup(contextFactor, expected, expectedState);
+      if (m_cache.Find(contextFactor, 0, cached, cachedState)) {
+        if (cached.score != expected.score || cached.unknown != expected.unknown || cachedState != expectedState) {
+          ++m_errors;
+        }
+      } else {
+        m_cache.Add(contextFactor, 0, expected, expectedState);
+      }
+    }
+  }
+
+  size_t GetErrors() const {
+    return m_errors;
+  }
+
+private:
+  NGramCache &m_cache;
+  unsigned int m_seed;
+  size_t m_errors;
+
+  //! rand() isn't thread-safe, and each thread should get its own sequence
+  size_t Next() {
+    m_seed = m_seed * 1103515245 + 12345;
+    return (m_seed >> 16) & 0x7fff;
+  }
+};
+
+}
+
+int main()
+{
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  vocab.resize(VocabSize);
+  for (size_t i = 0; i < VocabSize; ++i) {
+    std::ostringstream word;
+    word << "w" << i;
+    vocab[i].SetFactor(0, factorCollection.AddFactor(Output, 0, word.str()));
+  }
+
+  // far fewer slots than the 8420 n-grams, so sets overflow all the time
+  NGramCache cache(Order, 64 << 10);
+  std::cout << "n-gram cache holds " << cache.GetCapacity() << " n-grams" << std::endl;
+
+  std::vector<Hammer> hammers;
+  for (size_t i = 0; i < NumThreads; ++i) {
+    hammers.push_back(Hammer(cache, i + 1));
+  }
+#ifdef WITH_THREADS
+  boost::thread_group threads;
+  for (size_t i = 0; i < NumThreads; ++i) {
+    threads.create_thread(boost::ref(hammers[i]));
+  }
+  threads.join_all();
+#else
+  for (size_t i = 0; i < NumThreads; ++i) {
+    hammers[i]();
+  }
+#endif
+
+  size_t errors = 0;
+  for (size_t i = 0; i < NumThreads; ++i) {
+    errors += hammers[i].GetErrors();
+  }
+  std::cout << cache.GetHits() << " hits, " << cache.GetMisses() << " misses, "
+            << errors << " wrong" << std::endl;
+  if (errors > 0 || cache.GetHits() == 0 || cache.GetHits() + cache.GetMisses() != NumThreads * Lookups) {
+    std::cerr << "FAILURE" << std::endl;
+    return 1;
+  }
+
+  // nothing is found after clearing the cache
+  std::vector<const Word*> contextFactor(1, &vocab[0]);
+  LMResult result;
+  const void *state;
+  Lookup(contextFactor, result, state);
+  cache.Add(contextFactor, 0, result, state);
+  cache.Clear();
+  if (cache.Find(contextFactor, 0, result, state)) {
+    std::cerr << "FAILURE: n-gram found after Clear()" << std::endl;
+    return 1;
+  }
+  return 0;
+}
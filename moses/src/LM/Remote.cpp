@@ -1,19 +1,96 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <string.h>
+#include <sstream>
+#include <boost/unordered_set.hpp>
 #include "LM/Remote.h"
 #include "Factor.h"
+#include "FactorCollection.h"
+#include "Hypothesis.h"
+#include "TranslationOptionList.h"
 
 namespace Moses
 {
 
-const Factor* LanguageModelRemote::BOS = NULL;
-const Factor* LanguageModelRemote::EOS = (LanguageModelRemote::BOS + 1);
+namespace
+{
+
+bool WriteAll(int sock, const char *buf, size_t size)
+{
+  while (size > 0) {
+    ssize_t r = write(sock, buf, size);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    buf += r;
+    size -= r;
+  }
+  return true;
+}
+
+bool ReadAll(int sock, char *buf, size_t size)
+{
+  while (size > 0) {
+    ssize_t r = read(sock, buf, size);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    if (r == 0) return false;
+    buf += r;
+    size -= r;
+  }
+  return true;
+}
+
+void AppendWord(std::string &payload, const Factor *f, const char *null)
+{
+  payload += f ? f->GetString() : null;
+  payload += '\0';
+}
+
+}
+
+void LanguageModelRemote::InitializeBeforeSentenceProcessing()
+{
+  // Manager announces its sentence twice, count each thread's sentence once
+  GetSocket();
+  Connection &connection = *m_connection;
+  if (connection.sentence) return;
+  connection.sentence = true;
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_cacheMutex);
+#endif
+  ++m_liveSentences;
+}
+
+void LanguageModelRemote::CleanUpAfterSentenceProcessing()
+{
+  Connection *connection = m_connection.get();
+  if (connection == NULL || !connection->sentence) return;
+  connection->sentence = false;
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_cacheMutex);
+#endif
+  // hypothesis states point into the cache, so only clear it once no
+  // sentence is being translated
+  if (--m_liveSentences == 0) m_cache.clear();
+}
+
+LanguageModelRemote::Connection::~Connection()
+{
+  // Step 8 When finished send all lingering transmissions and close the connection
+  if (sock >= 0) close(sock);
+}
 
 bool LanguageModelRemote::Load(const std::string &filePath
                                , FactorType factorType
@@ -22,6 +99,12 @@ bool LanguageModelRemote::Load(const std::string &filePath
   m_factorType    = factorType;
   m_nGramOrder    = nGramOrder;
 
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  m_sentenceStart = factorCollection.AddFactor(Output, m_factorType, "<s>");
+  m_sentenceStartArray[m_factorType] = m_sentenceStart;
+  m_sentenceEnd = factorCollection.AddFactor(Output, m_factorType, "</s>");
+  m_sentenceEndArray[m_factorType] = m_sentenceEnd;
+
   int cutAt = filePath.find(':',0);
   std::string host = filePath.substr(0,cutAt);
   //std::cerr << "port string = '" << filePath.substr(cutAt+1,filePath.size()-cutAt) << "'\n";
@@ -38,8 +121,9 @@ bool LanguageModelRemote::Load(const std::string &filePath
 bool LanguageModelRemote::start(const std::string& host, int port)
 {
   //std::cerr << "host = " << host << ", port = " << port << "\n";
-  sock = socket(AF_INET, SOCK_STREAM, 0);
-  hp = gethostbyname(host.c_str());
+  m_host = host;
+  this->port = port;
+  struct hostent *hp = gethostbyname(host.c_str());
   if (hp==NULL) {
     herror("gethostbyname failed");
     exit(1);
@@ -50,8 +134,12 @@ bool LanguageModelRemote::start(const std::string& host, int port)
   server.sin_family = hp->h_addrtype;
   server.sin_port = htons(port);
 
+  // the loading thread's connection
+  Connection *connection = new Connection;
+  m_connection.reset(connection);
+  connection->sock = socket(AF_INET, SOCK_STREAM, 0);
   int errors = 0;
-  while (connect(sock, (struct sockaddr *)&server, sizeof(server)) < 0) {
+  while (connect(connection->sock, (struct sockaddr *)&server, sizeof(server)) < 0) {
     //std::cerr << "Error: connect()\n";
     sleep(1);
     errors++;
@@ -60,6 +148,117 @@ bool LanguageModelRemote::start(const std::string& host, int port)
   return true;
 }
 
+int LanguageModelRemote::GetSocket() const
+{
+  Connection *connection = m_connection.get();
+  if (connection == NULL) {
+    // first lookup of this thread
+    connection = new Connection;
+    m_connection.reset(connection);
+    connection->sock = socket(AF_INET, SOCK_STREAM, 0);
+    int errors = 0;
+    while (connect(connection->sock, (struct sockaddr *)&server, sizeof(server)) < 0) {
+      sleep(1);
+      errors++;
+      if (errors > 5) {
+        std::cerr << "failed to connect to lm server on " << m_host << " on port " << port << std::endl;
+        exit(1);
+      }
+    }
+  }
+  return connection->sock;
+}
+
+void LanguageModelRemote::ClearSentenceCache()
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_cacheMutex);
+#endif
+  m_cache.clear();
+}
+
+void LanguageModelRemote::GetNGram(const std::vector<const Word*> &contextFactor, NGram &ngram) const
+{
+  size_t count = contextFactor.size();
+  size_t max = std::min(count, m_nGramOrder);
+  ngram.resize(max);
+  for (size_t i = 0; i < max; ++i) {
+    ngram[i] = contextFactor[count - max + i]->GetFactor(GetFactorType());
+  }
+}
+
+void LanguageModelRemote::Query(const std::vector<std::vector<const Word*> > &contextFactors) const
+{
+  std::vector<NGram> ngrams;
+  {
+    boost::unordered_set<NGram> queried;
+    NGram ngram;
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_cacheMutex);
+#endif
+    for (size_t i = 0; i < contextFactors.size(); ++i) {
+      if (contextFactors[i].empty()) continue;
+      GetNGram(contextFactors[i], ngram);
+      if (m_cache.find(ngram) == m_cache.end() && queried.insert(ngram).second) {
+        ngrams.push_back(ngram);
+      }
+    }
+  }
+  if (ngrams.empty()) return;
+
+  // bprob <bytes>\r\n, then the number of n-grams and each n-gram as its
+  // length followed by the words, like the arguments of "prob". Numbers are
+  // sent in network byte order, so client and server may differ in theirs
+  std::string payload;
+  uint32_t count = ngrams.size();
+  uint32_t netCount = htonl(count);
+  payload.append(reinterpret_cast<const char*>(&netCount), sizeof(netCount));
+  for (size_t i = 0; i < ngrams.size(); ++i) {
+    const NGram &ngram = ngrams[i];
+    payload += static_cast<char>(ngram.size());
+    AppendWord(payload, ngram.back(), "</s>");
+    for (size_t j = 1; j < ngram.size(); ++j) {
+      AppendWord(payload, ngram[ngram.size() - 1 - j], "<s>");
+    }
+  }
+  std::ostringstream os;
+  os << "bprob " << payload.size() << "\r\n";
+  std::string request = os.str() + payload;
+
+  // reply: PROBS <count>\r\n and the bits of the probabilities as uint32s
+  int sock = GetSocket();
+  std::string line;
+  char c = 0;
+  bool good = WriteAll(sock, request.data(), request.size());
+  while (good && c != '\n') {
+    good = ReadAll(sock, &c, 1);
+    line += c;
+  }
+  unsigned int replyCount = 0;
+  if (!good || sscanf(line.c_str(), "PROBS %u", &replyCount) != 1 || replyCount != count) {
+    std::cerr << "lm server on " << m_host << " on port " << port << " failed to answer: " << line << std::endl;
+    exit(1);
+  }
+  std::vector<uint32_t> bits(count);
+  if (!ReadAll(sock, reinterpret_cast<char*>(&bits[0]), count * sizeof(uint32_t))) {
+    std::cerr << "lm server on " << m_host << " on port " << port << " closed the connection" << std::endl;
+    exit(1);
+  }
+  std::vector<float> probs(count);
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t prob = ntohl(bits[i]);
+    memcpy(&probs[i], &prob, sizeof(float));
+  }
+
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_cacheMutex);
+#endif
+  for (size_t i = 0; i < ngrams.size(); ++i) {
+    // another thread may have looked up the same n-gram meanwhile
+    m_cache.insert(std::make_pair(ngrams[i], FloorScore(TransformLMScore(probs[i]))));
+  }
+}
+
 LMResult LanguageModelRemote::GetValue(const std::vector<const Word*> &contextFactor, State* finalState) const
 {
   LMResult ret;
@@ -70,75 +269,56 @@ LMResult LanguageModelRemote::GetValue(const std::vector<const Word*> &contextFa
     ret.score = 0.0;
     return ret;
   }
-  //std::cerr << "contextFactor.size() = " << count << "\n";
-  size_t max = m_nGramOrder;
-  const FactorType factor = GetFactorType();
-  if (max > count) max = count;
-
-  Cache* cur = &m_cache;
-  int pc = static_cast<int>(count) - 1;
-  for (int i = 0; i < pc; ++i) {
-    const Factor* f = contextFactor[i]->GetFactor(factor);
-    cur = &cur->tree[f ? f : BOS];
-  }
-  const Factor* event_word = contextFactor[pc]->GetFactor(factor);
-  cur = &cur->tree[event_word ? event_word : EOS];
-  if (cur->prob) {
-    if (finalState) *finalState = cur->boState;
-    ret.score = cur->prob;
-    return ret;
-  }
-  cur->boState = *reinterpret_cast<const State*>(&m_curId);
-  ++m_curId;
 
-  std::ostringstream os;
-  os << "prob ";
-  if (event_word == NULL) {
-    os << "</s>";
-  } else {
-    os << event_word->GetString();
-  }
-  for (size_t i=1; i<max; i++) {
-    const Factor* f = contextFactor[count-1-i]->GetFactor(factor);
-    if (f == NULL) {
-      os << " <s>";
-    } else {
-      os << ' ' << f->GetString();
-    }
+  NGram ngram;
+  GetNGram(contextFactor, ngram);
+  // the address of an entry stays valid when another thread's Query() rehashes the cache
+  const std::pair<const NGram, float> *entry = NULL;
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_cacheMutex);
+#endif
+    boost::unordered_map<NGram, float>::const_iterator iter = m_cache.find(ngram);
+    if (iter != m_cache.end()) entry = &*iter;
   }
-  os << std::endl;
-  std::string out = os.str();
-  write(sock, out.c_str(), out.size());
-  char res[6];
-  int r = read(sock, res, 6);
-  int errors = 0;
-  int cnt = 0;
-  while (1) {
-    if (r < 0) {
-      errors++;
-      sleep(1);
-      //std::cerr << "Error: read()\n";
-      if (errors > 5) exit(1);
-    } else if (r==0 || res[cnt] == '\n') {
-      break;
-    } else {
-      cnt += r;
-      if (cnt==6) break;
-      read(sock, &res[cnt], 6-cnt);
-    }
+  if (!entry) {
+    Query(std::vector<std::vector<const Word*> >(1, contextFactor));
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_cacheMutex);
+#endif
+    entry = &*m_cache.find(ngram);
   }
-  cur->prob = FloorScore(TransformLMScore(*reinterpret_cast<float*>(res)));
+  ret.score = entry->second;
   if (finalState) {
-    *finalState = cur->boState;
+    // entries are only erased between sentences, so the address identifies the n-gram
+    *finalState = entry;
   }
-  ret.score = cur->prob;
   return ret;
 }
 
+void LanguageModelRemote::PrefetchPhrases(const std::vector<const Phrase*> &phrases) const
+{
+  std::vector<std::vector<const Word*> > contextFactors;
+  for (size_t i = 0; i < phrases.size(); ++i) {
+    GetPhraseNGrams(*phrases[i], contextFactors);
+  }
+  Query(contextFactors);
+}
+
+void LanguageModelRemote::PrefetchExtensions(const LanguageModel::Extensions &extensions) const
+{
+  std::vector<std::vector<const Word*> > contextFactors;
+  for (size_t i = 0; i < extensions.size(); ++i) {
+    const TranslationOptionList &transOptList = *extensions[i].second;
+    for (size_t j = 0; j < transOptList.size(); ++j) {
+      GetExtensionNGrams(*extensions[i].first, *transOptList.Get(j), contextFactors);
+    }
+  }
+  Query(contextFactors);
+}
+
 LanguageModelRemote::~LanguageModelRemote()
 {
-  // Step 8 When finished send all lingering transmissions and close the connection
-  close(sock);
 }
 
 }
@@ -4,38 +4,69 @@
 #include "LM/SingleFactor.h"
 #include "TypeDef.h"
 #include "Factor.h"
+#include <memory>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netinet/in.h>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#endif
 
 namespace Moses
 {
 
+/** Language model served by lmserver. Lookups that the decoder announces in
+ * advance (see LanguageModel::PrefetchPhrases() and PrefetchExtensions()) are
+ * sent in one "bprob" request, the others one at a time. Each decoder thread
+ * has its own connection to the server, the probabilities are cached for all
+ * and dropped whenever no sentence is being translated.
+ */
 class LanguageModelRemote : public LanguageModelPointerState
 {
 private:
-  struct Cache {
-    std::map<const Factor*, Cache> tree;
-    float prob;
-    State boState;
-    Cache() : prob(0) {}
+  //! factors of an n-gram, oldest word first. NULL stands for <s> or </s>
+  typedef std::vector<const Factor*> NGram;
+
+  //! connection of one decoder thread
+  struct Connection {
+    int sock;
+    //! whether this thread is translating a sentence
+    bool sentence;
+    Connection() : sock(-1), sentence(false) {}
+    ~Connection();
   };
 
-  int sock, port;
-  struct hostent *hp;
+  std::string m_host;
+  int port;
   struct sockaddr_in server;
-  mutable size_t m_curId;
-  mutable Cache m_cache;
+#ifdef WITH_THREADS
+  mutable boost::thread_specific_ptr<Connection> m_connection;
+  mutable boost::mutex m_cacheMutex;
+#else
+  mutable std::auto_ptr<Connection> m_connection;
+#endif
+  //! probabilities of the n-grams looked up so far
+  mutable boost::unordered_map<NGram, float> m_cache;
+  //! number of sentences being translated, guarded like m_cache
+  size_t m_liveSentences;
+
   bool start(const std::string& host, int port);
-  static const Factor* BOS;
-  static const Factor* EOS;
+  int GetSocket() const;
+  void GetNGram(const std::vector<const Word*> &contextFactor, NGram &ngram) const;
+  //! look up the n-grams that aren't cached yet in one request
+  void Query(const std::vector<std::vector<const Word*> > &contextFactors) const;
 public:
+  LanguageModelRemote() : m_liveSentences(0) {}
   ~LanguageModelRemote();
-  void ClearSentenceCache() {
-    m_cache.tree.clear();
-    m_curId = 1000;
-  }
+  void ClearSentenceCache();
+  void InitializeBeforeSentenceProcessing();
+  void CleanUpAfterSentenceProcessing();
   virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = 0) const;
+  void PrefetchPhrases(const std::vector<const Phrase*> &phrases) const;
+  void PrefetchExtensions(const LanguageModel::Extensions &extensions) const;
   bool Load(const std::string &filePath
             , FactorType factorType
             , size_t nGramOrder);
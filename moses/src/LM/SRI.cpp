@@ -66,6 +66,9 @@ bool LanguageModelSRI::Load(const std::string &filePath
   CreateFactors();
   m_unknownId = m_srilmVocab->unkIndex();
 
+  // contextID() points into the model, so the states can be shared
+  UseNGramCache(StaticData::Instance().GetLMNGramCacheBytes());
+
   return true;
 }
 
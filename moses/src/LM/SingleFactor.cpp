@@ -23,8 +23,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <limits>
 #include <iostream>
 #include <sstream>
+#include <boost/functional/hash.hpp>
 
 #include "LM/SingleFactor.h"
+#include "LM/NGramCache.h"
 #include "TypeDef.h"
 #include "Util.h"
 #include "FactorCollection.h"
@@ -59,15 +61,36 @@ struct PointerState : public FFState {
     else if (other.lmstate < lmstate) return -1;
     return 0;
   }
+  size_t Hash() const {
+    return boost::hash_value(lmstate);
+  }
 };
 
 LanguageModelPointerState::LanguageModelPointerState()
+  : m_ngramCache(NULL)
 {
   m_nullContextState = new PointerState(NULL);
   m_beginSentenceState = new PointerState(NULL);
 }
 
-LanguageModelPointerState::~LanguageModelPointerState() {}
+LanguageModelPointerState::~LanguageModelPointerState()
+{
+  if (m_ngramCache) {
+    VERBOSE(1, "n-gram cache of " << m_filePath << ": " << m_ngramCache->GetHits() << " hits, "
+            << m_ngramCache->GetMisses() << " misses" << endl);
+    delete m_ngramCache;
+  }
+}
+
+void LanguageModelPointerState::UseNGramCache(size_t maxBytes)
+{
+  delete m_ngramCache;
+  m_ngramCache = NULL;
+  if (maxBytes > 0) {
+    m_ngramCache = new NGramCache(m_nGramOrder, maxBytes);
+    VERBOSE(1, "n-gram cache of " << m_filePath << " holds " << m_ngramCache->GetCapacity() << " n-grams" << endl);
+  }
+}
 
 const FFState *LanguageModelPointerState::GetNullContextState() const
 {
@@ -86,7 +109,17 @@ FFState *LanguageModelPointerState::NewState(const FFState *from) const
 
 LMResult LanguageModelPointerState::GetValueForgotState(const std::vector<const Word*> &contextFactor, FFState &outState) const
 {
-  return GetValue(contextFactor, &static_cast<PointerState&>(outState).lmstate);
+  State &state = static_cast<PointerState&>(outState).lmstate;
+  if (m_ngramCache == NULL) {
+    return GetValue(contextFactor, &state);
+  }
+
+  LMResult ret;
+  if (!m_ngramCache->Find(contextFactor, m_factorType, ret, state)) {
+    ret = GetValue(contextFactor, &state);
+    m_ngramCache->Add(contextFactor, m_factorType, ret, state);
+  }
+  return ret;
 }
 
 }
@@ -30,6 +30,7 @@ namespace Moses
 
 class FactorCollection;
 class Factor;
+class NGramCache;
 
 //! Abstract class for for single factor LM
 class LanguageModelSingleFactor : public LanguageModelImplementation
@@ -70,11 +71,19 @@ class LanguageModelPointerState : public LanguageModelSingleFactor
 private:
   FFState *m_nullContextState;
   FFState *m_beginSentenceState;
+  NGramCache *m_ngramCache;
 protected:
   typedef const void *State;
 
   LanguageModelPointerState();
 
+  /** Keep the scores and states of looked up n-grams in a cache of maxBytes
+   * shared by all threads (see NGramCache). Call in Load() once
+   * m_nGramOrder is known. Only for models whose states are addresses that
+   * stay valid until the model is destroyed.
+   */
+  void UseNGramCache(size_t maxBytes);
+
   virtual ~LanguageModelPointerState();
 
   virtual const FFState *GetNullContextState() const;
@@ -71,6 +71,38 @@ void LMList::CalcScore(const Phrase &phrase, float &retFullScore, float &retNGra
   }
 }
 
+void LMList::PrefetchPhrases(const std::vector<const Phrase*> &phrases) const
+{
+  const_iterator lmIter;
+  for (lmIter = begin(); lmIter != end(); ++lmIter) {
+    (*lmIter)->PrefetchPhrases(phrases);
+  }
+}
+
+void LMList::PrefetchExtensions(const LanguageModel::Extensions &extensions) const
+{
+  const_iterator lmIter;
+  for (lmIter = begin(); lmIter != end(); ++lmIter) {
+    (*lmIter)->PrefetchExtensions(extensions);
+  }
+}
+
+void LMList::PrefetchMemory(const LanguageModel::Extensions &extensions) const
+{
+  const_iterator lmIter;
+  for (lmIter = begin(); lmIter != end(); ++lmIter) {
+    (*lmIter)->PrefetchMemory(extensions);
+  }
+}
+
+void LMList::PrefetchChartMemory(const std::vector<const ChartHypothesis*> &hypos) const
+{
+  const_iterator lmIter;
+  for (lmIter = begin(); lmIter != end(); ++lmIter) {
+    (*lmIter)->PrefetchChartMemory(hypos);
+  }
+}
+
 void LMList::Add(LanguageModel *lm)
 {
   m_coll.push_back(lm);
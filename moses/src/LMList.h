@@ -42,6 +42,14 @@ public:
   ~LMList();
 
   void CalcScore(const Phrase &phrase, float &retFullScore, float &retNGramScore, float &retOOVScore,  ScoreComponentCollection* breakdown) const;
+  //! see LanguageModel::PrefetchPhrases()
+  void PrefetchPhrases(const std::vector<const Phrase*> &phrases) const;
+  //! see LanguageModel::PrefetchExtensions()
+  void PrefetchExtensions(const LanguageModel::Extensions &extensions) const;
+  //! see LanguageModel::PrefetchMemory()
+  void PrefetchMemory(const LanguageModel::Extensions &extensions) const;
+  //! see LanguageModel::PrefetchChartMemory()
+  void PrefetchChartMemory(const std::vector<const ChartHypothesis*> &hypos) const;
 
   void Add(LanguageModel *lm);
 
@@ -2,6 +2,7 @@
 #include <vector>
 #include <string>
 #include <cassert>
+#include <boost/functional/hash.hpp>
 
 #include "FFState.h"
 #include "Hypothesis.h"
@@ -168,6 +169,15 @@ int LexicalReorderingState::ComparePrevScores(const Scores *other) const
   return 0;
 }
 
+size_t LexicalReorderingState::HashPrevScores() const
+{
+  if (m_prevScore == NULL)
+    return 0;
+
+  const Scores &my = *m_prevScore;
+  return boost::hash_range(my.begin() + m_offset, my.begin() + m_offset + m_configuration.GetNumberOfTypes());
+}
+
 PhraseBasedReorderingState::PhraseBasedReorderingState(const PhraseBasedReorderingState *prev, const TranslationOption &topt)
   : LexicalReorderingState(prev, topt), m_prevRange(topt.GetSourceWordsRange()), m_first(false) {}
 
@@ -196,6 +206,15 @@ int PhraseBasedReorderingState::Compare(const FFState& o) const
   return 1;
 }
 
+size_t PhraseBasedReorderingState::Hash() const
+{
+  size_t seed = hash_value(m_prevRange);
+  if (m_direction == LexicalReorderingConfiguration::Forward) {
+    boost::hash_combine(seed, HashPrevScores());
+  }
+  return seed;
+}
+
 LexicalReorderingState* PhraseBasedReorderingState::Expand(const TranslationOption& topt, Scores& scores) const
 {
   ReorderingType reoType;
@@ -293,6 +312,13 @@ int BidirectionalReorderingState::Compare(const FFState& o) const
     return m_forward->Compare(*other.m_forward);
 }
 
+size_t BidirectionalReorderingState::Hash() const
+{
+  size_t seed = m_backward->Hash();
+  boost::hash_combine(seed, m_forward->Hash());
+  return seed;
+}
+
 LexicalReorderingState* BidirectionalReorderingState::Expand(const TranslationOption& topt, Scores& scores) const
 {
   LexicalReorderingState *newbwd = m_backward->Expand(topt, scores);
@@ -317,6 +343,11 @@ int HierarchicalReorderingBackwardState::Compare(const FFState& o) const
   return m_reoStack.Compare(other.m_reoStack);
 }
 
+size_t HierarchicalReorderingBackwardState::Hash() const
+{
+  return m_reoStack.Hash();
+}
+
 LexicalReorderingState* HierarchicalReorderingBackwardState::Expand(const TranslationOption& topt, Scores& scores) const
 {
 
@@ -409,6 +440,13 @@ int HierarchicalReorderingForwardState::Compare(const FFState& o) const
   return 1;
 }
 
+size_t HierarchicalReorderingForwardState::Hash() const
+{
+  size_t seed = hash_value(m_prevRange);
+  boost::hash_combine(seed, HashPrevScores());
+  return seed;
+}
+
 // For compatibility with the phrase-based reordering model, scoring is one step delayed.
 // The forward model takes determines orientations heuristically as follows:
 //  mono:   if the next phrase comes after the conditioning phrase and
@@ -449,7 +487,7 @@ LexicalReorderingState* HierarchicalReorderingForwardState::Expand(const Transla
   return new HierarchicalReorderingForwardState(this, topt);
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSD(WordsRange currRange, WordsBitmap coverage) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSD(WordsRange currRange, const WordsBitmap &coverage) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos() &&
       (!coverage.GetValue(m_prevRange.GetEndPos()+1) || currRange.GetStartPos() == m_prevRange.GetEndPos()+1)) {
@@ -461,7 +499,7 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOr
   return D;
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSLR(WordsRange currRange, WordsBitmap coverage) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMSLR(WordsRange currRange, const WordsBitmap &coverage) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos() &&
       (!coverage.GetValue(m_prevRange.GetEndPos()+1) || currRange.GetStartPos() == m_prevRange.GetEndPos()+1)) {
@@ -475,7 +513,7 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOr
   return DL;
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMonotonic(WordsRange currRange, WordsBitmap coverage) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeMonotonic(WordsRange currRange, const WordsBitmap &coverage) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos() &&
       (!coverage.GetValue(m_prevRange.GetEndPos()+1) || currRange.GetStartPos() == m_prevRange.GetEndPos()+1)) {
@@ -484,7 +522,7 @@ LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOr
   return NM;
 }
 
-LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeLeftRight(WordsRange currRange, WordsBitmap /* coverage */) const
+LexicalReorderingState::ReorderingType HierarchicalReorderingForwardState::GetOrientationTypeLeftRight(WordsRange currRange, const WordsBitmap & /* coverage */) const
 {
   if (currRange.GetStartPos() > m_prevRange.GetEndPos()) {
     return R;
@@ -0,0 +1,451 @@
+// $Id$
+// vim:tabstop=2
+/***********************************************************************
+ Moses - factored phrase-based language decoder
+ Copyright (C) 2006 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdlib.h>
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include "util/exception.hh"
+#include "util/file.hh"
+#include "util/file_piece.hh"
+#include "util/tokenize_piece.hh"
+
+#include "MMapPhraseTable.h"
+#include "Util.h"
+#include "UserMessage.h"
+
+namespace Moses
+{
+
+const MMapPhraseTable::NodeId MMapPhraseTable::NotFound = std::numeric_limits<NodeId>::max();
+
+namespace
+{
+const char kMagic[8] = "mmphr2\n";
+
+//! sections start at multiples of 8 bytes
+UINT64 Align(UINT64 offset)
+{
+  return (offset + 7) & ~static_cast<UINT64>(7);
+}
+
+void WriteSection(int fd, UINT64 &written, UINT64 offset, const void *data, size_t size)
+{
+  static const char padding[8] = {0};
+  assert(offset >= written && offset - written < 8);
+  util::WriteOrThrow(fd, padding, offset - written);
+  util::WriteOrThrow(fd, data, size);
+  written = offset + size;
+}
+
+template <class T> void WriteSection(int fd, UINT64 &written, UINT64 offset, const std::vector<T> &data)
+{
+  WriteSection(fd, written, offset, data.empty() ? NULL : &data[0], data.size() * sizeof(T));
+}
+
+//! set the code of score ind in an array of bits-wide codes, see MMapPhraseTable::GetScore()
+void SetCode(std::vector<unsigned char> &codes, size_t ind, unsigned bits, unsigned code)
+{
+  const size_t bit = ind * bits;
+  const unsigned shifted = code << (bit & 7);
+  codes[bit >> 3] |= shifted & 0xff;
+  codes[(bit >> 3) + 1] |= shifted >> 8;
+}
+
+/** equal-count binning of each score component: the sorted values are split
+ * into 2^bits bins, each represented by its mean. The codes are packed into
+ * bits bits each, with a spare byte at the end so that a code can always be
+ * read as two bytes */
+void Quantize(const std::vector<float> &scores, size_t numScores, unsigned bits
+              , std::vector<float> &codebook, std::vector<unsigned char> &codes)
+{
+  const size_t numBins = 1 << bits;
+  const size_t numTargets = scores.size() / numScores;
+  codebook.resize(numScores * numBins);
+  codes.assign((scores.size() * bits + 7) / 8 + 1, 0);
+
+  std::vector<float> values(numTargets);
+  for (size_t component = 0; component < numScores; ++component) {
+    for (size_t target = 0; target < numTargets; ++target) {
+      values[target] = scores[target * numScores + component];
+    }
+    std::sort(values.begin(), values.end());
+
+    float *centers = &codebook[component * numBins];
+    for (size_t bin = 0; bin < numBins; ++bin) {
+      size_t begin = bin * numTargets / numBins, end = (bin + 1) * numTargets / numBins;
+      if (begin == end) {
+        // fewer values than bins
+        centers[bin] = bin ? centers[bin - 1] : 0;
+        continue;
+      }
+      double sum = 0;
+      for (size_t i = begin; i < end; ++i) {
+        sum += values[i];
+      }
+      centers[bin] = sum / (end - begin);
+    }
+
+    // centers are sorted, pick the closest one
+    for (size_t target = 0; target < numTargets; ++target) {
+      float score = scores[target * numScores + component];
+      size_t bin = std::upper_bound(centers, centers + numBins, score) - centers;
+      if (bin == numBins || (bin > 0 && score - centers[bin - 1] <= centers[bin] - score)) {
+        --bin;
+      }
+      SetCode(codes, target * numScores + component, bits, bin);
+    }
+  }
+}
+
+//! orders word ids by their strings
+class WordOrderer
+{
+public:
+  WordOrderer(const std::string &strings, const std::vector<UINT64> &offsets)
+    : m_strings(strings.c_str()), m_offsets(offsets) {}
+
+  bool operator()(UINT32 a, UINT32 b) const {
+    return strcmp(m_strings + m_offsets[a], m_strings + m_offsets[b]) < 0;
+  }
+
+private:
+  const char *m_strings;
+  const std::vector<UINT64> &m_offsets;
+};
+
+void ReportError(const std::string &filePath, size_t lineNum, const std::string &msg)
+{
+  std::stringstream strme;
+  strme << filePath << ":" << lineNum << ": " << msg;
+  UserMessage::Add(strme.str());
+}
+}
+
+MMapPhraseTable::MMapPhraseTable()
+  : m_header(NULL)
+{
+}
+
+bool MMapPhraseTable::Load(const std::string &filePath)
+{
+  try {
+    util::scoped_fd file(util::OpenReadOrThrow(filePath.c_str()));
+    off_t size = util::SizeFile(file.get());
+    if (size == util::kBadSize || static_cast<UINT64>(size) < sizeof(Header)) {
+      UserMessage::Add(filePath + " is not a binary phrase table");
+      return false;
+    }
+    util::MapRead(util::LAZY, file.get(), 0, size, m_memory);
+  } catch (util::Exception &e) {
+    UserMessage::Add(e.what());
+    return false;
+  }
+
+  const char *base = m_memory.begin();
+  m_header = reinterpret_cast<const Header*>(base);
+  if (memcmp(m_header->magic, kMagic, sizeof(kMagic)) != 0
+      || m_header->fileSize != m_memory.size()) {
+    UserMessage::Add(filePath + " is not a binary phrase table, or it is truncated. Create it with processPhraseTableMMap");
+    return false;
+  }
+
+  m_strings = base + m_header->strings;
+  m_wordOffsets = reinterpret_cast<const UINT64*>(base + m_header->wordOffsets);
+  m_sortedWords = reinterpret_cast<const WordId*>(base + m_header->sortedWords);
+  m_nodes = reinterpret_cast<const Node*>(base + m_header->nodes);
+  m_edges = reinterpret_cast<const Edge*>(base + m_header->edges);
+  m_targetWordsBegin = reinterpret_cast<const UINT64*>(base + m_header->targetWordsBegin);
+  m_targetWords = reinterpret_cast<const WordId*>(base + m_header->targetWords);
+  m_alignments = reinterpret_cast<const UINT64*>(base + m_header->alignments);
+  m_scores = reinterpret_cast<const float*>(base + m_header->scores);
+  m_scoreCodes = reinterpret_cast<const unsigned char*>(base + m_header->scores);
+  m_codebook = reinterpret_cast<const float*>(base + m_header->codebook);
+  return true;
+}
+
+bool MMapPhraseTable::FindWord(const char *word, WordId &id) const
+{
+  const WordId *begin = m_sortedWords, *end = m_sortedWords + m_header->numWords;
+  while (begin < end) {
+    const WordId *middle = begin + (end - begin) / 2;
+    int cmp = strcmp(GetWord(*middle), word);
+    if (cmp == 0) {
+      id = *middle;
+      return true;
+    } else if (cmp < 0) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return false;
+}
+
+MMapPhraseTable::NodeId MMapPhraseTable::GetChild(NodeId node, WordId word) const
+{
+  const Node &parent = m_nodes[node];
+  const Edge *begin = m_edges + parent.firstEdge, *end = begin + parent.numEdges;
+  while (begin < end) {
+    const Edge *middle = begin + (end - begin) / 2;
+    if (middle->word == word) {
+      return middle->node;
+    } else if (middle->word < word) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return NotFound;
+}
+
+void MMapPhraseTable::GetTargets(NodeId node, TargetId &begin, TargetId &end) const
+{
+  begin = m_nodes[node].firstTarget;
+  end = begin + m_nodes[node].numTargets;
+}
+
+bool MMapPhraseTable::Create(const std::string &textPath, const std::string &binaryPath
+                             , unsigned quantizeBits)
+{
+  if (quantizeBits > 8) {
+    UserMessage::Add("Scores can be quantized to at most 8 bits");
+    return false;
+  }
+
+  // the string pool starts with the empty string, used for missing alignments
+  std::string strings(1, '\0');
+  boost::unordered_map<std::string, WordId> vocab;
+  std::vector<UINT64> wordOffsets;
+  boost::unordered_map<std::string, UINT64> alignmentOffsets;
+
+  // trie, with the edges keyed by parent node and word
+  std::vector<Node> nodes(1);
+  nodes[0].firstTarget = nodes[0].firstEdge = nodes[0].numTargets = nodes[0].numEdges = 0;
+  boost::unordered_map<UINT64, NodeId> edges;
+
+  std::vector<UINT64> targetWordsBegin(1, 0);
+  std::vector<WordId> targetWords;
+  std::vector<UINT64> alignments;
+  std::vector<float> scores;
+  size_t numScores = 0, numElement = 0;
+
+  try {
+    util::FilePiece inFile(textPath.c_str(), &std::cerr);
+
+    std::string prevSource;
+    NodeId sourceNode = 0;
+    std::vector<WordId> phrase;
+    for (size_t lineNum = 1; ; ++lineNum) {
+      StringPiece line;
+      try {
+        line = inFile.ReadLine();
+      } catch (util::EndOfFileException &e) {
+        break;
+      }
+
+      util::TokenIter<util::MultiCharacter> pipes(line, util::MultiCharacter("|||"));
+      StringPiece fields[3];
+      for (size_t i = 0; i < 3; ++i, ++pipes) {
+        if (!pipes) {
+          ReportError(textPath, lineNum, "syntax error, expected source ||| target ||| scores");
+          return false;
+        }
+        fields[i] = *pipes;
+      }
+      StringPiece alignment;
+      size_t consumed = 3;
+      if (pipes) {
+        alignment = *pipes++;
+        ++consumed;
+      }
+      for (; pipes; ++pipes, ++consumed) {}
+      if (numElement == 0) {
+        numElement = consumed;
+      } else if (numElement != consumed) {
+        ReportError(textPath, lineNum, "syntax error, inconsistent number of fields");
+        return false;
+      }
+
+      // words of the source and target phrase
+      for (size_t side = 0; side < 2; ++side) {
+        phrase.clear();
+        for (util::TokenIter<util::AnyCharacter, true> word(fields[side], util::AnyCharacter(" \t")); word; ++word) {
+          std::pair<boost::unordered_map<std::string, WordId>::iterator, bool> ret
+          = vocab.insert(std::make_pair(word->as_string(), static_cast<WordId>(wordOffsets.size())));
+          if (ret.second) {
+            wordOffsets.push_back(strings.size());
+            strings.append(word->data(), word->size());
+            strings.push_back('\0');
+          }
+          phrase.push_back(ret.first->second);
+        }
+
+        if (side == 1) {
+          targetWords.insert(targetWords.end(), phrase.begin(), phrase.end());
+          targetWordsBegin.push_back(targetWords.size());
+          break;
+        }
+        if (phrase.empty()) {
+          ReportError(textPath, lineNum, "empty source phrase");
+          return false;
+        }
+        if (fields[0] == StringPiece(prevSource)) {
+          continue;
+        }
+
+        // new source phrase: find or create its node
+        prevSource.assign(fields[0].data(), fields[0].size());
+        sourceNode = 0;
+        for (size_t i = 0; i < phrase.size(); ++i) {
+          if (nodes.size() == NotFound) {
+            ReportError(textPath, lineNum, "too many source phrase prefixes for the binary phrase table");
+            return false;
+          }
+          UINT64 key = (static_cast<UINT64>(sourceNode) << 32) | phrase[i];
+          std::pair<boost::unordered_map<UINT64, NodeId>::iterator, bool> ret
+          = edges.insert(std::make_pair(key, static_cast<NodeId>(nodes.size())));
+          if (ret.second) {
+            nodes.push_back(nodes[0]);
+            nodes.back().numTargets = nodes.back().numEdges = 0;
+          }
+          sourceNode = ret.first->second;
+        }
+        if (nodes[sourceNode].numTargets > 0) {
+          ReportError(textPath, lineNum, "source phrase " + prevSource
+                      + " seen before, the phrase table has to be sorted (LC_ALL=C sort)");
+          return false;
+        }
+        nodes[sourceNode].firstTarget = alignments.size();
+      }
+      ++nodes[sourceNode].numTargets;
+
+      // scores, in the same form as the text phrase table uses them
+      size_t numTargetScores = 0;
+      for (util::TokenIter<util::AnyCharacter, true> token(fields[2], util::AnyCharacter(" \t")); token; ++token, ++numTargetScores) {
+        char *err_ind;
+        scores.push_back(FloorScore(TransformScore(static_cast<float>(strtod(token->data(), &err_ind)))));
+        if (err_ind == token->data()) {
+          ReportError(textPath, lineNum, "bad number " + token->as_string());
+          return false;
+        }
+      }
+      if (numScores == 0) {
+        numScores = numTargetScores;
+      } else if (numScores != numTargetScores) {
+        ReportError(textPath, lineNum, "inconsistent number of scores");
+        return false;
+      }
+
+      std::pair<boost::unordered_map<std::string, UINT64>::iterator, bool> ret
+      = alignmentOffsets.insert(std::make_pair(alignment.as_string(), strings.size()));
+      if (ret.second) {
+        strings.append(alignment.data(), alignment.size());
+        strings.push_back('\0');
+      }
+      alignments.push_back(ret.first->second);
+    }
+  } catch (util::Exception &e) {
+    UserMessage::Add(e.what());
+    return false;
+  }
+
+  // children of each node, sorted by word id
+  std::vector<std::pair<UINT64, NodeId> > sortedEdges(edges.begin(), edges.end());
+  edges.clear();
+  std::sort(sortedEdges.begin(), sortedEdges.end());
+  std::vector<Edge> edgeArray(sortedEdges.size());
+  for (size_t i = 0; i < sortedEdges.size(); ++i) {
+    NodeId parent = sortedEdges[i].first >> 32;
+    edgeArray[i].word = sortedEdges[i].first & 0xffffffff;
+    edgeArray[i].node = sortedEdges[i].second;
+    if (nodes[parent].numEdges++ == 0) {
+      nodes[parent].firstEdge = i;
+    }
+  }
+
+  std::vector<WordId> sortedWords(wordOffsets.size());
+  for (size_t i = 0; i < sortedWords.size(); ++i) {
+    sortedWords[i] = i;
+  }
+  std::sort(sortedWords.begin(), sortedWords.end(), WordOrderer(strings, wordOffsets));
+
+  std::vector<float> codebook;
+  std::vector<unsigned char> scoreCodes;
+  if (quantizeBits) {
+    Quantize(scores, numScores, quantizeBits, codebook, scoreCodes);
+  }
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.numScores = numScores;
+  header.quantizeBits = quantizeBits;
+  header.hasAlignment = (numElement > 3);
+  header.numWords = wordOffsets.size();
+  header.numNodes = nodes.size();
+  header.numEdges = edgeArray.size();
+  header.numTargets = alignments.size();
+  header.numTargetWords = targetWords.size();
+
+  const size_t scoresSize = quantizeBits ? scoreCodes.size() : scores.size() * sizeof(float);
+  header.strings = Align(sizeof(Header));
+  header.wordOffsets = Align(header.strings + strings.size());
+  header.sortedWords = Align(header.wordOffsets + wordOffsets.size() * sizeof(UINT64));
+  header.nodes = Align(header.sortedWords + sortedWords.size() * sizeof(WordId));
+  header.edges = Align(header.nodes + nodes.size() * sizeof(Node));
+  header.targetWordsBegin = Align(header.edges + edgeArray.size() * sizeof(Edge));
+  header.targetWords = Align(header.targetWordsBegin + targetWordsBegin.size() * sizeof(UINT64));
+  header.alignments = Align(header.targetWords + targetWords.size() * sizeof(WordId));
+  header.scores = Align(header.alignments + alignments.size() * sizeof(UINT64));
+  header.codebook = Align(header.scores + scoresSize);
+  header.fileSize = header.codebook + codebook.size() * sizeof(float);
+
+  try {
+    util::scoped_fd file(util::CreateOrThrow(binaryPath.c_str()));
+    UINT64 written = 0;
+    WriteSection(file.get(), written, 0, &header, sizeof(header));
+    WriteSection(file.get(), written, header.strings, strings.data(), strings.size());
+    WriteSection(file.get(), written, header.wordOffsets, wordOffsets);
+    WriteSection(file.get(), written, header.sortedWords, sortedWords);
+    WriteSection(file.get(), written, header.nodes, nodes);
+    WriteSection(file.get(), written, header.edges, edgeArray);
+    WriteSection(file.get(), written, header.targetWordsBegin, targetWordsBegin);
+    WriteSection(file.get(), written, header.targetWords, targetWords);
+    WriteSection(file.get(), written, header.alignments, alignments);
+    if (quantizeBits) {
+      WriteSection(file.get(), written, header.scores, scoreCodes);
+    } else {
+      WriteSection(file.get(), written, header.scores, scores);
+    }
+    WriteSection(file.get(), written, header.codebook, codebook);
+    assert(written == header.fileSize);
+  } catch (util::Exception &e) {
+    UserMessage::Add(e.what());
+    return false;
+  }
+  return true;
+}
+
+}
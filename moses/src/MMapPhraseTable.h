@@ -0,0 +1,157 @@
+// $Id$
+// vim:tabstop=2
+/***********************************************************************
+ Moses - factored phrase-based language decoder
+ Copyright (C) 2006 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#ifndef moses_MMapPhraseTable_h
+#define moses_MMapPhraseTable_h
+
+#include <string>
+#include "util/mmap.hh"
+#include "TypeDef.h"
+
+namespace Moses
+{
+
+/** Read-only binary phrase table that is used straight from a memory map.
+ *
+ * The file contains
+ *  - the vocabulary: NUL-terminated words in a string pool, the pool offset
+ *    of each word id, and the word ids sorted by string for lookup,
+ *  - a trie over the source phrases, with the children of each node sorted
+ *    by word id,
+ *  - the target phrases of each source phrase in one contiguous block: word
+ *    ids, scores (raw floats, or bit-packed codes into a codebook per score
+ *    component) and the alignment, if the text table had one.
+ *
+ * Lookups only read the mapping and take no locks. All decoder threads and
+ * processes using the same file share its pages in the page cache.
+ */
+class MMapPhraseTable
+{
+public:
+  typedef UINT32 WordId;
+  typedef UINT32 NodeId;
+  typedef UINT64 TargetId;
+
+  static const NodeId NotFound;
+
+  MMapPhraseTable();
+
+  /** map the binary file, returns false after reporting the problem to
+   * UserMessage if the file can't be used */
+  bool Load(const std::string &filePath);
+
+  /** convert a text phrase table into a binary file. The table has to be
+   * sorted by source phrase, as the decoder expects for text tables anyway.
+   * Scores are stored as floats, or quantized to quantizeBits (1 to 8) bits
+   * per score */
+  static bool Create(const std::string &textPath, const std::string &binaryPath
+                     , unsigned quantizeBits);
+
+  size_t GetNumScores() const {
+    return m_header->numScores;
+  }
+
+  //! word id of a (factored) word string, false if the table doesn't contain it
+  bool FindWord(const char *word, WordId &id) const;
+  //! zero-terminated string of a word id
+  const char *GetWord(WordId id) const {
+    return m_strings + m_wordOffsets[id];
+  }
+
+  NodeId GetRoot() const {
+    return 0;
+  }
+  //! node reached by appending word to the source phrase of node, or NotFound
+  NodeId GetChild(NodeId node, WordId word) const;
+
+  //! target phrases of the source phrase that ends at node are [begin, end)
+  void GetTargets(NodeId node, TargetId &begin, TargetId &end) const;
+
+  size_t GetTargetSize(TargetId target) const {
+    return m_targetWordsBegin[target + 1] - m_targetWordsBegin[target];
+  }
+  //! GetTargetSize() word ids of the target phrase, pointing into the mapping
+  const WordId *GetTargetWords(TargetId target) const {
+    return m_targetWords + m_targetWordsBegin[target];
+  }
+  float GetScore(TargetId target, size_t component) const {
+    size_t ind = target * m_header->numScores + component;
+    if (!m_header->quantizeBits) {
+      return m_scores[ind];
+    }
+    // codes are quantizeBits wide and may straddle two bytes
+    const unsigned bits = m_header->quantizeBits;
+    const size_t bit = ind * bits;
+    unsigned code = (m_scoreCodes[bit >> 3] | (m_scoreCodes[(bit >> 3) + 1] << 8)) >> (bit & 7);
+    code &= (1 << bits) - 1;
+    return m_codebook[(component << bits) + code];
+  }
+  //! alignment string of the target phrase, empty if the table has none
+  const char *GetAlignment(TargetId target) const {
+    return m_header->hasAlignment ? m_strings + m_alignments[target] : "";
+  }
+
+protected:
+  struct Header {
+    char magic[8];
+    UINT32 numScores;
+    UINT32 quantizeBits; //! 0 if the scores are stored as floats
+    UINT32 hasAlignment;
+    UINT32 unused;
+    UINT64 numWords, numNodes, numEdges, numTargets, numTargetWords;
+    // file offsets of the sections
+    UINT64 strings, wordOffsets, sortedWords, nodes, edges
+    , targetWordsBegin, targetWords, alignments, scores, codebook;
+    UINT64 fileSize;
+  };
+  struct Node {
+    UINT64 firstTarget;
+    UINT64 firstEdge;
+    UINT32 numTargets;
+    UINT32 numEdges;
+  };
+  struct Edge {
+    WordId word;
+    NodeId node;
+  };
+
+  util::scoped_memory m_memory;
+  const Header *m_header;
+  const char *m_strings;
+  const UINT64 *m_wordOffsets;
+  const WordId *m_sortedWords;
+  const Node *m_nodes;
+  const Edge *m_edges;
+  const UINT64 *m_targetWordsBegin;
+  const WordId *m_targetWords;
+  const UINT64 *m_alignments;
+  const float *m_scores;
+  const unsigned char *m_scoreCodes;
+  const float *m_codebook;
+
+private:
+  MMapPhraseTable(const MMapPhraseTable &); // not implemented
+  void operator=(const MMapPhraseTable &); // not implemented
+};
+
+}
+
+#endif
@@ -28,12 +28,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <algorithm>
 #include <limits>
 #include <cmath>
+#include <boost/unordered_set.hpp>
 #include "Manager.h"
 #include "TypeDef.h"
 #include "Util.h"
 #include "TargetPhrase.h"
 #include "TrellisPath.h"
-#include "TrellisPathCollection.h"
+#include "KBestExtractor.h"
 #include "TranslationOption.h"
 #include "LexicalReordering.h"
 #include "LMList.h"
@@ -58,6 +59,8 @@ Manager::Manager(InputType const& source, SearchAlgorithm searchAlgorithm, const
   ,m_start(clock())
   ,interrupted_flag(0)
   ,m_hypoId(0)
+  ,m_arcListPool("ArcList", 1000)
+  ,m_hypothesisPool("Hypothesis", 10000)
   ,m_source(source)
 {
   m_system->InitializeBeforeSentenceProcessing(source);
@@ -66,7 +69,10 @@ Manager::Manager(InputType const& source, SearchAlgorithm searchAlgorithm, const
 Manager::~Manager()
 {
   delete m_transOptColl;
+  // stacks hand their hypotheses back to m_hypothesisPool, destroy them all
+  // in one go while the feature functions still know about this sentence
   delete m_search;
+  m_hypothesisPool.reset();
 
   m_system->CleanUpAfterSentenceProcessing();
 
@@ -194,7 +200,7 @@ void Manager::printThisHypothesis(long translationId, const Hypothesis* hypo, co
 /**
  * After decoding, the hypotheses in the stacks and additional arcs
  * form a search graph that can be mined for n-best lists.
- * The heavy lifting is done in the TrellisPath and TrellisPathCollection
+ * The heavy lifting is done in the KBestExtractor,
  * this function controls this for one sentence.
  *
  * \param count the number of n-best translations to produce
@@ -212,49 +218,29 @@ void Manager::CalcNBest(size_t count, TrellisPathList &ret,bool onlyDistinct) co
   if (sortedPureHypo.size() == 0)
     return;
 
-  TrellisPathCollection contenders;
+  KBestExtractor extractor(sortedPureHypo);
 
-  set<Phrase> distinctHyps;
-
-  // add all pure paths
-  vector<const Hypothesis*>::const_iterator iterBestHypo;
-  for (iterBestHypo = sortedPureHypo.begin()
-                      ; iterBestHypo != sortedPureHypo.end()
-       ; ++iterBestHypo) {
-    contenders.Add(new TrellisPath(*iterBestHypo));
-  }
+  // distinct translations, told apart by the output factors of their words
+  boost::unordered_set< vector<const Factor*> > distinctHyps;
+  vector<const Factor*> outputFactors;
 
   // factor defines stopping point for distinct n-best list if too many candidates identical
   size_t nBestFactor = StaticData::Instance().GetNBestFactor();
   if (nBestFactor < 1) nBestFactor = 1000; // 0 = unlimited
 
   // MAIN loop
-  for (size_t iteration = 0 ; (onlyDistinct ? distinctHyps.size() : ret.GetSize()) < count && contenders.GetSize() > 0 && (iteration < count * nBestFactor) ; iteration++) {
-    // get next best from list of contenders
-    TrellisPath *path = contenders.pop();
-    assert(path);
-    // create deviations from current best
-    path->CreateDeviantPaths(contenders);
-    if(onlyDistinct) {
-      Phrase tgtPhrase = path->GetSurfacePhrase();
-      if (distinctHyps.insert(tgtPhrase).second) {
-        ret.Add(path);
-      } else {
-        delete path;
-        path = NULL;
-      }
-    } else {
-      ret.Add(path);
-    }
-
+  for (size_t iteration = 0 ; ret.GetSize() < count && (iteration < count * nBestFactor) ; iteration++) {
+    // get next best translation, sharing its beginning with the ones before
+    const KBestExtractor::Derivation *derivation = extractor.Next();
+    if (derivation == NULL)
+      break;
 
     if(onlyDistinct) {
-      const size_t nBestFactor = StaticData::Instance().GetNBestFactor();
-      if (nBestFactor > 0)
-        contenders.Prune(count * nBestFactor);
-    } else {
-      contenders.Prune(count);
+      extractor.GetOutputFactors(*derivation, outputFactors);
+      if (!distinctHyps.insert(outputFactors).second)
+        continue;
     }
+    ret.Add(extractor.CreateTrellisPath(*derivation));
   }
 }
 
@@ -80,10 +80,10 @@ struct SearchGraphNode {
  * - Going through stacks 0 ... (sentence_length-1):
  *   - The stack is pruned to the maximum size
  *   - Going through all hypotheses in the stack
- *     - Each hypothesis is expanded by ProcessOneHypothesis()
+ *     - Each hypothesis is expanded by ExpandHypotheses()
  *     - Expansion means applying a translation option to the hypothesis to create
  *       new hypotheses
- *     - What translation options may be applied depends on reordering limits and
+ *     - What translation options may be applied (GetExtensionRanges()) depends on reordering limits and
  *       overlap with already translated words
  *     - With a applicable translation option and a hypothesis at hand, a new
  *       hypothesis can be created in ExpandHypothesis()
@@ -108,6 +108,8 @@ protected:
   size_t interrupted_flag;
   std::auto_ptr<SentenceStats> m_sentenceStats;
   int m_hypoId; //used to number the hypos as they are created.
+  ObjectPool<ArcList> m_arcListPool; /**< arc lists of the hypotheses below */
+  ObjectPool<Hypothesis> m_hypothesisPool; /**< all hypotheses of this sentence, released when the manager is destroyed */
 
   void GetConnectedGraph(
     std::map< int, bool >* pConnected,
@@ -136,6 +138,12 @@ public:
   void printThisHypothesis(long translationId, const Hypothesis* hypo, const std::vector <const TargetPhrase* > & remainingPhrases, float remainingScore , std::ostream& outputStream) const;
   void GetWordGraph(long translationId, std::ostream &outputWordGraphStream) const;
   int GetNextHypoId();
+  ObjectPool<Hypothesis> &GetHypothesisPool() {
+    return m_hypothesisPool;
+  }
+  ObjectPool<ArcList> &GetArcListPool() {
+    return m_arcListPool;
+  }
 #ifdef HAVE_PROTOBUF
   void SerializeSearchGraphPB(long translationId, std::ostream& outputStream) const;
 #endif
@@ -79,6 +79,8 @@ Parameter::Parameter()
   AddParam("stack", "s", "maximum stack size for histogram pruning");
   AddParam("stack-diversity", "sd", "minimum number of hypothesis of each coverage in stack (default 0)");
   AddParam("threads","th", "number of threads to use in decoding (defaults to single-threaded)");
+  AddParam("threads-longest-first", "with -threads, start translating the longest sentences of the input first (default false)");
+  AddParam("search-threads", "number of threads working on one sentence: collecting translation options, expanding a hypothesis stack and the forward pass of lattice MBR in normal search, or processing the chart cells of one span width in chart decoding (defaults to 1)");
   AddParam("translation-details", "T", "for each best hypothesis, report translation details to the given file");
   AddParam("ttable-file", "location and properties of the translation tables");
   AddParam("ttable-limit", "ttl", "maximum number of translation table entries per input phrase");
@@ -114,7 +116,11 @@ Parameter::Parameter()
   AddParam("lmbr-map-weight", "weight given to map solution when doing lattice MBR (default 0)");
   AddParam("lattice-hypo-set", "to use lattice as hypo set during lattice MBR");
   AddParam("clean-lm-cache", "clean language model caches after N translations (default N=1)");
+  AddParam("lm-ngram-cache", "memory in MB for the n-gram cache shared by the threads, per SRI or IRST language model (default 0=disable)");
+  AddParam("lm-kenlm-huge-pages", "read binary KenLM language models into memory on huge pages (default false)");
+  AddParam("lm-kenlm-shared-memory", "share binary KenLM language models between decoder processes through POSIX shared memory segments named with this prefix. The first process loads them; remove them from /dev/shm to free the memory");
   AddParam("use-persistent-cache", "cache translation options across sentences (default true)");
+  AddParam("lazy-translation-options", "create the translation options of a multi-word span only when the search first reaches it (default false)");
   AddParam("persistent-cache-size", "maximum size of cache for translation options (default 10,000 input phrases)");
   AddParam("recover-input-path", "r", "(conf net/word lattice only) - recover input path corresponding to the best translation");
   AddParam("output-word-graph", "owg", "Output stack info as word graph. Takes filename, 0=only hypos in stack, 1=stack + nbest hypos");
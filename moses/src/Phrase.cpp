@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <algorithm>
 #include <sstream>
 #include <string>
+#include <boost/functional/hash.hpp>
 #include "memory.h"
 #include "FactorCollection.h"
 #include "Phrase.h"
@@ -361,6 +362,15 @@ ostream& operator<<(ostream& out, const Phrase& phrase)
   return out;
 }
 
+size_t HashFactors(const Phrase &phrase, const std::vector<FactorType> &factorTypes)
+{
+  size_t seed = phrase.GetSize();
+  for (size_t pos = 0 ; pos < phrase.GetSize() ; pos++) {
+    boost::hash_combine(seed, HashFactors(phrase.GetWord(pos), factorTypes));
+  }
+  return seed;
+}
+
 }
 
 
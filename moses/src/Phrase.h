@@ -173,6 +173,9 @@ public:
 
 };
 
+//! hash of the factors factorTypes of every word, see HashFactors(const Word&, ...)
+size_t HashFactors(const Phrase &phrase, const std::vector<FactorType> &factorTypes);
+
 
 }
 #endif
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "PhraseDictionaryTreeAdaptor.h"
 #include "PhraseDictionarySCFG.h"
 #include "PhraseDictionaryOnDisk.h"
+#include "PhraseDictionaryMMap.h"
 #ifndef WIN32
 #include "PhraseDictionaryDynSuffixArray.h"
 #endif
@@ -66,7 +67,8 @@ PhraseDictionaryFeature::PhraseDictionaryFeature
 {
   const StaticData& staticData = StaticData::Instance();
   const_cast<ScoreIndexManager&>(staticData.GetScoreIndexManager()).AddScoreProducer(this);
-  if (implementation == Memory || implementation == SCFG || implementation == SuffixArray) {
+  if (implementation == Memory || implementation == SCFG || implementation == SuffixArray
+      || implementation == OnDisk) {
     m_useThreadSafePhraseDictionary = true;
   } else {
     m_useThreadSafePhraseDictionary = false;
@@ -138,6 +140,17 @@ PhraseDictionary* PhraseDictionaryFeature::LoadPhraseTable(const TranslationSyst
                           , system->GetWordPenaltyProducer());
     assert(ret);
     return pdta;
+  } else if (m_implementation == MMap) {
+    PhraseDictionaryMMap* pdmm = new PhraseDictionaryMMap(m_numScoreComponent, this);
+    bool ret = pdmm->Load(GetInput()
+                          , GetOutput()
+                          , m_filePath
+                          , m_weight
+                          , m_tableLimit
+                          , system->GetLanguageModels()
+                          , system->GetWeightWordPenalty());
+    assert(ret);
+    return pdmm;
   } else if (m_implementation == SuffixArray) {
 #ifndef WIN32
     PhraseDictionaryDynSuffixArray *pd = new PhraseDictionaryDynSuffixArray(m_numScoreComponent, this);
@@ -128,6 +128,11 @@ public:
   //Get the dictionary. Be sure to initialise it first.
   const PhraseDictionary* GetDictionary() const;
 
+  //Whether all threads share one dictionary, so that any thread may look up phrases
+  bool IsThreadSafe() const {
+    return m_useThreadSafePhraseDictionary;
+  }
+
 private:
   /** Load the appropriate phrase table */
   PhraseDictionary* LoadPhraseTable(const TranslationSystem* system);
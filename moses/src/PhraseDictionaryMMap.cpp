@@ -0,0 +1,141 @@
+// $Id$
+// vim:tabstop=2
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <sstream>
+#include "PhraseDictionaryMMap.h"
+#include "FactorCollection.h"
+#include "StaticData.h"
+#include "UserMessage.h"
+#include "Util.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+PhraseDictionaryMMap::~PhraseDictionaryMMap()
+{
+  CleanUp();
+}
+
+bool PhraseDictionaryMMap::Load(const std::vector<FactorType> &input
+                                , const std::vector<FactorType> &output
+                                , const string &filePath
+                                , const vector<float> &weight
+                                , size_t tableLimit
+                                , const LMList &languageModels
+                                , float weightWP)
+{
+  if (StaticData::Instance().GetInputType() != SentenceInput) {
+    UserMessage::Add("The memory-mapped phrase table only supports sentence input");
+    return false;
+  }
+
+  m_input = input;
+  m_output = output;
+  m_weight = weight;
+  m_tableLimit = tableLimit;
+  m_languageModels = &languageModels;
+  m_weightWP = weightWP;
+
+  if (!m_table.Load(filePath)) {
+    return false;
+  }
+  if (m_table.GetNumScores() != m_numScoreComponent) {
+    stringstream strme;
+    strme << "Size of scoreVector != number (" << m_table.GetNumScores() << "!=" << m_numScoreComponent
+          << ") of score components in " << filePath;
+    UserMessage::Add(strme.str());
+    return false;
+  }
+  return true;
+}
+
+const Word &PhraseDictionaryMMap::GetTargetWord(MMapPhraseTable::WordId id) const
+{
+  boost::unordered_map<MMapPhraseTable::WordId, Word>::iterator iter = m_targetWords.find(id);
+  if (iter != m_targetWords.end()) {
+    return iter->second;
+  }
+
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  vector<string> factors = TokenizeMultiCharSeparator(m_table.GetWord(id), StaticData::Instance().GetFactorDelimiter());
+  assert(factors.size() == m_output.size());
+  Word &word = m_targetWords[id];
+  for (size_t i = 0; i < m_output.size(); ++i) {
+    word[m_output[i]] = factorCollection.AddFactor(Output, m_output[i], factors[i]);
+  }
+  return word;
+}
+
+const TargetPhraseCollection *PhraseDictionaryMMap::GetTargetPhraseCollection(const Phrase &source) const
+{
+  MMapPhraseTable::NodeId node = m_table.GetRoot();
+  for (size_t pos = 0; pos < source.GetSize(); ++pos) {
+    MMapPhraseTable::WordId word;
+    if (!m_table.FindWord(source.GetWord(pos).GetString(m_input, false).c_str(), word)) {
+      return NULL;
+    }
+    node = m_table.GetChild(node, word);
+    if (node == MMapPhraseTable::NotFound) {
+      return NULL;
+    }
+  }
+
+  MMapPhraseTable::TargetId begin, end;
+  m_table.GetTargets(node, begin, end);
+  if (begin == end) {
+    return NULL;
+  }
+
+  TargetPhraseCollection *ret = new TargetPhraseCollection;
+  m_tgtColls.push_back(ret);
+  Scores scores(m_table.GetNumScores());
+  for (MMapPhraseTable::TargetId target = begin; target < end; ++target) {
+    TargetPhrase *targetPhrase = new TargetPhrase(Output);
+
+    const MMapPhraseTable::WordId *words = m_table.GetTargetWords(target);
+    for (size_t pos = 0; pos < m_table.GetTargetSize(target); ++pos) {
+      targetPhrase->AddWord(GetTargetWord(words[pos]));
+    }
+
+    for (size_t i = 0; i < scores.size(); ++i) {
+      scores[i] = m_table.GetScore(target, i);
+    }
+    targetPhrase->SetScore(m_feature, scores, m_weight, m_weightWP, *m_languageModels);
+
+    const char *alignment = m_table.GetAlignment(target);
+    if (*alignment) {
+      targetPhrase->SetAlignmentInfo(alignment);
+    }
+    ret->Add(targetPhrase);
+  }
+  ret->NthElement(m_tableLimit);
+  return ret;
+}
+
+void PhraseDictionaryMMap::CleanUp()
+{
+  RemoveAllInColl(m_tgtColls);
+}
+
+}
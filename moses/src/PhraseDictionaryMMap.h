@@ -0,0 +1,93 @@
+// $Id$
+// vim:tabstop=2
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_PhraseDictionaryMMap_h
+#define moses_PhraseDictionaryMMap_h
+
+#include <vector>
+#include <cassert>
+#include <boost/unordered_map.hpp>
+#include "TypeDef.h"
+#include "PhraseDictionary.h"
+#include "MMapPhraseTable.h"
+#include "TargetPhraseCollection.h"
+
+namespace Moses
+{
+
+/*** Phrase table backed by a memory-mapped binary file (see MMapPhraseTable),
+ * created with processPhraseTableMMap. Each decoder thread has its own
+ * instance, as the target phrase collections are built per sentence, but the
+ * pages of the file are shared.
+ */
+class PhraseDictionaryMMap : public PhraseDictionary
+{
+  typedef PhraseDictionary MyBase;
+
+protected:
+  MMapPhraseTable m_table;
+  std::vector<FactorType> m_input, m_output;
+  std::vector<float> m_weight;
+  const LMList *m_languageModels;
+  float m_weightWP;
+
+  //! collections returned for the current sentence
+  mutable std::vector<TargetPhraseCollection*> m_tgtColls;
+  //! target words already converted to factors
+  mutable boost::unordered_map<MMapPhraseTable::WordId, Word> m_targetWords;
+
+  const Word &GetTargetWord(MMapPhraseTable::WordId id) const;
+  void CleanUp();
+
+public:
+  PhraseDictionaryMMap(size_t numScoreComponent, PhraseDictionaryFeature* feature)
+    : PhraseDictionary(numScoreComponent,feature), m_languageModels(NULL), m_weightWP(0) {}
+  virtual ~PhraseDictionaryMMap();
+
+  bool Load(const std::vector<FactorType> &input
+            , const std::vector<FactorType> &output
+            , const std::string &filePath
+            , const std::vector<float> &weight
+            , size_t tableLimit
+            , const LMList &languageModels
+            , float weightWP);
+
+  const TargetPhraseCollection *GetTargetPhraseCollection(const Phrase &source) const;
+
+  void AddEquivPhrase(const Phrase &, const TargetPhrase &) {
+    assert(false);
+  }
+
+  void InitializeForInput(InputType const&) {
+    CleanUp();
+  }
+
+  virtual ChartRuleLookupManager *CreateRuleLookupManager(
+    const InputType &,
+    const ChartCellCollection &) {
+    assert(false);
+    return 0;
+  }
+};
+
+}
+#endif
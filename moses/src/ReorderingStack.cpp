@@ -6,12 +6,17 @@
 
 #include "ReorderingStack.h"
 #include <vector>
+#include <boost/functional/hash.hpp>
 
 namespace Moses
 {
 int ReorderingStack::Compare(const ReorderingStack& o)  const
 {
   const ReorderingStack& other = static_cast<const ReorderingStack&>(o);
+  // different hashes always mean different stacks
+  if (m_hash != other.m_hash) {
+    return m_hash < other.m_hash ? -1 : 1;
+  }
   if (other.m_stack > m_stack) {
     return 1;
   } else if (other.m_stack < m_stack) {
@@ -20,6 +25,11 @@ int ReorderingStack::Compare(const ReorderingStack& o)  const
   return 0;
 }
 
+size_t ReorderingStack::Hash() const
+{
+  return m_hash;
+}
+
 // Method to push (shift element into the stack and reduce if reqd)
 int ReorderingStack::ShiftReduce(WordsRange input_span)
 {
@@ -28,6 +38,7 @@ int ReorderingStack::ShiftReduce(WordsRange input_span)
   // stack is empty
   if(m_stack.empty()) {
     m_stack.push_back(input_span);
+    m_hash = boost::hash_range(m_stack.begin(), m_stack.end());
     return input_span.GetStartPos() + 1; // - (-1)
   }
 
@@ -52,6 +63,7 @@ int ReorderingStack::ShiftReduce(WordsRange input_span)
   } else {      // discontinuous
     m_stack.push_back(input_span);
   }
+  m_hash = boost::hash_range(m_stack.begin(), m_stack.end());
 
   return distance;
 }
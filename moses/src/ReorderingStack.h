@@ -24,10 +24,13 @@ class ReorderingStack
 private:
 
   std::vector<WordsRange> m_stack;
+  size_t m_hash; /**< hash of m_stack, updated by ShiftReduce() */
 
 public:
+  ReorderingStack() : m_hash(0) {}
 
   int Compare(const ReorderingStack& o) const;
+  size_t Hash() const;
   int ShiftReduce(WordsRange input_span);
 
 private:
@@ -21,11 +21,13 @@
 
 #include "ChartCell.h"
 #include "ChartCellCollection.h"
+#include "ChartManager.h"
 #include "ChartTranslationOption.h"
 #include "ChartTranslationOptionCollection.h"
 #include "RuleCube.h"
 #include "RuleCubeQueue.h"
 #include "StaticData.h"
+#include "TranslationSystem.h"
 #include "Util.h"
 #include "WordsRange.h"
 
@@ -68,36 +70,55 @@ RuleCubeItem *RuleCube::Pop(ChartManager &manager)
 // create new RuleCube for neighboring principle rules
 void RuleCube::CreateNeighbors(const RuleCubeItem &item, ChartManager &manager)
 {
+  std::vector<RuleCubeItem*> newItems;
+
   // create neighbor along translation dimension
   const TranslationDimension &translationDimension =
     item.GetTranslationDimension();
   if (translationDimension.HasMoreTranslations()) {
-    CreateNeighbor(item, -1, manager);
+    CreateNeighbor(item, -1, newItems);
   }
 
   // create neighbors along all hypothesis dimensions
   for (size_t i = 0; i < item.GetHypothesisDimensions().size(); ++i) {
     const HypothesisDimension &dimension = item.GetHypothesisDimensions()[i];
     if (dimension.HasMoreHypo()) {
-      CreateNeighbor(item, i, manager);
+      CreateNeighbor(item, i, newItems);
     }
   }
+
+  if (StaticData::Instance().GetCubePruningLazyScoring()) {
+    for (size_t i = 0; i < newItems.size(); ++i) {
+      newItems[i]->EstimateScore();
+    }
+  } else {
+    // build all the hypotheses before scoring any, so that the language
+    // models can load what they read for all of them at once
+    std::vector<const ChartHypothesis*> hypos;
+    for (size_t i = 0; i < newItems.size(); ++i) {
+      newItems[i]->BuildHypothesis(m_transOpt, manager);
+      hypos.push_back(newItems[i]->GetHypothesis());
+    }
+    manager.GetTranslationSystem()->GetLanguageModels().PrefetchChartMemory(hypos);
+    for (size_t i = 0; i < newItems.size(); ++i) {
+      newItems[i]->ScoreHypothesis();
+    }
+  }
+
+  for (size_t i = 0; i < newItems.size(); ++i) {
+    m_queue.push(newItems[i]);
+  }
 }
 
 void RuleCube::CreateNeighbor(const RuleCubeItem &item, int dimensionIndex,
-                              ChartManager &manager)
+                              std::vector<RuleCubeItem*> &newItems)
 {
   RuleCubeItem *newItem = new RuleCubeItem(item, dimensionIndex);
   std::pair<ItemSet::iterator, bool> result = m_covered.insert(newItem);
   if (!result.second) {
     delete newItem;  // already seen it
   } else {
-    if (StaticData::Instance().GetCubePruningLazyScoring()) {
-      newItem->EstimateScore();
-    } else {
-      newItem->CreateHypothesis(m_transOpt, manager);
-    }
-    m_queue.push(newItem);
+    newItems.push_back(newItem);
   }
 }
 
@@ -129,7 +129,7 @@ class RuleCube
   RuleCube &operator=(const RuleCube &);  // Not implemented
 
   void CreateNeighbors(const RuleCubeItem &, ChartManager &);
-  void CreateNeighbor(const RuleCubeItem &, int, ChartManager &);
+  void CreateNeighbor(const RuleCubeItem &, int, std::vector<RuleCubeItem*> &);
 
   const ChartTranslationOption &m_transOpt;
   ItemSet m_covered;
@@ -82,8 +82,19 @@ void RuleCubeItem::EstimateScore()
 
 void RuleCubeItem::CreateHypothesis(const ChartTranslationOption &transOpt,
                                     ChartManager &manager)
+{
+  BuildHypothesis(transOpt, manager);
+  ScoreHypothesis();
+}
+
+void RuleCubeItem::BuildHypothesis(const ChartTranslationOption &transOpt,
+                                   ChartManager &manager)
 {
   m_hypothesis = new ChartHypothesis(transOpt, *this, manager);
+}
+
+void RuleCubeItem::ScoreHypothesis()
+{
   m_hypothesis->CalcScore();
   m_score = m_hypothesis->GetTotalScore();
 }
@@ -128,6 +128,12 @@ class RuleCubeItem
 
   void CreateHypothesis(const ChartTranslationOption &, ChartManager &);
 
+  //! first half of CreateHypothesis(): the hypothesis isn't scored yet
+  void BuildHypothesis(const ChartTranslationOption &, ChartManager &);
+  void ScoreHypothesis();
+
+  const ChartHypothesis *GetHypothesis() const { return m_hypothesis; }
+
   ChartHypothesis *ReleaseHypothesis();
 
   bool operator<(const RuleCubeItem &) const;
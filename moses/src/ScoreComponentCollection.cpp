@@ -6,29 +6,28 @@
 namespace Moses
 {
 ScoreComponentCollection::ScoreComponentCollection()
-  : m_scores(StaticData::Instance().GetTotalScoreComponents(), 0.0f)
+  : m_weightedScore(0.0f)
   , m_sim(&StaticData::Instance().GetScoreIndexManager())
-{}
-
-float ScoreComponentCollection::GetWeightedScore() const
 {
-  float ret = InnerProduct(StaticData::Instance().GetAllWeights());
-  return ret;
+  Allocate(m_sim->GetTotalNumberOfScores());
+  std::fill(m_scores, m_scores + m_size, 0.0f);
 }
 
 void ScoreComponentCollection::ZeroAllLM(const LMList& lmList)
 {
 
+  const std::vector<float> &weights = GetWeights();
   for (size_t ind = lmList.GetMinIndex(); ind <= lmList.GetMaxIndex(); ++ind) {
-    m_scores[ind] = 0;
+    Set(ind, 0.0f, weights);
   }
 }
 
 void ScoreComponentCollection::PlusEqualsAllLM(const LMList& lmList, const ScoreComponentCollection& rhs)
 {
 
+  const std::vector<float> &weights = GetWeights();
   for (size_t ind = lmList.GetMinIndex(); ind <= lmList.GetMaxIndex(); ++ind) {
-    m_scores[ind] += rhs.m_scores[ind];
+    Add(ind, rhs.m_scores[ind], weights);
   }
 
 }
@@ -23,7 +23,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define moses_ScoreComponentCollection_h
 
 #include <numeric>
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <new>
 
 #include "LMList.h"
 #include "ScoreProducer.h"
@@ -56,22 +59,102 @@ class ScoreComponentCollection
 {
   friend std::ostream& operator<<(std::ostream& os, const ScoreComponentCollection& rhs);
   friend class ScoreIndexManager;
+public:
+  /** read-only view of the scores of a single ScoreProducer.
+   * Points into the collection, so it is only valid while the collection is alive and unchanged
+   */
+  class ProducerView
+  {
+    const float *m_begin, *m_end;
+  public:
+    ProducerView(const float *begin, const float *end)
+      : m_begin(begin), m_end(end)
+    {}
+    const float *begin() const {
+      return m_begin;
+    }
+    const float *end() const {
+      return m_end;
+    }
+    size_t size() const {
+      return m_end - m_begin;
+    }
+    const float& operator[](size_t x) const {
+      return m_begin[x];
+    }
+  };
+
 private:
-  std::vector<float> m_scores;
+  float *m_scores; /**< points to m_inline, or to the heap for more than SCORE_COMPONENTS_INLINE scores */
+  size_t m_size;
+  float m_weightedScore; /**< inner product of m_scores with the weights, kept up to date by every update */
   const ScoreIndexManager* m_sim;
+  float m_inline[SCORE_COMPONENTS_INLINE];
+
+  void Allocate(size_t size) {
+    m_size = size;
+    m_scores = (size <= SCORE_COMPONENTS_INLINE) ? m_inline : (float*) malloc(sizeof(float) * size);
+    if (m_scores == NULL)
+      throw std::bad_alloc();
+  }
+  void Free() {
+    if (m_scores != m_inline)
+      free(m_scores);
+  }
+  void CopyFrom(const ScoreComponentCollection& rhs) {
+    std::copy(rhs.m_scores, rhs.m_scores + rhs.m_size, m_scores);
+    m_weightedScore = rhs.m_weightedScore;
+    m_sim = rhs.m_sim;
+  }
+
+  const std::vector<float> &GetWeights() const {
+    return m_sim->GetWeights();
+  }
+
+  /* The weight of score i must already be in StaticData, so features that
+   * score entries while they are loaded (eg. generation tables) need their
+   * weights to be read first. */
+
+  //! add delta to score i, and its weighted value to the total
+  void Add(size_t i, float delta, const std::vector<float> &weights) {
+    assert(i < m_size && i < weights.size());
+    m_scores[i] += delta;
+    m_weightedScore += delta * weights[i];
+  }
+  //! overwrite score i, adjusting the weighted total by the change
+  void Set(size_t i, float value, const std::vector<float> &weights) {
+    assert(i < m_size && i < weights.size());
+    m_weightedScore += (value - m_scores[i]) * weights[i];
+    m_scores[i] = value;
+  }
 
 public:
   //! Create a new score collection with all values set to 0.0
   ScoreComponentCollection();
 
   //! Clone a score collection
-  ScoreComponentCollection(const ScoreComponentCollection& rhs)
-    : m_scores(rhs.m_scores)
-    , m_sim(rhs.m_sim)
-  {}
+  ScoreComponentCollection(const ScoreComponentCollection& rhs) {
+    Allocate(rhs.m_size);
+    CopyFrom(rhs);
+  }
+
+  ~ScoreComponentCollection() {
+    Free();
+  }
+
+  ScoreComponentCollection &operator=(const ScoreComponentCollection& rhs) {
+    if (this != &rhs) {
+      if (m_size != rhs.m_size) {
+        Free();
+        Allocate(rhs.m_size);
+      }
+      CopyFrom(rhs);
+    }
+    return *this;
+  }
 
   inline size_t size() const {
-    return m_scores.size();
+    return m_size;
   }
   const float& operator[](size_t x) const {
     return m_scores[x];
@@ -79,26 +162,28 @@ public:
 
   //! Set all values to 0.0
   void ZeroAll() {
-    for (std::vector<float>::iterator i=m_scores.begin(); i!=m_scores.end(); ++i)
-      *i = 0.0f;
+    std::fill(m_scores, m_scores + m_size, 0.0f);
+    m_weightedScore = 0.0f;
   }
 
   //! add the score in rhs
   void PlusEquals(const ScoreComponentCollection& rhs) {
-    assert(m_scores.size() >= rhs.m_scores.size());
-    const size_t l = rhs.m_scores.size();
+    assert(m_size >= rhs.m_size);
+    const size_t l = rhs.m_size;
     for (size_t i=0; i<l; i++) {
       m_scores[i] += rhs.m_scores[i];
     }
+    m_weightedScore += rhs.m_weightedScore;
   }
 
   //! subtract the score in rhs
   void MinusEquals(const ScoreComponentCollection& rhs) {
-    assert(m_scores.size() >= rhs.m_scores.size());
-    const size_t l = rhs.m_scores.size();
+    assert(m_size >= rhs.m_size);
+    const size_t l = rhs.m_size;
     for (size_t i=0; i<l; i++) {
       m_scores[i] -= rhs.m_scores[i];
     }
+    m_weightedScore -= rhs.m_weightedScore;
   }
 
   //! Add scores from a single ScoreProducer only
@@ -106,10 +191,11 @@ public:
   //! produced by sp
   void PlusEquals(const ScoreProducer* sp, const std::vector<float>& scores) {
     assert(scores.size() == sp->GetNumScoreComponents());
+    const std::vector<float> &weights = GetWeights();
     size_t i = m_sim->GetBeginIndex(sp->GetScoreBookkeepingID());
     for (std::vector<float>::const_iterator vi = scores.begin();
          vi != scores.end(); ++vi) {
-      m_scores[i++] += *vi;
+      Add(i++, *vi, weights);
     }
   }
 
@@ -117,10 +203,11 @@ public:
   //! The length of scores must be equal to the number of score components
   //! produced by sp
   void PlusEquals(const ScoreProducer* sp, const ScoreComponentCollection& scores) {
+    const std::vector<float> &weights = GetWeights();
     size_t i = m_sim->GetBeginIndex(sp->GetScoreBookkeepingID());
     const size_t end = m_sim->GetEndIndex(sp->GetScoreBookkeepingID());
     for (; i < end; ++i) {
-      m_scores[i] += scores.m_scores[i];
+      Add(i, scores.m_scores[i], weights);
     }
   }
 
@@ -130,20 +217,21 @@ public:
   void PlusEquals(const ScoreProducer* sp, float score) {
     assert(1 == sp->GetNumScoreComponents());
     const size_t i = m_sim->GetBeginIndex(sp->GetScoreBookkeepingID());
-    m_scores[i] += score;
+    Add(i, score, GetWeights());
   }
 
   void Assign(const ScoreProducer* sp, const std::vector<float>& scores) {
     assert(scores.size() == sp->GetNumScoreComponents());
+    const std::vector<float> &weights = GetWeights();
     size_t i = m_sim->GetBeginIndex(sp->GetScoreBookkeepingID());
     for (std::vector<float>::const_iterator vi = scores.begin();
          vi != scores.end(); ++vi) {
-      m_scores[i++] = *vi;
+      Set(i++, *vi, weights);
     }
   }
 
   void Assign(const ScoreComponentCollection &copy) {
-    m_scores =  copy.m_scores;
+    *this = copy;
   }
 
   //! Special version PlusEquals(ScoreProducer, vector<float>)
@@ -152,32 +240,31 @@ public:
   void Assign(const ScoreProducer* sp, float score) {
     assert(1 == sp->GetNumScoreComponents());
     const size_t i = m_sim->GetBeginIndex(sp->GetScoreBookkeepingID());
-    m_scores[i] = score;
+    Set(i, score, GetWeights());
   }
 
   //! Used to find the weighted total of scores.  rhs should contain a vector of weights
   //! of the same length as the number of scores.
   float InnerProduct(const std::vector<float>& rhs) const {
-    return std::inner_product(m_scores.begin(), m_scores.end(), rhs.begin(), 0.0f);
+    return std::inner_product(m_scores, m_scores + m_size, rhs.begin(), 0.0f);
   }
 
   float PartialInnerProduct(const ScoreProducer* sp, const std::vector<float>& rhs) const {
-    std::vector<float> lhs = GetScoresForProducer(sp);
+    ProducerView lhs = GetProducerView(sp);
     assert(lhs.size() == rhs.size());
     return std::inner_product(lhs.begin(), lhs.end(), rhs.begin(), 0.0f);
   }
 
+  //! scores associated with a certain ScoreProducer, without copying them
+  ProducerView GetProducerView(const ScoreProducer* sp) const {
+    size_t id = sp->GetScoreBookkeepingID();
+    return ProducerView(m_scores + m_sim->GetBeginIndex(id), m_scores + m_sim->GetEndIndex(id));
+  }
+
   //! return a vector of all the scores associated with a certain ScoreProducer
   std::vector<float> GetScoresForProducer(const ScoreProducer* sp) const {
-    size_t id = sp->GetScoreBookkeepingID();
-    const size_t begin = m_sim->GetBeginIndex(id);
-    const size_t end = m_sim->GetEndIndex(id);
-    std::vector<float> res(end-begin);
-    size_t j = 0;
-    for (size_t i = begin; i < end; i++) {
-      res[j++] = m_scores[i];
-    }
-    return res;
+    ProducerView view = GetProducerView(sp);
+    return std::vector<float>(view.begin(), view.end());
   }
 
   //! if a ScoreProducer produces a single score (for example, a language model score)
@@ -192,7 +279,10 @@ public:
     return m_scores[begin];
   }
 
-  float GetWeightedScore() const;
+  //! weighted total of all scores, with the weights from StaticData
+  float GetWeightedScore() const {
+    return m_weightedScore;
+  }
 
   void ZeroAllLM(const LMList& lmList);
   void PlusEqualsAllLM(const LMList& lmList, const ScoreComponentCollection& rhs);
@@ -202,7 +292,7 @@ public:
 inline std::ostream& operator<<(std::ostream& os, const ScoreComponentCollection& rhs)
 {
   os << "<<" << rhs.m_scores[0];
-  for (size_t i=1; i<rhs.m_scores.size(); i++)
+  for (size_t i=1; i<rhs.m_size; i++)
     os << ", " << rhs.m_scores[i];
   return os << ">>";
 }
@@ -36,7 +36,7 @@ void ScoreIndexManager::AddScoreProducer(const ScoreProducer* sp)
 
 void ScoreIndexManager::PrintLabeledScores(std::ostream& os, const ScoreComponentCollection& scores) const
 {
-  std::vector<float> weights(scores.m_scores.size(), 1.0f);
+  std::vector<float> weights(scores.size(), 1.0f);
   PrintLabeledWeightedScores(os, scores, weights);
 }
 
@@ -28,7 +28,7 @@ class ScoreIndexManager
 {
   friend std::ostream& operator<<(std::ostream& os, const ScoreIndexManager& sim);
 public:
-  ScoreIndexManager() : m_last(0) {}
+  ScoreIndexManager() : m_last(0), m_weights(NULL) {}
 
   //! new score producer to manage. Producers must be inserted in the order they are created
   void AddScoreProducer(const ScoreProducer* producer);
@@ -46,6 +46,13 @@ public:
   size_t GetTotalNumberOfScores() const {
     return m_last;
   }
+  //! weights of all score components, owned by StaticData
+  void SetWeights(const std::vector<float> *weights) {
+    m_weights = weights;
+  }
+  const std::vector<float> &GetWeights() const {
+    return *m_weights;
+  }
   //! print unweighted scores of each ScoreManager to stream os
   void PrintLabeledScores(std::ostream& os, const ScoreComponentCollection& scc) const;
   //! print weighted scores of each ScoreManager to stream os
@@ -63,6 +70,7 @@ private:
   std::vector<std::string> m_featureNames;
   std::vector<std::string> m_featureShortNames;
   size_t m_last;
+  const std::vector<float> *m_weights;
 };
 
 
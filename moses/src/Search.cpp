@@ -9,7 +9,7 @@ namespace Moses
 
 
 Search *Search::CreateSearch(Manager& manager, const InputType &source,
-                             SearchAlgorithm searchAlgorithm, const TranslationOptionCollection &transOptColl)
+                             SearchAlgorithm searchAlgorithm, TranslationOptionCollection &transOptColl)
 {
   switch(searchAlgorithm) {
   case Normal:
@@ -26,7 +26,7 @@ public:
 
   // Factory
   static Search *CreateSearch(Manager& manager, const InputType &source, SearchAlgorithm searchAlgorithm,
-                              const TranslationOptionCollection &transOptColl);
+                              TranslationOptionCollection &transOptColl);
 
 protected:
 
@@ -1,3 +1,5 @@
+#include <queue>
+
 #include "Manager.h"
 #include "Util.h"
 #include "SearchCubePruning.h"
@@ -24,8 +26,8 @@ public:
     }
 
     // Compare the top hypothesis of each bitmap container using the TotalScore, which includes future cost
-    const float scoreA = A->Top()->GetHypothesis()->GetTotalScore();
-    const float scoreB = B->Top()->GetHypothesis()->GetTotalScore();
+    const float scoreA = A->Top().GetScore();
+    const float scoreB = B->Top().GetScore();
 
     if (scoreA < scoreB) {
       return true;
@@ -37,7 +39,7 @@ public:
   }
 };
 
-SearchCubePruning::SearchCubePruning(Manager& manager, const InputType &source, const TranslationOptionCollection &transOptColl)
+SearchCubePruning::SearchCubePruning(Manager& manager, const InputType &source, TranslationOptionCollection &transOptColl)
   :Search(manager)
   ,m_source(source)
   ,m_hypoStackColl(source.GetSize() + 1)
@@ -211,6 +213,7 @@ void SearchCubePruning::CreateForwardTodos(const WordsBitmap &bitmap, const Word
   newBitmap.SetValue(range.GetStartPos(), range.GetEndPos(), true);
 
   size_t numCovered = newBitmap.GetNumWordsCovered();
+  m_transOptColl.EnsureRangeCreated(range.GetStartPos(), range.GetEndPos());
   const TranslationOptionList &transOptList = m_transOptColl.GetTranslationOptionList(range);
   const SquareMatrix &futureScore = m_transOptColl.GetFutureScore();
 
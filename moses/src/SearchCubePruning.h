@@ -19,7 +19,7 @@ protected:
   // no of elements = no of words in source + 1
   TargetPhrase m_initialTargetPhrase; /**< used to seed 1st hypo */
   clock_t m_start; /**< used to track time spend on translation */
-  const TranslationOptionCollection &m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
+  TranslationOptionCollection &m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
 
   //! go thru all bitmaps in 1 stack & create backpointers to bitmaps in the stack
   void CreateForwardTodos(HypothesisStackCubePruning &stack);
@@ -30,7 +30,7 @@ protected:
   void PrintBitmapContainerGraph();
 
 public:
-  SearchCubePruning(Manager& manager, const InputType &source, const TranslationOptionCollection &transOptColl);
+  SearchCubePruning(Manager& manager, const InputType &source, TranslationOptionCollection &transOptColl);
   ~SearchCubePruning();
 
   void ProcessSentence();
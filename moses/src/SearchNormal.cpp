@@ -1,18 +1,44 @@
+#include <algorithm>
+
 #include "Manager.h"
 #include "Timer.h"
 #include "SearchNormal.h"
+#include "ThreadPool.h"
 
 using namespace std;
 
 namespace Moses
 {
+
+#ifdef WITH_THREADS
+/** expands one chunk of the hypotheses of a stack into its buffer,
+ * see SearchNormal::ExpandStackInParallel() */
+class ExpandChunk
+{
+public:
+  ExpandChunk(SearchNormal &search, const std::vector<const Hypothesis*> &hypos, size_t numChunks)
+    : m_search(search), m_hypos(hypos), m_numChunks(numChunks)
+  {}
+
+  void operator()(size_t chunk) {
+    m_search.ExpandHypotheses(m_hypos, chunk * m_hypos.size() / m_numChunks, (chunk + 1) * m_hypos.size() / m_numChunks
+                              , &m_search.m_expansionBuffers[chunk]);
+  }
+
+private:
+  SearchNormal &m_search;
+  const std::vector<const Hypothesis*> &m_hypos;
+  size_t m_numChunks;
+};
+#endif
+
 /**
  * Organizing main function
  *
  * /param source input sentence
  * /param transOptColl collection of translation options to be used for this sentence
  */
-SearchNormal::SearchNormal(Manager& manager, const InputType &source, const TranslationOptionCollection &transOptColl)
+SearchNormal::SearchNormal(Manager& manager, const InputType &source, TranslationOptionCollection &transOptColl)
   :Search(manager)
   ,m_source(source)
   ,m_hypoStackColl(source.GetSize() + 1)
@@ -44,11 +70,26 @@ SearchNormal::SearchNormal(Manager& manager, const InputType &source, const Tran
 
     m_hypoStackColl[ind] = sourceHypoColl;
   }
+
+  // parallel expansion gives the same result as the serial one, except for
+  // early discarding, which looks at stacks that are still being filled.
+  // Timing statistics and hypothesis logging are not thread-safe
+  if (staticData.SearchThreadCount() > 1 && !staticData.UseEarlyDiscarding()
+      && staticData.GetVerboseLevel() < 2) {
+    m_expansionBuffers.resize(staticData.SearchThreadCount());
+    for (size_t i = 0 ; i < m_expansionBuffers.size() ; ++i) {
+      m_expansionBuffers[i].pool = new ObjectPool<Hypothesis>("Hypothesis", 1000);
+    }
+  }
 }
 
 SearchNormal::~SearchNormal()
 {
+  // hypotheses from the expansion pools are referenced by the stacks
   RemoveAllInColl(m_hypoStackColl);
+  for (size_t i = 0 ; i < m_expansionBuffers.size() ; ++i) {
+    delete m_expansionBuffers[i].pool;
+  }
 }
 
 /**
@@ -90,11 +131,8 @@ void SearchNormal::ProcessSentence()
     }
 
     // go through each hypothesis on the stack and try to expand it
-    HypothesisStackNormal::const_iterator iterHypo;
-    for (iterHypo = sourceHypoColl.begin() ; iterHypo != sourceHypoColl.end() ; ++iterHypo) {
-      Hypothesis &hypothesis = **iterHypo;
-      ProcessOneHypothesis(hypothesis); // expand the hypothesis
-    }
+    ExpandStack(sourceHypoColl);
+
     // some logging
     IFVERBOSE(2) {
       OutputHypoStackSize();
@@ -112,12 +150,92 @@ void SearchNormal::ProcessSentence()
 }
 
 
-/** Find all translation options to expand one hypothesis, trigger expansion
+/**
+ * Expand all hypotheses of a stack into the following stacks
+ */
+void SearchNormal::ExpandStack(const HypothesisStackNormal &sourceHypoColl)
+{
+#ifdef WITH_THREADS
+  if (m_expansionBuffers.size() > 1 && sourceHypoColl.size() > 1) {
+    ExpandStackInParallel(sourceHypoColl);
+    return;
+  }
+#endif
+  const std::vector<const Hypothesis*> hypos(sourceHypoColl.begin(), sourceHypoColl.end());
+  ExpandHypotheses(hypos, 0, hypos.size(), NULL);
+}
+
+/**
+ * Expand hypos[begin] to hypos[end-1]. The language models are told about all
+ * the extensions first, so that they can fetch their n-grams together
+ */
+void SearchNormal::ExpandHypotheses(const std::vector<const Hypothesis*> &hypos, size_t begin, size_t end, ExpansionBuffer *buffer)
+{
+  std::vector< std::vector<WordsRange> > ranges(end - begin);
+  LanguageModel::Extensions extensions;
+  std::vector<size_t> firstExtension(1, 0); // of each hypothesis, in extensions
+  for (size_t i = begin ; i < end ; ++i) {
+    std::vector<WordsRange> &hypoRanges = ranges[i - begin];
+    GetExtensionRanges(*hypos[i], hypoRanges);
+    for (size_t r = 0 ; r < hypoRanges.size() ; ++r) {
+      extensions.push_back(std::make_pair(hypos[i], &m_transOptColl.GetTranslationOptionList(hypoRanges[r])));
+    }
+    firstExtension.push_back(extensions.size());
+  }
+  const LMList &languageModels = m_manager.GetTranslationSystem()->GetLanguageModels();
+  languageModels.PrefetchExtensions(extensions);
+
+  // the memory needed to score the extensions of a hypothesis is loaded
+  // while the previous hypothesis is expanded
+  if (begin < end) {
+    languageModels.PrefetchMemory(LanguageModel::Extensions(extensions.begin(), extensions.begin() + firstExtension[1]));
+  }
+  for (size_t i = begin ; i < end ; ++i) {
+    if (i + 1 < end) {
+      languageModels.PrefetchMemory(LanguageModel::Extensions(extensions.begin() + firstExtension[i + 1 - begin]
+                                    , extensions.begin() + firstExtension[i + 2 - begin]));
+    }
+    const std::vector<WordsRange> &hypoRanges = ranges[i - begin];
+    for (size_t r = 0 ; r < hypoRanges.size() ; ++r) {
+      ExpandAllHypotheses(*hypos[i], hypoRanges[r].GetStartPos(), hypoRanges[r].GetEndPos(), buffer);
+    }
+  }
+}
+
+#ifdef WITH_THREADS
+/**
+ * Split the stack into one chunk per search thread, and build the new
+ * hypotheses of each chunk in its own buffer. Then add them to the stacks
+ * in the order of the serial search, so the result doesn't depend on the
+ * number of threads or on their timing
+ */
+void SearchNormal::ExpandStackInParallel(const HypothesisStackNormal &sourceHypoColl)
+{
+  const std::vector<const Hypothesis*> hypos(sourceHypoColl.begin(), sourceHypoColl.end());
+  const size_t numChunks = std::min(m_expansionBuffers.size(), hypos.size());
+
+  RunShares(StaticData::Instance().GetSearchThreadPool(), numChunks, ExpandChunk(*this, hypos, numChunks));
+
+  for (size_t chunk = 0 ; chunk < numChunks ; ++chunk) {
+    std::vector<Hypothesis*> &newHypos = m_expansionBuffers[chunk].hypos;
+    for (size_t i = 0 ; i < newHypos.size() ; ++i) {
+      Hypothesis *newHypo = newHypos[i];
+      newHypo->AssignId();
+      size_t wordsTranslated = newHypo->GetWordsBitmap().GetNumWordsCovered();
+      m_hypoStackColl[wordsTranslated]->AddPrune(newHypo);
+    }
+    newHypos.clear();
+  }
+}
+#endif
+
+/** Find all translation options to expand one hypothesis
  * this is mostly a check for overlap with already covered words, and for
  * violation of reordering limits.
  * \param hypothesis hypothesis to be expanded upon
+ * \param ranges source ranges it can be expanded with, in the order of expansion
  */
-void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
+void SearchNormal::GetExtensionRanges(const Hypothesis &hypothesis, std::vector<WordsRange> &ranges)
 {
   // since we check for reordering limits, its good to have that limit handy
   int maxDistortion = StaticData::Instance().GetMaxDistortion();
@@ -125,7 +243,7 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
 
   // no limit of reordering: only check for overlap
   if (maxDistortion < 0) {
-    const WordsBitmap hypoBitmap	= hypothesis.GetWordsBitmap();
+    const WordsBitmap &hypoBitmap	= hypothesis.GetWordsBitmap();
     const size_t hypoFirstGapPos	= hypoBitmap.GetFirstGapPos()
                                     , sourceSize			= m_source.GetSize();
 
@@ -136,17 +254,20 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
 
       for (size_t endPos = startPos ; endPos < startPos + maxSize ; ++endPos) {
         // basic checks
-        // there have to be translation options
-        if (m_transOptColl.GetTranslationOptionList(WordsRange(startPos, endPos)).size() == 0 ||
-            // no overlap with existing words
-            hypoBitmap.Overlap(WordsRange(startPos, endPos)) ||
+        // no overlap with existing words
+        if (hypoBitmap.Overlap(WordsRange(startPos, endPos)) ||
             // specified reordering constraints (set with -monotone-at-punctuation or xml)
-            !m_source.GetReorderingConstraint().Check( hypoBitmap, startPos, endPos ) ) {
+            !m_source.GetReorderingConstraint().Check( hypoBitmap, startPos, endPos )) {
+          continue;
+        }
+        // there have to be translation options (checked last, lazy translation options are created here)
+        m_transOptColl.EnsureRangeCreated(startPos, endPos);
+        if (m_transOptColl.GetTranslationOptionList(WordsRange(startPos, endPos)).size() == 0) {
           continue;
         }
 
         //TODO: does this method include incompatible WordLattice hypotheses?
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ranges.push_back(WordsRange(startPos, endPos));
       }
     }
 
@@ -155,7 +276,7 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
 
   // if there are reordering limits, make sure it is not violated
   // the coverage bitmap is handy here (and the position of the first gap)
-  const WordsBitmap hypoBitmap = hypothesis.GetWordsBitmap();
+  const WordsBitmap &hypoBitmap = hypothesis.GetWordsBitmap();
   const size_t	hypoFirstGapPos	= hypoBitmap.GetFirstGapPos()
                                   , sourceSize			= m_source.GetSize();
 
@@ -192,10 +313,8 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
     for (size_t endPos = startPos ; endPos < startPos + maxSize ; ++endPos) {
       // basic checks
       WordsRange extRange(startPos, endPos);
-      // there have to be translation options
-      if (m_transOptColl.GetTranslationOptionList(extRange).size() == 0 ||
-          // no overlap with existing words
-          hypoBitmap.Overlap(extRange) ||
+      // no overlap with existing words
+      if (hypoBitmap.Overlap(extRange) ||
           // specified reordering constraints (set with -monotone-at-punctuation or xml)
           !m_source.GetReorderingConstraint().Check( hypoBitmap, startPos, endPos ) || //
           // connection in input word lattice
@@ -219,11 +338,8 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
       }
 
       // any length extension is okay if starting at left-most edge
-      if (leftMostEdge) {
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
-      }
       // starting somewhere other than left-most edge, use caution
-      else {
+      if (!leftMostEdge) {
         // the basic idea is this: we would like to translate a phrase starting
         // from a position further right than the left-most open gap. The
         // distortion penalty for the following phrase will be computed relative
@@ -238,11 +354,16 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
         if (required_distortion > maxDistortion) {
           continue;
         }
+      }
 
-        // everything is fine, we're good to go
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
-
+      // there have to be translation options (checked last, lazy translation options are created here)
+      m_transOptColl.EnsureRangeCreated(startPos, endPos);
+      if (m_transOptColl.GetTranslationOptionList(extRange).size() == 0) {
+        continue;
       }
+
+      // everything is fine, we're good to go
+      ranges.push_back(WordsRange(startPos, endPos));
     }
   }
 }
@@ -255,7 +376,7 @@ void SearchNormal::ProcessOneHypothesis(const Hypothesis &hypothesis)
  * \param endPos last word position of span covered
  */
 
-void SearchNormal::ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos)
+void SearchNormal::ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos, ExpansionBuffer *buffer)
 {
   // early discarding: check if hypothesis is too bad to build
   // this idea is explained in (Moore&Quirk, MT Summit 2007)
@@ -272,7 +393,7 @@ void SearchNormal::ExpandAllHypotheses(const Hypothesis &hypothesis, size_t star
   const TranslationOptionList &transOptList = m_transOptColl.GetTranslationOptionList(WordsRange(startPos, endPos));
   TranslationOptionList::const_iterator iter;
   for (iter = transOptList.begin() ; iter != transOptList.end() ; ++iter) {
-    ExpandHypothesis(hypothesis, **iter, expectedScore);
+    ExpandHypothesis(hypothesis, **iter, expectedScore, buffer);
   }
 }
 
@@ -285,7 +406,7 @@ void SearchNormal::ExpandAllHypotheses(const Hypothesis &hypothesis, size_t star
  * \param expectedScore base score for early discarding
  *        (base hypothesis score plus future score estimation)
  */
-void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const TranslationOption &transOpt, float expectedScore)
+void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const TranslationOption &transOpt, float expectedScore, ExpansionBuffer *buffer)
 {
   const StaticData &staticData = StaticData::Instance();
   SentenceStats &stats = m_manager.GetSentenceStats();
@@ -297,12 +418,19 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
     IFVERBOSE(2) {
       t = clock();
     }
-    newHypo = hypothesis.CreateNext(transOpt, m_constraint);
+    newHypo = buffer ? hypothesis.CreateNext(transOpt, m_constraint, *buffer->pool)
+              : hypothesis.CreateNext(transOpt, m_constraint);
     IFVERBOSE(2) {
       stats.AddTimeBuildHyp( clock()-t );
     }
     if (newHypo==NULL) return;
     newHypo->CalcScore(m_transOptColl.GetFutureScore());
+
+    if (buffer) {
+      // added to the stacks once the whole stack is expanded
+      buffer->hypos.push_back(newHypo);
+      return;
+    }
   } else
     // early discarding: check if hypothesis is too bad to build
   {
@@ -5,6 +5,7 @@
 #include "Search.h"
 #include "HypothesisStackNormal.h"
 #include "TranslationOptionCollection.h"
+#include "ObjectPool.h"
 #include "Timer.h"
 
 namespace Moses
@@ -13,10 +14,20 @@ namespace Moses
 class Manager;
 class InputType;
 class TranslationOptionCollection;
+class ExpandChunk;
 
 class SearchNormal: public Search
 {
+  friend class ExpandChunk;
+
 protected:
+  /** hypotheses built by one chunk of a parallel stack expansion, in the order
+   * in which the serial search would have built them */
+  struct ExpansionBuffer {
+    ObjectPool<Hypothesis> *pool; /**< only used by this chunk while the stack is expanded */
+    std::vector<Hypothesis*> hypos;
+  };
+
   const InputType &m_source;
   std::vector < HypothesisStack* > m_hypoStackColl; /**< stacks to store hypotheses (partial translations) */
   // no of elements = no of words in source + 1
@@ -24,15 +35,19 @@ protected:
   clock_t m_start; /**< starting time, used for logging */
   size_t interrupted_flag; /**< flag indicating that decoder ran out of time (see switch -time-out) */
   HypothesisStackNormal* actual_hypoStack; /**actual (full expanded) stack of hypotheses*/
-  const TranslationOptionCollection &m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
+  TranslationOptionCollection &m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
+  std::vector<ExpansionBuffer> m_expansionBuffers; /**< one per search thread, empty if stacks are expanded serially */
 
   // functions for creating hypotheses
-  void ProcessOneHypothesis(const Hypothesis &hypothesis);
-  void ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos);
-  void ExpandHypothesis(const Hypothesis &hypothesis,const TranslationOption &transOpt, float expectedScore);
+  void ExpandStack(const HypothesisStackNormal &sourceHypoColl);
+  void ExpandStackInParallel(const HypothesisStackNormal &sourceHypoColl);
+  void ExpandHypotheses(const std::vector<const Hypothesis*> &hypos, size_t begin, size_t end, ExpansionBuffer *buffer);
+  void GetExtensionRanges(const Hypothesis &hypothesis, std::vector<WordsRange> &ranges);
+  void ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos, ExpansionBuffer *buffer);
+  void ExpandHypothesis(const Hypothesis &hypothesis,const TranslationOption &transOpt, float expectedScore, ExpansionBuffer *buffer);
 
 public:
-  SearchNormal(Manager& manager, const InputType &source, const TranslationOptionCollection &transOptColl);
+  SearchNormal(Manager& manager, const InputType &source, TranslationOptionCollection &transOptColl);
   ~SearchNormal();
 
   void ProcessSentence();
@@ -139,6 +139,10 @@ public:
     m_recombinationInfos.push_back(RecombinationInfo(worseHypo.GetWordsBitmap().GetNumWordsCovered(),
                                    betterHypo.GetTotalScore(), worseHypo.GetTotalScore()));
   }
+  //! for the chart decoder, whose hypotheses cover a span rather than a bitmap
+  void AddRecombination(size_t numSourceWords, float betterScore, float worseScore) {
+    m_recombinationInfos.push_back(RecombinationInfo(numSourceWords, betterScore, worseScore));
+  }
   void AddCreated() {
     m_numHyposCreated++;
   }
@@ -38,6 +38,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "PhraseDictionary.h"
 #include "UserMessage.h"
 #include "TranslationOption.h"
+#include "ThreadPool.h"
 #include "DecodeGraph.h"
 #include "InputFileStream.h"
 
@@ -84,10 +85,13 @@ StaticData::StaticData()
   ,m_factorDelimiter("|") // default delimiter between factors
   ,m_lmEnableOOVFeature(false)
   ,m_isAlwaysCreateDirectTranslationOption(false)
+  ,m_lazyTranslationOptions(false)
 {
   m_maxFactorIdx[0] = 0;  // source side
   m_maxFactorIdx[1] = 0;  // target side
 
+  m_scoreIndexManager.SetWeights(&m_allWeights);
+
   // memory pools
   Phrase::InitializeMemPool();
 }
@@ -245,11 +249,12 @@ bool StaticData::LoadData(Parameter *parameter)
   //
   if (m_inputType == SentenceInput) {
     SetBooleanParameter( &m_useTransOptCache, "use-persistent-cache", true );
-    m_transOptCacheMaxSize = (m_parameter->GetParam("persistent-cache-size").size() > 0)
-                             ? Scan<size_t>(m_parameter->GetParam("persistent-cache-size")[0]) : DEFAULT_MAX_TRANS_OPT_CACHE_SIZE;
+    m_transOptCache.SetMaxSize((m_parameter->GetParam("persistent-cache-size").size() > 0)
+                               ? Scan<size_t>(m_parameter->GetParam("persistent-cache-size")[0]) : DEFAULT_MAX_TRANS_OPT_CACHE_SIZE);
   } else {
     m_useTransOptCache = false;
   }
+  SetBooleanParameter( &m_lazyTranslationOptions, "lazy-translation-options", false );
 
 
   //input factors
@@ -401,6 +406,11 @@ bool StaticData::LoadData(Parameter *parameter)
 
   m_lmcache_cleanup_threshold = (m_parameter->GetParam("clean-lm-cache").size() > 0) ?
                                 Scan<size_t>(m_parameter->GetParam("clean-lm-cache")[0]) : 1;
+  m_lmNGramCacheBytes = ((m_parameter->GetParam("lm-ngram-cache").size() > 0) ?
+                         Scan<size_t>(m_parameter->GetParam("lm-ngram-cache")[0]) : DEFAULT_LM_NGRAM_CACHE_MB) << 20;
+  SetBooleanParameter( &m_kenLMHugePages, "lm-kenlm-huge-pages", false );
+  m_kenLMSharedMemory = (m_parameter->GetParam("lm-kenlm-shared-memory").size() > 0) ?
+                        m_parameter->GetParam("lm-kenlm-shared-memory")[0] : "";
 
   m_threadCount = 1;
   const std::vector<std::string> &threadInfo = m_parameter->GetParam("threads");
@@ -431,6 +441,21 @@ bool StaticData::LoadData(Parameter *parameter)
     }
   }
 
+  SetBooleanParameter( &m_threadsLongestFirst, "threads-longest-first", false );
+
+  m_searchThreadCount = (m_parameter->GetParam("search-threads").size() > 0) ?
+                        Scan<int>(m_parameter->GetParam("search-threads")[0]) : 1;
+  if (m_searchThreadCount < 1) {
+    UserMessage::Add("Specify at least one search thread.");
+    return false;
+  }
+#ifndef WITH_THREADS
+  if (m_searchThreadCount > 1) {
+    UserMessage::Add("Error: search threads specified but moses not built with thread support");
+    return false;
+  }
+#endif
+
   // Read in constraint decoding file, if provided
   if(m_parameter->GetParam("constraint").size()) {
     if (m_parameter->GetParam("search-algorithm").size() > 0
@@ -897,16 +922,20 @@ bool StaticData::LoadGenerationTables()
 
       VERBOSE(1, filePath << endl);
 
+      // the weights are needed when loading, for the weighted scores of the entries
+      if (currWeightNum + numFeatures > weight.size()) {
+        UserMessage::Add("Not enough generation weights for " + filePath);
+        return false;
+      }
+      for(size_t i = 0; i < numFeatures; i++) {
+        m_allWeights.push_back(weight[currWeightNum++]);
+      }
       m_generationDictionary.push_back(new GenerationDictionary(numFeatures, m_scoreIndexManager, input,output));
       assert(m_generationDictionary.back() && "could not create GenerationDictionary");
       if (!m_generationDictionary.back()->Load(filePath, Output)) {
         delete m_generationDictionary.back();
         return false;
       }
-      for(size_t i = 0; i < numFeatures; i++) {
-        assert(currWeightNum < weight.size());
-        m_allWeights.push_back(weight[currWeightNum++]);
-      }
     }
     if (currWeightNum != weight.size()) {
       TRACE_ERR( "  [WARNING] config file has " << weight.size() << " generation weights listed, but the configuration for generation files indicates there should be " << currWeightNum << "!\n");
@@ -1250,67 +1279,29 @@ void StaticData::SetWeightsForScoreProducer(const ScoreProducer* sp, const std::
     m_allWeights[i] = *weightIter++;
 }
 
-const TranslationOptionList* StaticData::FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const
+TransOptCache::ListPtr StaticData::FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const
 {
-  std::pair<size_t, Phrase> key(decodeGraph.GetPosition(), sourcePhrase);
-#ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_transOptCacheMutex);
-#endif
-  std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iter
-  = m_transOptCache.find(key);
-  if (iter == m_transOptCache.end())
-    return NULL;
-  iter->second.second = clock(); // update last used time
-  return iter->second.first;
+  return m_transOptCache.Find(decodeGraph.GetPosition(), sourcePhrase);
 }
 
-void StaticData::ReduceTransOptCache() const
+void StaticData::AddTransOptListToCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase, const TranslationOptionList &transOptList) const
 {
-  if (m_transOptCache.size() <= m_transOptCacheMaxSize) return; // not full
-  clock_t t = clock();
-
-  // find cutoff for last used time
-  priority_queue< clock_t > lastUsedTimes;
-  std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iter;
-  iter = m_transOptCache.begin();
-  while( iter != m_transOptCache.end() ) {
-    lastUsedTimes.push( iter->second.second );
-    iter++;
-  }
-  for( size_t i=0; i < lastUsedTimes.size()-m_transOptCacheMaxSize/2; i++ )
-    lastUsedTimes.pop();
-  clock_t cutoffLastUsedTime = lastUsedTimes.top();
-
-  // remove all old entries
-  iter = m_transOptCache.begin();
-  while( iter != m_transOptCache.end() ) {
-    if (iter->second.second < cutoffLastUsedTime) {
-      std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iterRemove = iter++;
-      delete iterRemove->second.first;
-      m_transOptCache.erase(iterRemove);
-    } else iter++;
-  }
-  VERBOSE(2,"Reduced persistent translation option cache in " << ((clock()-t)/(float)CLOCKS_PER_SEC) << " seconds." << std::endl);
+  m_transOptCache.Add(decodeGraph.GetPosition(), sourcePhrase, transOptList);
 }
 
-void StaticData::AddTransOptListToCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase, const TranslationOptionList &transOptList) const
+void StaticData::ClearTransOptionCache() const
 {
-  if (m_transOptCacheMaxSize == 0) return;
-  std::pair<size_t, Phrase> key(decodeGraph.GetPosition(), sourcePhrase);
-  TranslationOptionList* storedTransOptList = new TranslationOptionList(transOptList);
-#ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_transOptCacheMutex);
-#endif
-  m_transOptCache[key] = make_pair( storedTransOptList, clock() );
-  ReduceTransOptCache();
+  m_transOptCache.Clear();
 }
-void StaticData::ClearTransOptionCache() const {
-  map<std::pair<size_t, Phrase>, std::pair< TranslationOptionList*, clock_t > >::iterator iterCache;
-  for (iterCache = m_transOptCache.begin() ; iterCache != m_transOptCache.end() ; ++iterCache) {
-    TranslationOptionList *transOptList = iterCache->second.first;
-    delete transOptList;
-  }
+
+#ifdef WITH_THREADS
+ThreadPool &StaticData::GetSearchThreadPool() const
+{
+  // the thread of the sentence does one share of the work itself
+  static ThreadPool pool(m_searchThreadCount - 1);
+  return pool;
 }
+#endif
 
 }
 
@@ -45,6 +45,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "SentenceStats.h"
 #include "DecodeGraph.h"
 #include "TranslationOptionList.h"
+#include "TransOptCache.h"
 #include "TranslationSystem.h"
 
 #if HAVE_CONFIG_H
@@ -67,6 +68,9 @@ class UnknownWordPenaltyProducer;
 class SyntacticLanguageModel;
 #endif
 class TranslationSystem;
+#ifdef WITH_THREADS
+class ThreadPool;
+#endif
 
 typedef std::pair<std::string, float> UnknownLHSEntry;
 typedef std::vector<UnknownLHSEntry>  UnknownLHSList;
@@ -172,20 +176,18 @@ protected:
   float m_lmbrMapWeight; //! Weight given to the map solution. See Kumar et al 09 for details
 
   size_t m_lmcache_cleanup_threshold; //! number of translations after which LM claenup is performed (0=never, N=after N translations; default is 1)
+  size_t m_lmNGramCacheBytes; //! memory of the shared n-gram cache of each SRI or IRST language model
+  bool m_kenLMHugePages; //! read binary KenLM models into huge pages
+  std::string m_kenLMSharedMemory; //! prefix of the shared memory segments of binary KenLM models, empty for none
   bool m_lmEnableOOVFeature;
 
   bool m_timeout; //! use timeout
   size_t m_timeout_threshold; //! seconds after which time out is activated
 
   bool m_useTransOptCache; //! flag indicating, if the persistent translation option cache should be used
-  mutable std::map<std::pair<size_t, Phrase>, std::pair<TranslationOptionList*,clock_t> > m_transOptCache; //! persistent translation option cache
-  size_t m_transOptCacheMaxSize; //! maximum size for persistent translation option cache
-  //FIXME: Single lock for cache not most efficient. However using a
-  //reader-writer for LRU cache is tricky - how to record last used time?
-#ifdef WITH_THREADS
-  mutable boost::mutex m_transOptCacheMutex;
-#endif
+  mutable TransOptCache m_transOptCache; //! persistent translation option cache
   bool m_isAlwaysCreateDirectTranslationOption;
+  bool m_lazyTranslationOptions; //! create translation options of multi-word spans when the search asks for them
   //! constructor. only the 1 static variable can be created
 
   bool m_outputWordGraph; //! whether to output word graph
@@ -210,6 +212,8 @@ protected:
   WordAlignmentSort m_wordAlignmentSort;
 
   int m_threadCount;
+  bool m_threadsLongestFirst;
+  int m_searchThreadCount;
 
   StaticData();
 
@@ -233,7 +237,6 @@ protected:
   bool LoadDecodeGraphs();
   bool LoadLexicalReorderingModel();
   bool LoadGlobalLexicalModel();
-  void ReduceTransOptCache() const;
   bool m_continuePartialTranslation;
 
 public:
@@ -532,6 +535,15 @@ public:
   size_t GetLMCacheCleanupThreshold() const {
     return m_lmcache_cleanup_threshold;
   }
+  size_t GetLMNGramCacheBytes() const {
+    return m_lmNGramCacheBytes;
+  }
+  bool GetKenLMHugePages() const {
+    return m_kenLMHugePages;
+  }
+  const std::string &GetKenLMSharedMemory() const {
+    return m_kenLMSharedMemory;
+  }
 
   bool GetLMEnableOOVFeature() const {
     return m_lmEnableOOVFeature;
@@ -563,12 +575,20 @@ public:
     return m_useTransOptCache;
   }
 
+  bool IsLazyTranslationOptions() const {
+    return m_lazyTranslationOptions;
+  }
+
   void AddTransOptListToCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase, const TranslationOptionList &transOptList) const;
 
   void ClearTransOptionCache() const;
 
 
-  const TranslationOptionList* FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const;
+  TransOptCache::ListPtr FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const;
+
+  const TransOptCache &GetTransOptCache() const {
+    return m_transOptCache;
+  }
 
   bool PrintAllDerivations() const {
     return m_printAllDerivations;
@@ -610,6 +630,17 @@ public:
   int ThreadCount() const {
     return m_threadCount;
   }
+  //! whether the sentence tasks are prioritised by length
+  bool ThreadsLongestFirst() const {
+    return m_threadsLongestFirst;
+  }
+  int SearchThreadCount() const {
+    return m_searchThreadCount;
+  }
+#ifdef WITH_THREADS
+  //! worker threads that help the thread of a sentence, shared by all sentences
+  ThreadPool &GetSearchThreadPool() const;
+#endif
 };
 
 }
@@ -31,6 +31,7 @@ template <class MY, class MX, class YS=typename MY::RandVarType, class B=NullBac
  }
 
  virtual int Compare(const FFState& other) const;
+ virtual size_t Hash() const { return 0; } // Compare() treats all states as equal
 
   // Get the LM score from this LM state
   double getScore() const;
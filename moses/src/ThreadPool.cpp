@@ -20,6 +20,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 
+#include <algorithm>
+#include <stdexcept>
+
 #include "ThreadPool.h"
 
 #ifdef WITH_THREADS
@@ -31,27 +34,82 @@ namespace Moses
 {
 
 ThreadPool::ThreadPool( size_t numThreads )
-  : m_stopped(false), m_stopping(false)
+  : m_nextQueue(0), m_numQueued(0), m_nextSequence(0), m_stopped(false), m_stopping(false)
 {
+  for (size_t i = 0; i < std::max(numThreads, (size_t) 1); ++i) {
+    m_queues.push_back(new WorkQueue());
+  }
   for (size_t i = 0; i < numThreads; ++i) {
-    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this));
+    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this,i));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  Stop();
+  for (size_t i = 0; i < m_queues.size(); ++i) {
+    delete m_queues[i];
   }
 }
 
-void ThreadPool::Execute()
+void ThreadPool::Push(WorkQueue &queue, QueuedTask queued)
 {
+  // called with m_mutex held, which guards m_nextSequence
+  queued.sequence = m_nextSequence++;
+  boost::mutex::scoped_lock lock(queue.mutex);
+  queue.tasks.push_back(queued);
+  std::push_heap(queue.tasks.begin(), queue.tasks.end());
+}
+
+Task *ThreadPool::Pop(WorkQueue &queue)
+{
+  boost::mutex::scoped_lock lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return NULL;
+  }
+  std::pop_heap(queue.tasks.begin(), queue.tasks.end());
+  Task *task = queue.tasks.back().task;
+  queue.tasks.pop_back();
+  return task;
+}
+
+Task *ThreadPool::Steal(size_t worker)
+{
+  // take the most urgent task of all the other queues, so that a long
+  // sentence doesn't wait behind the short ones of a busy worker
+  WorkQueue *victim = NULL;
+  QueuedTask best = QueuedTask();
+  for (size_t i = 1; i < m_queues.size(); ++i) {
+    WorkQueue &queue = *m_queues[(worker + i) % m_queues.size()];
+    boost::mutex::scoped_lock lock(queue.mutex);
+    if (!queue.tasks.empty() && (victim == NULL || best < queue.tasks.front())) {
+      victim = &queue;
+      best = queue.tasks.front();
+    }
+  }
+  return victim ? Pop(*victim) : NULL;
+}
+
+void ThreadPool::Execute(size_t worker)
+{
+  WorkQueue &queue = *m_queues[worker];
   do {
-    Task* task = NULL;
+    // Find a job to perform
+    Task* task = Pop(queue);
+    if (!task) {
+      task = Steal(worker);
+    }
     {
-      // Find a job to perform
       boost::mutex::scoped_lock lock(m_mutex);
-      if (m_tasks.empty() && !m_stopped) {
+      if (task) {
+        --m_numQueued;
+        if (m_stopped) {
+          // stopped without processing the remaining jobs
+          break;
+        }
+      } else if (m_numQueued == 0 && !m_stopped) {
         m_threadNeeded.wait(lock);
       }
-      if (!m_stopped && !m_tasks.empty()) {
-        task = m_tasks.front();
-        m_tasks.pop();
-      }
     }
     //Execute job
     if (task) {
@@ -59,20 +117,49 @@ void ThreadPool::Execute()
       if (task->DeleteAfterExecution()) {
         delete task;
       }
+      m_threadAvailable.notify_all();
     }
-    m_threadAvailable.notify_all();
   } while (!m_stopped);
 }
 
 void ThreadPool::Submit( Task* task )
 {
+  QueuedTask queued;
+  queued.priority = task->GetPriority();
+  queued.task = task;
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  if (m_stopping) {
+    throw runtime_error("ThreadPool stopping - unable to accept new jobs");
+  }
+  Push(*m_queues[m_nextQueue], queued);
+  m_nextQueue = (m_nextQueue + 1) % m_queues.size();
+  ++m_numQueued;
+  m_threadNeeded.notify_one();
+}
+
+void ThreadPool::SubmitBatch(const std::vector<Task*> &tasks)
+{
+  // deal the tasks out most urgent first, so that every worker starts
+  // on one of the highest priority tasks
+  std::vector<QueuedTask> ordered(tasks.size());
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    ordered[i].priority = tasks[i]->GetPriority();
+    ordered[i].sequence = i;
+    ordered[i].task = tasks[i];
+  }
+  std::sort(ordered.rbegin(), ordered.rend());
+
   boost::mutex::scoped_lock lock(m_mutex);
   if (m_stopping) {
     throw runtime_error("ThreadPool stopping - unable to accept new jobs");
   }
-  m_tasks.push(task);
+  for (size_t i = 0; i < ordered.size(); ++i) {
+    Push(*m_queues[m_nextQueue], ordered[i]);
+    m_nextQueue = (m_nextQueue + 1) % m_queues.size();
+  }
+  m_numQueued += ordered.size();
   m_threadNeeded.notify_all();
-
 }
 
 void ThreadPool::Stop(bool processRemainingJobs)
@@ -85,8 +172,8 @@ void ThreadPool::Stop(bool processRemainingJobs)
   }
   if (processRemainingJobs) {
     boost::mutex::scoped_lock lock(m_mutex);
-    //wait for queue to drain.
-    while (!m_tasks.empty() && !m_stopped) {
+    //wait for queues to drain.
+    while (m_numQueued > 0 && !m_stopped) {
       m_threadAvailable.wait(lock);
     }
   }
@@ -101,6 +188,22 @@ void ThreadPool::Stop(bool processRemainingJobs)
   m_threads.join_all();
 }
 
+void PendingShares::Done()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  if (--m_numPending == 0) {
+    m_finished.notify_all();
+  }
+}
+
+void PendingShares::Wait()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  while (m_numPending > 0) {
+    m_finished.wait(lock);
+  }
+}
+
 }
 #endif //WITH_THREADS
 
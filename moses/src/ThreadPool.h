@@ -23,7 +23,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #define moses_ThreadPool_h
 
 #include <iostream>
-#include <queue>
 #include <vector>
 
 #ifdef WITH_THREADS
@@ -55,11 +54,18 @@ class Task
 public:
   virtual void Run() = 0;
   virtual bool DeleteAfterExecution() {return true;}
+  //! tasks with a higher priority are started first, eg. longer sentences
+  virtual int GetPriority() const {return 0;}
   virtual ~Task() {}
 };
 
 #ifdef WITH_THREADS
 
+/**
+  * Each worker thread has its own queue, a heap ordered by decreasing task
+  * priority. Workers take the most urgent task of their own queue and, once
+  * that is empty, steal the most urgent task from the other queues.
+  **/
 class ThreadPool
 {
 public:
@@ -74,25 +80,55 @@ public:
    **/
   void Submit(Task* task);
 
+  /**
+   * Add several jobs at once. The jobs are spread over the workers
+   * so that the ones with the highest priority are started first.
+   **/
+  void SubmitBatch(const std::vector<Task*> &tasks);
+
   /**
     * Wait until all queued jobs have completed, and shut down
     * the ThreadPool.
     **/
   void Stop(bool processRemainingJobs = false);
 
-  ~ThreadPool() {
-    Stop();
-  }
+  ~ThreadPool();
 
 
 
 private:
+  //! a queued task, with its priority read once on submission
+  struct QueuedTask {
+    int priority;
+    size_t sequence; /**< submission order, keeps equal priorities FIFO */
+    Task *task;
+    bool operator<(const QueuedTask &other) const {
+      if (priority != other.priority) {
+        return priority < other.priority;
+      }
+      return sequence > other.sequence;
+    }
+  };
+
+  //! tasks waiting for one worker, a heap with the most urgent on top
+  struct WorkQueue {
+    std::vector<QueuedTask> tasks;
+    boost::mutex mutex;
+  };
+
   /**
     * The main loop executed by each thread.
     **/
-  void Execute();
+  void Execute(size_t worker);
 
-  std::queue<Task*> m_tasks;
+  void Push(WorkQueue &queue, QueuedTask queued);
+  Task *Pop(WorkQueue &queue);
+  Task *Steal(size_t worker);
+
+  std::vector<WorkQueue*> m_queues;
+  size_t m_nextQueue; /**< queue the next submitted task goes to */
+  size_t m_numQueued; /**< tasks in all queues, guarded by m_mutex */
+  size_t m_nextSequence; /**< sequence of the next submitted task, guarded by m_mutex */
   boost::thread_group m_threads;
   boost::mutex m_mutex;
   boost::condition_variable m_threadNeeded;
@@ -103,6 +139,45 @@ private:
 };
 
 
+/**
+  * Counts the shares of a RunShares() call that run on other threads
+  **/
+class PendingShares
+{
+public:
+  PendingShares(size_t numPending) : m_numPending(numPending) {}
+
+  //! called by each share when it is done
+  void Done();
+
+  //! wait until all shares are done
+  void Wait();
+
+private:
+  size_t m_numPending;
+  boost::mutex m_mutex;
+  boost::condition_variable m_finished;
+};
+
+//! runs one share of a RunShares() call in a worker thread
+template <class Work>
+class ShareTask : public Task
+{
+public:
+  ShareTask(Work &work, size_t share, PendingShares &pending)
+    : m_work(work), m_share(share), m_pending(pending) {}
+
+  virtual void Run() {
+    m_work(m_share);
+    m_pending.Done();
+  }
+
+private:
+  Work &m_work;
+  size_t m_share;
+  PendingShares &m_pending;
+};
+
 class TestTask : public Task
 {
 public:
@@ -122,6 +197,28 @@ private:
   int m_id;
 };
 
+/**
+  * Calls work(share) for every share from 0 to numShares - 1 and returns
+  * once all of them are done. Share 0 runs in the calling thread, the others
+  * in the pool. The shares must not call RunShares() on the same pool.
+  **/
+template <class Work>
+void RunShares(ThreadPool &pool, size_t numShares, Work work)
+{
+  if (numShares == 0) {
+    return;
+  }
+  PendingShares pending(numShares - 1);
+  std::vector<Task*> tasks;
+  for (size_t share = 1; share < numShares; ++share) {
+    tasks.push_back(new ShareTask<Work>(work, share, pending));
+  }
+  pool.SubmitBatch(tasks);
+
+  work(0);
+  pending.Wait();
+}
+
 #endif //WITH_THREADS
 
 }
@@ -0,0 +1,158 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/functional/hash.hpp>
+#include "TransOptCache.h"
+#include "StaticData.h"
+
+namespace Moses
+{
+
+TransOptCache::TransOptCache(size_t maxSize)
+{
+  SetMaxSize(maxSize);
+}
+
+void TransOptCache::SetMaxSize(size_t maxSize)
+{
+  Clear();
+  m_shardSize = (maxSize + NumShards - 1) / NumShards;
+}
+
+size_t TransOptCache::KeyHasher::operator()(const Key &key) const
+{
+  size_t seed = key.first;
+  boost::hash_combine(seed, HashFactors(key.second, StaticData::Instance().GetInputFactorOrder()));
+  return seed;
+}
+
+TransOptCache::Shard &TransOptCache::GetShard(const Key &key) const
+{
+  return m_shards[KeyHasher()(key) % NumShards];
+}
+
+TransOptCache::ListPtr TransOptCache::Find(size_t decodeGraph, const Phrase &source) const
+{
+  if (m_shardSize == 0)
+    return ListPtr();
+
+  Key key(decodeGraph, source);
+  Shard &shard = GetShard(key);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+  boost::unordered_map<Key, size_t, KeyHasher>::const_iterator iter = shard.index.find(key);
+  if (iter == shard.index.end()) {
+    ++shard.misses;
+    return ListPtr();
+  }
+  ++shard.hits;
+  Slot &slot = shard.slots[iter->second];
+  slot.referenced = true;
+  return slot.list;
+}
+
+void TransOptCache::Add(size_t decodeGraph, const Phrase &source, const TranslationOptionList &transOptList)
+{
+  if (m_shardSize == 0)
+    return;
+
+  // copy outside the lock
+  ListPtr list(new TranslationOptionList(transOptList));
+  Key key(decodeGraph, source);
+  Shard &shard = GetShard(key);
+  ListPtr evicted; // freed after the lock is released
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+
+  std::pair<boost::unordered_map<Key, size_t, KeyHasher>::iterator, bool> ret
+  = shard.index.insert(std::make_pair(key, shard.slots.size()));
+  if (!ret.second) {
+    // another thread translated the same phrase
+    Slot &slot = shard.slots[ret.first->second];
+    evicted.swap(slot.list);
+    slot.list = list;
+    slot.referenced = true;
+    return;
+  }
+
+  if (shard.slots.size() < m_shardSize) {
+    Slot slot;
+    slot.key = &ret.first->first;
+    slot.list = list;
+    slot.referenced = false;
+    shard.slots.push_back(slot);
+    return;
+  }
+
+  // clock: give entries that were used since the hand last passed a second chance
+  while (shard.slots[shard.hand].referenced) {
+    shard.slots[shard.hand].referenced = false;
+    shard.hand = (shard.hand + 1) % shard.slots.size();
+  }
+  Slot &slot = shard.slots[shard.hand];
+  shard.index.erase(shard.index.find(*slot.key));
+  ret.first->second = shard.hand;
+  slot.key = &ret.first->first;
+  evicted.swap(slot.list);
+  slot.list = list;
+  shard.hand = (shard.hand + 1) % shard.slots.size();
+}
+
+void TransOptCache::Clear()
+{
+  for (size_t i = 0; i < NumShards; ++i) {
+    Shard &shard = m_shards[i];
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(shard.mutex);
+#endif
+    shard.index.clear();
+    shard.slots.clear();
+    shard.hand = 0;
+  }
+}
+
+size_t TransOptCache::GetHits() const
+{
+  size_t hits = 0;
+  for (size_t i = 0; i < NumShards; ++i) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_shards[i].mutex);
+#endif
+    hits += m_shards[i].hits;
+  }
+  return hits;
+}
+
+size_t TransOptCache::GetMisses() const
+{
+  size_t misses = 0;
+  for (size_t i = 0; i < NumShards; ++i) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_shards[i].mutex);
+#endif
+    misses += m_shards[i].misses;
+  }
+  return misses;
+}
+
+}
@@ -0,0 +1,104 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_TransOptCache_h
+#define moses_TransOptCache_h
+
+#include <utility>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "Phrase.h"
+#include "TranslationOptionList.h"
+
+namespace Moses
+{
+
+/** Persistent (cross-sentence) cache of the translation options of source
+ * phrases, keyed by decode graph and source phrase.
+ *
+ * Entries are spread over a fixed number of shards by hash, each with its own
+ * lock, hash table and CLOCK eviction ring. A hit only sets the entry's
+ * reference bit, so the critical sections are short and threads looking up
+ * different phrases rarely wait for each other. Lists are handed out as
+ * shared pointers, so evicting an entry never frees a list that another
+ * thread is still copying from.
+ */
+class TransOptCache
+{
+public:
+  typedef boost::shared_ptr<const TranslationOptionList> ListPtr;
+
+  explicit TransOptCache(size_t maxSize = 0);
+
+  //! maximum number of cached source phrases. 0 disables the cache. Drops all entries
+  void SetMaxSize(size_t maxSize);
+
+  //! cached options, or a null pointer if there are none
+  ListPtr Find(size_t decodeGraph, const Phrase &source) const;
+  //! store a copy of transOptList, evicting an entry that wasn't used recently if the shard is full
+  void Add(size_t decodeGraph, const Phrase &source, const TranslationOptionList &transOptList);
+  void Clear();
+
+  size_t GetHits() const;
+  size_t GetMisses() const;
+
+protected:
+  typedef std::pair<size_t, Phrase> Key;
+
+  //! hashes the input factors of the source phrase, which every input word has
+  struct KeyHasher {
+    size_t operator()(const Key &key) const;
+  };
+
+  struct Slot {
+    const Key *key; //! points at the key stored in the index
+    ListPtr list;
+    bool referenced;
+  };
+
+  struct Shard {
+    boost::unordered_map<Key, size_t, KeyHasher> index; //! slot of each key
+    std::vector<Slot> slots;
+    size_t hand; //! next slot the clock looks at when evicting
+    size_t hits, misses;
+#ifdef WITH_THREADS
+    boost::mutex mutex;
+#endif
+    Shard() : hand(0), hits(0), misses(0) {}
+  };
+
+  static const size_t NumShards = 16;
+
+  mutable Shard m_shards[NumShards];
+  size_t m_shardSize; //! maximum number of entries per shard
+
+  Shard &GetShard(const Key &key) const;
+};
+
+}
+
+#endif
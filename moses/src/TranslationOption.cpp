@@ -146,7 +146,7 @@ void TranslationOption::CalcScore(const TranslationSystem* system)
   size_t phraseSize = GetTargetPhrase().GetSize();
   // future score
   m_futureScore = retFullScore - ngramScore + oovScore
-                  + m_scoreBreakdown.InnerProduct(StaticData::Instance().GetAllWeights()) - phraseSize *
+                  + m_scoreBreakdown.GetWeightedScore() - phraseSize *
                   system->GetWeightWordPenalty();
 }
 
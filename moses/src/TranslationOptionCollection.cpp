@@ -33,6 +33,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "StaticData.h"
 #include "DecodeStepTranslation.h"
 #include "DecodeGraph.h"
+#include "ThreadPool.h"
 
 using namespace std;
 
@@ -44,6 +45,26 @@ bool CompareTranslationOption(const TranslationOption *a, const TranslationOptio
   return a->GetFutureScore() > b->GetFutureScore();
 }
 
+#ifdef WITH_THREADS
+/** creates the options of one share of the spans,
+ * see TranslationOptionCollection::CreateTranslationOptionsInParallel() */
+class CreateTranslationOptionsShare
+{
+public:
+  CreateTranslationOptionsShare(TranslationOptionCollection &collection, size_t numShares)
+    : m_collection(collection), m_numShares(numShares)
+  {}
+
+  void operator()(size_t share) {
+    m_collection.CreateTranslationOptionsForStarts(share, m_numShares);
+  }
+
+private:
+  TranslationOptionCollection &m_collection;
+  size_t m_numShares;
+};
+#endif
+
 /** constructor; since translation options are indexed by coverage span, the corresponding data structure is initialized here
 	* This fn should be called by inherited classes
 */
@@ -96,47 +117,11 @@ void TranslationOptionCollection::Prune()
     for (size_t endPos = startPos ; endPos < startPos + maxSize ; ++endPos) {
       // consider list for a span
       TranslationOptionList &fullList = GetTranslationOptionList(startPos, endPos);
+      size_t sizePruned, thresholdPruned;
       total += fullList.size();
-
-      // size pruning
-      if (m_maxNoTransOptPerCoverage > 0 &&
-          fullList.size() > m_maxNoTransOptPerCoverage) {
-        // sort in vector
-        nth_element(fullList.begin(), fullList.begin() + m_maxNoTransOptPerCoverage, fullList.end(), CompareTranslationOption);
-        totalPruned += fullList.size() - m_maxNoTransOptPerCoverage;
-
-        // delete the rest
-        for (size_t i = m_maxNoTransOptPerCoverage ; i < fullList.size() ; ++i) {
-          delete fullList.Get(i);
-        }
-        fullList.resize(m_maxNoTransOptPerCoverage);
-      }
-
-      // threshold pruning
-      if (fullList.size() > 1 && m_translationOptionThreshold != -std::numeric_limits<float>::infinity()) {
-        // first, find the best score
-        float bestScore = -std::numeric_limits<float>::infinity();
-        for (size_t i=0; i < fullList.size() ; ++i) {
-          if (fullList.Get(i)->GetFutureScore() > bestScore)
-            bestScore = fullList.Get(i)->GetFutureScore();
-        }
-        //std::cerr << "best score for span " << startPos << "-" << endPos << " is " << bestScore << "\n";
-        // then, remove items that are worse than best score + threshold
-        for (size_t i=0; i < fullList.size() ; ++i) {
-          if (fullList.Get(i)->GetFutureScore() < bestScore + m_translationOptionThreshold) {
-            //std::cerr << "\tremoving item " << i << ", score " << fullList.Get(i)->GetFutureScore() << ": " << fullList.Get(i)->GetTargetPhrase() << "\n";
-            delete fullList.Get(i);
-            fullList.Remove(i);
-            total--;
-            totalPruned++;
-            i--;
-          }
-          //else
-          //{
-          //	std::cerr << "\tkeeping item " << i << ", score " << fullList.Get(i)->GetFutureScore() << ": " << fullList.Get(i)->GetTargetPhrase() << "\n";
-          //}
-        }
-      } // end of threshold pruning
+      Prune(fullList, sizePruned, thresholdPruned);
+      total -= thresholdPruned;
+      totalPruned += sizePruned + thresholdPruned;
     }
   } // end of loop through all spans
 
@@ -144,6 +129,49 @@ void TranslationOptionCollection::Prune()
           << "Total translation options pruned: " << totalPruned << std::endl);
 }
 
+/** prune the options of one span to the top n (m_maxNoTransOptPerCoverage) and to the threshold
+ * \param sizePruned set to the number of options removed by the size limit
+ * \param thresholdPruned set to the number of options removed by the threshold
+ */
+void TranslationOptionCollection::Prune(TranslationOptionList &fullList, size_t &sizePruned, size_t &thresholdPruned) const
+{
+  sizePruned = 0;
+  thresholdPruned = 0;
+
+  // size pruning
+  if (m_maxNoTransOptPerCoverage > 0 &&
+      fullList.size() > m_maxNoTransOptPerCoverage) {
+    // sort in vector
+    nth_element(fullList.begin(), fullList.begin() + m_maxNoTransOptPerCoverage, fullList.end(), CompareTranslationOption);
+    sizePruned = fullList.size() - m_maxNoTransOptPerCoverage;
+
+    // delete the rest
+    for (size_t i = m_maxNoTransOptPerCoverage ; i < fullList.size() ; ++i) {
+      delete fullList.Get(i);
+    }
+    fullList.resize(m_maxNoTransOptPerCoverage);
+  }
+
+  // threshold pruning
+  if (fullList.size() > 1 && m_translationOptionThreshold != -std::numeric_limits<float>::infinity()) {
+    // first, find the best score
+    float bestScore = -std::numeric_limits<float>::infinity();
+    for (size_t i=0; i < fullList.size() ; ++i) {
+      if (fullList.Get(i)->GetFutureScore() > bestScore)
+        bestScore = fullList.Get(i)->GetFutureScore();
+    }
+    // then, remove items that are worse than best score + threshold
+    for (size_t i=0; i < fullList.size() ; ++i) {
+      if (fullList.Get(i)->GetFutureScore() < bestScore + m_translationOptionThreshold) {
+        delete fullList.Get(i);
+        fullList.Remove(i);
+        thresholdPruned++;
+        i--;
+      }
+    }
+  } // end of threshold pruning
+}
+
 /** Force a creation of a translation option where there are none for a particular source position.
 * ie. where a source word has not been translated, create a translation option by
 *				1. not observing the table limits on phrase/generation tables
@@ -294,6 +322,10 @@ void TranslationOptionCollection::CalcFutureScore()
         if (score > m_futureScore.GetScore(startPos, endPos))
           m_futureScore.SetScore(startPos, endPos, score);
       }
+
+      // options that lazy creation left out count with their best possible score
+      if (!m_pendingScore.empty() && m_pendingScore[startPos][endPos - startPos] > m_futureScore.GetScore(startPos, endPos))
+        m_futureScore.SetScore(startPos, endPos, m_pendingScore[startPos][endPos - startPos]);
     }
   }
 
@@ -354,11 +386,47 @@ void TranslationOptionCollection::CalcFutureScore()
  */
 void TranslationOptionCollection::CreateTranslationOptions()
 {
+  if (CanCreateLazily()) {
+    CreateTranslationOptionsLazily();
+    return;
+  }
+
   // loop over all substrings of the source sentence, look them up
   // in the phraseDictionary (which is the- possibly filtered-- phrase
   // table loaded on initialization), generate TranslationOption objects
   // for all phrases
+#ifdef WITH_THREADS
+  if (CanCreateInParallel()) {
+    CreateTranslationOptionsInParallel();
+  } else
+#endif
+  {
+    CreateTranslationOptionsForStarts(0, 1);
+  }
 
+  VERBOSE(2,"Translation Option Collection\n " << *this << endl);
+
+  ProcessUnknownWord();
+
+  // Prune
+  Prune();
+
+  Sort();
+
+  // future score matrix
+  CalcFutureScore();
+
+  // Cached lex reodering costs
+  CacheLexReordering();
+}
+
+/** Create the translation options of the spans that start at firstStart,
+ * firstStart + step, ... up to the end of the sentence. The spans of different
+ * start positions are independent, so that several threads can each create a
+ * share of them into their own lists.
+ */
+void TranslationOptionCollection::CreateTranslationOptionsForStarts(size_t firstStart, size_t step)
+{
   // there may be multiple decoding graphs (factorizations of decoding)
   const vector <DecodeGraph*> &decodeGraphList = m_system->GetDecodeGraphs();
   const vector <size_t> &decodeGraphBackoff = m_system->GetDecodeGraphBackoff();
@@ -374,7 +442,7 @@ void TranslationOptionCollection::CreateTranslationOptions()
 
     const DecodeGraph &decodeGraph = *decodeGraphList[graph];
     // generate phrases that start at startPos ...
-    for (size_t startPos = 0 ; startPos < size; startPos++) {
+    for (size_t startPos = firstStart ; startPos < size; startPos += step) {
       size_t maxSize = size - startPos; // don't go over end of sentence
       size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
       maxSize = std::min(maxSize, maxSizePhrase);
@@ -395,23 +463,138 @@ void TranslationOptionCollection::CreateTranslationOptions()
       }
     }
   }
+}
 
-  VERBOSE(2,"Translation Option Collection\n " << *this << endl);
+/** The spans are only created in parallel if every thread can look up the
+ * phrase tables: dictionaries kept per thread (binary and memory-mapped
+ * tables) are only initialised for the thread translating the sentence.
+ * Generation dictionaries, language models and the persistent cache are
+ * shared by the threads of -threads already.
+ */
+bool TranslationOptionCollection::CanCreateInParallel() const
+{
+  if (StaticData::Instance().SearchThreadCount() <= 1 || m_source.GetSize() <= 1)
+    return false;
 
-  ProcessUnknownWord();
+  const vector<PhraseDictionaryFeature*> &phraseDictionaries = m_system->GetPhraseDictionaries();
+  for (size_t i = 0 ; i < phraseDictionaries.size() ; ++i) {
+    if (!phraseDictionaries[i]->IsThreadSafe())
+      return false;
+  }
+  return true;
+}
 
-  // Prune
-  Prune();
+#ifdef WITH_THREADS
+/** Each search thread creates the spans of every numShares-th start position,
+ * which evens out the shorter spans near the end of the sentence. Each span
+ * is only touched by one thread, which walks the decoding graphs in the same
+ * order as the serial loop, so the lists are the same as in serial mode.
+ */
+void TranslationOptionCollection::CreateTranslationOptionsInParallel()
+{
+  const size_t numShares = std::min((size_t) StaticData::Instance().SearchThreadCount(), m_source.GetSize());
 
+  RunShares(StaticData::Instance().GetSearchThreadPool(), numShares, CreateTranslationOptionsShare(*this, numShares));
+}
+#endif
+
+/** Lazy creation (lazy-translation-options) is only done when nothing but the
+ * phrase table decides about the options of a multi-word span: a single decoding
+ * graph with a single translation step, plain text input without xml, and
+ * a search that asks for spans from one thread only.
+ */
+bool TranslationOptionCollection::CanCreateLazily() const
+{
+  const StaticData &staticData = StaticData::Instance();
+  const vector <DecodeGraph*> &decodeGraphList = m_system->GetDecodeGraphs();
+
+  return staticData.IsLazyTranslationOptions()
+         && staticData.SearchThreadCount() <= 1
+         && m_source.GetType() == SentenceInput
+         && m_source.GetSize() > 0
+         && decodeGraphList.size() == 1
+         && decodeGraphList[0]->GetSize() == 1
+         && !HasXmlOptionsOverlappingRange(0, m_source.GetSize() - 1);
+}
+
+/** Create the translation options of single-word spans, which are needed to
+ * find unknown words, as CreateTranslationOptions() does. Multi-word spans are
+ * only looked up in the phrase table to bound the future score of their options,
+ * which makes the future score matrix. Their options are created, pruned and
+ * sorted by EnsureRangeCreated() when the search first asks for them, so spans
+ * the search never reaches cost no language model lookups.
+ */
+void TranslationOptionCollection::CreateTranslationOptionsLazily()
+{
+  const DecodeGraph &decodeGraph = *m_system->GetDecodeGraphs()[0];
+  size_t size = m_source.GetSize();
+
+  for (size_t startPos = 0 ; startPos < size; startPos++) {
+    CreateTranslationOptionsForRange(decodeGraph, startPos, startPos, true);
+  }
+
+  ProcessUnknownWord();
+  Prune();
   Sort();
 
-  // future score matrix
-  CalcFutureScore();
+  size_t pending = 0, total = 0;
+  m_pendingScore.resize(size);
+  for (size_t startPos = 0 ; startPos < size; startPos++) {
+    m_pendingScore[startPos].resize(m_collection[startPos].size(), -numeric_limits<float>::infinity());
+    for (size_t endPos = startPos + 1 ; endPos < startPos + m_collection[startPos].size() ; endPos++) {
+      float bound = GetFutureScoreBound(decodeGraph, startPos, endPos);
+      m_pendingScore[startPos][endPos - startPos] = bound;
+      if (bound != -numeric_limits<float>::infinity())
+        pending++;
+      total++;
+    }
+  }
+  VERBOSE(2,"Lazy translation options: " << pending << " of " << total << " multi-word spans have options" << endl);
 
-  // Cached lex reodering costs
+  CalcFutureScore();
   CacheLexReordering();
 }
 
+/** Bound the future score of the options of a span without creating them, from
+ * the future scores the phrase table keeps with its target phrases. With a single
+ * translation step these are the future scores of the options, up to rounding.
+ * \return -inf if the phrase table has no translation of the span
+ */
+float TranslationOptionCollection::GetFutureScoreBound(const DecodeGraph &decodeGraph, size_t startPos, size_t endPos) const
+{
+  const DecodeStepTranslation &decodeStep = static_cast<const DecodeStepTranslation&>(**decodeGraph.begin());
+  const PhraseDictionary *phraseDictionary = decodeStep.GetPhraseDictionaryFeature()->GetDictionary();
+  const TargetPhraseCollection *phraseColl = phraseDictionary->GetTargetPhraseCollection(m_source, WordsRange(startPos, endPos));
+  if (phraseColl == NULL || phraseColl->GetSize() == 0)
+    return -numeric_limits<float>::infinity();
+
+  // same table limit as DecodeStepTranslation::ProcessInitialTranslation()
+  const size_t tableLimit = phraseDictionary->GetTableLimit();
+  TargetPhraseCollection::const_iterator iterTargetPhrase, iterEnd;
+  iterEnd = (tableLimit == 0 || phraseColl->GetSize() < tableLimit) ? phraseColl->end() : phraseColl->begin() + tableLimit;
+
+  float bound = -numeric_limits<float>::infinity();
+  for (iterTargetPhrase = phraseColl->begin() ; iterTargetPhrase != iterEnd ; ++iterTargetPhrase) {
+    bound = std::max(bound, (*iterTargetPhrase)->GetFutureScore());
+  }
+  return bound;
+}
+
+/** Create the translation options of a span left out by CreateTranslationOptionsLazily(),
+ * and prune, sort and cache them as CreateTranslationOptions() does for all spans.
+ */
+void TranslationOptionCollection::CreatePendingRange(size_t startPos, size_t endPos)
+{
+  m_pendingScore[startPos][endPos - startPos] = -numeric_limits<float>::infinity();
+  CreateTranslationOptionsForRange(*m_system->GetDecodeGraphs()[0], startPos, endPos, true);
+
+  TranslationOptionList &transOptList = GetTranslationOptionList(startPos, endPos);
+  size_t sizePruned, thresholdPruned;
+  Prune(transOptList, sizePruned, thresholdPruned);
+  std::sort(transOptList.begin(), transOptList.end(), CompareTranslationOption);
+  CacheLexReordering(transOptList);
+}
+
 void TranslationOptionCollection::Sort()
 {
   size_t size = m_source.GetSize();
@@ -452,9 +635,9 @@ void TranslationOptionCollection::CreateTranslationOptionsForRange(
       const WordsRange wordsRange(startPos, endPos);
       sourcePhrase = new Phrase(m_source.GetSubString(wordsRange));
 
-      const TranslationOptionList *transOptList = StaticData::Instance().FindTransOptListInCache(decodeGraph, *sourcePhrase);
+      TransOptCache::ListPtr transOptList = StaticData::Instance().FindTransOptListInCache(decodeGraph, *sourcePhrase);
       // is phrase in cache?
-      if (transOptList != NULL) {
+      if (transOptList) {
         skipTransOptCreation = true;
         TranslationOptionList::const_iterator iterTransOpt;
         for (iterTransOpt = transOptList->begin() ; iterTransOpt != transOptList->end() ; ++iterTransOpt) {
@@ -505,6 +688,11 @@ void TranslationOptionCollection::CreateTranslationOptionsForRange(
       PartialTranslOptColl &lastPartialTranslOptColl	= *oldPtoc;
       const vector<TranslationOption*>& partTransOptList = lastPartialTranslOptColl.GetList();
       vector<TranslationOption*>::const_iterator iterColl;
+      vector<const Phrase*> targetPhrases;
+      for (iterColl = partTransOptList.begin() ; iterColl != partTransOptList.end() ; ++iterColl) {
+        targetPhrases.push_back(&(*iterColl)->GetTargetPhrase());
+      }
+      m_system->GetLanguageModels().PrefetchPhrases(targetPhrases);
       for (iterColl = partTransOptList.begin() ; iterColl != partTransOptList.end() ; ++iterColl) {
         TranslationOption *transOpt = *iterColl;
         transOpt->CalcScore(m_system);
@@ -580,7 +768,8 @@ std::ostream& operator<<(std::ostream& out, const TranslationOptionCollection& c
     maxSize = std::min(maxSize, maxSizePhrase);
 
     for (size_t endPos = startPos ; endPos < startPos + maxSize ; ++endPos) {
-      const TranslationOptionList& fullList = coll.GetTranslationOptionList(startPos, endPos);
+      // only the options created so far
+      const TranslationOptionList& fullList = coll.m_collection[startPos][endPos - startPos];
       size_t sizeFull = fullList.size();
       for (size_t i = 0; i < sizeFull; i++) {
         out << *fullList.Get(i) << std::endl;
@@ -598,33 +787,36 @@ std::ostream& operator<<(std::ostream& out, const TranslationOptionCollection& c
 }
 
 void TranslationOptionCollection::CacheLexReordering()
+{
+  size_t size = m_source.GetSize();
+  for (size_t startPos = 0 ; startPos < size ; startPos++) {
+    size_t maxSize =  size - startPos;
+    size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
+    maxSize = std::min(maxSize, maxSizePhrase);
+
+    for (size_t endPos = startPos ; endPos < startPos + maxSize; endPos++) {
+      CacheLexReordering(GetTranslationOptionList( startPos, endPos));
+    }
+  }
+}
+
+void TranslationOptionCollection::CacheLexReordering(TranslationOptionList &transOptList) const
 {
   const vector<LexicalReordering*> &lexReorderingModels = m_system->GetReorderModels();
   std::vector<LexicalReordering*>::const_iterator iterLexreordering;
 
-  size_t size = m_source.GetSize();
   for (iterLexreordering = lexReorderingModels.begin() ; iterLexreordering != lexReorderingModels.end() ; ++iterLexreordering) {
     LexicalReordering &lexreordering = **iterLexreordering;
 
-    for (size_t startPos = 0 ; startPos < size ; startPos++) {
-      size_t maxSize =  size - startPos;
-      size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
-      maxSize = std::min(maxSize, maxSizePhrase);
-
-      for (size_t endPos = startPos ; endPos < startPos + maxSize; endPos++) {
-        TranslationOptionList &transOptList = GetTranslationOptionList( startPos, endPos);
-        TranslationOptionList::iterator iterTransOpt;
-        for(iterTransOpt = transOptList.begin() ; iterTransOpt != transOptList.end() ; ++iterTransOpt) {
-          TranslationOption &transOpt = **iterTransOpt;
-          //Phrase sourcePhrase =  m_source.GetSubString(WordsRange(startPos,endPos));
-          const Phrase *sourcePhrase = transOpt.GetSourcePhrase();
-          if (sourcePhrase) {
-            Scores score = lexreordering.GetProb(*sourcePhrase
-                                                 , transOpt.GetTargetPhrase());
-            if (!score.empty())
-              transOpt.CacheScores(lexreordering, score);
-          }
-        }
+    TranslationOptionList::iterator iterTransOpt;
+    for(iterTransOpt = transOptList.begin() ; iterTransOpt != transOptList.end() ; ++iterTransOpt) {
+      TranslationOption &transOpt = **iterTransOpt;
+      const Phrase *sourcePhrase = transOpt.GetSourcePhrase();
+      if (sourcePhrase) {
+        Scores score = lexreordering.GetProb(*sourcePhrase
+                                             , transOpt.GetTargetPhrase());
+        if (!score.empty())
+          transOpt.CacheScores(lexreordering, score);
       }
     }
   }
@@ -649,5 +841,19 @@ const TranslationOptionList &TranslationOptionCollection::GetTranslationOptionLi
   return m_collection[startPos][maxSize];
 }
 
+void TranslationOptionCollection::EnsureRangeCreated(size_t startPos, size_t endPos)
+{
+  if (m_pendingScore.empty()) {
+    return;
+  }
+  size_t maxSize = endPos - startPos;
+  size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
+  maxSize = std::min(maxSize, maxSizePhrase);
+
+  if (m_pendingScore[startPos][maxSize] != -numeric_limits<float>::infinity()) {
+    CreatePendingRange(startPos, endPos);
+  }
+}
+
 }
 
@@ -58,10 +58,12 @@ class Word;
  **/
 
 class DecodeGraph;
+class CreateTranslationOptionsShare;
 
 class TranslationOptionCollection
 {
   friend std::ostream& operator<<(std::ostream& out, const TranslationOptionCollection& coll);
+  friend class CreateTranslationOptionsShare;
   TranslationOptionCollection(const TranslationOptionCollection&); /*< no copy constructor */
 protected:
   const TranslationSystem* m_system;
@@ -71,6 +73,7 @@ protected:
   const size_t				m_maxNoTransOptPerCoverage; /*< maximum number of translation options per input span */
   const float				m_translationOptionThreshold; /*< threshold for translation options with regard to best option for input span */
   std::vector<Phrase*> m_unksrcs;
+  std::vector< std::vector<float> > m_pendingScore; /*< lazy creation only: best future score a span not created yet can have, or -inf once it is created */
 
 
   TranslationOptionCollection(const TranslationSystem* system, InputType const& src, size_t maxNoTransOptPerCoverage,
@@ -78,12 +81,29 @@ protected:
 
   void CalcFutureScore();
 
+  //! create the options of the spans starting at firstStart, firstStart + step, ... from all decoding graphs
+  void CreateTranslationOptionsForStarts(size_t firstStart, size_t step);
+  //! whether the spans may be created by several threads (search-threads)
+  bool CanCreateInParallel() const;
+  //! share the spans out to the search threads by start position and wait for them
+  void CreateTranslationOptionsInParallel();
+
+  //! whether options of multi-word spans may be created when the search first asks for them
+  bool CanCreateLazily() const;
+  //! create single-word spans now and only record the best future score of the others
+  void CreateTranslationOptionsLazily();
+  //! best future score of the options that CreateTranslationOptionsForRange() would create for a span, from the phrase table alone
+  float GetFutureScoreBound(const DecodeGraph &decodeGraph, size_t startPos, size_t endPos) const;
+  //! create, prune and sort the options of a span that lazy creation left out
+  void CreatePendingRange(size_t startPos, size_t endPos);
+
   //! Force a creation of a translation option where there are none for a particular source position.
   void ProcessUnknownWord();
   //! special handling of ONE unknown words.
   virtual void ProcessOneUnknownWord(const Word &sourceWord, size_t sourcePos, size_t length = 1, const Scores *inputScores = NULL);
   //! pruning: only keep the top n (m_maxNoTransOptPerCoverage) elements */
   void Prune();
+  void Prune(TranslationOptionList &fullList, size_t &sizePruned, size_t &thresholdPruned) const;
 
   //! sort all trans opt in each list for cube pruning */
   void Sort();
@@ -96,6 +116,7 @@ protected:
   //! implemented by inherited class, called by this class
   virtual void ProcessUnknownWord(size_t sourcePos)=0;
   void CacheLexReordering();
+  void CacheLexReordering(TranslationOptionList &transOptList) const;
 
 public:
   virtual ~TranslationOptionCollection();
@@ -130,7 +151,13 @@ public:
     return m_futureScore;
   }
 
-  //! list of trans opt for a particular span
+  /** create the options of a span that lazy creation left out, if it did.
+   * The search calls this before it reads a span. Not thread-safe, which is
+   * why spans are only created lazily with a single search thread. */
+  void EnsureRangeCreated(size_t startPos, size_t endPos);
+
+  /** list of trans opt for a particular span. With lazy-translation-options
+   * it is empty until EnsureRangeCreated() has been called for the span. */
   const TranslationOptionList &GetTranslationOptionList(const WordsRange &coverage) const {
     return GetTranslationOptionList(coverage.GetStartPos(), coverage.GetEndPos());
   }
@@ -42,6 +42,7 @@ class TrellisPath
 {
   friend std::ostream& operator<<(std::ostream&, const TrellisPath&);
   friend class Manager;
+  friend class KBestExtractor;
 
 protected:
   std::vector<const Hypothesis *> m_path; //< list of hypotheses/arcs
@@ -52,7 +53,7 @@ protected:
   ScoreComponentCollection	m_scoreBreakdown;
   float m_totalScore;
 
-  //Used by Manager::LatticeSample()
+  //Used by Manager::LatticeSample() and KBestExtractor
   TrellisPath(const std::vector<const Hypothesis*> edges);
 
   void InitScore();
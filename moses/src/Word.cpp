@@ -20,7 +20,9 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <cassert>
 #include <sstream>
+#include <boost/functional/hash.hpp>
 #include "memory.h"
 #include "Word.h"
 #include "TypeDef.h"
@@ -148,5 +150,16 @@ ostream& operator<<(ostream& out, const Word& word)
   return out;
 }
 
+size_t HashFactors(const Word &word, const std::vector<FactorType> &factorTypes)
+{
+  size_t seed = word.IsNonTerminal();
+  for (size_t i = 0 ; i < factorTypes.size() ; i++) {
+    const Factor *factor = word[factorTypes[i]];
+    assert(factor != NULL);
+    boost::hash_combine(seed, factor->GetId());
+  }
+  return seed;
+}
+
 }
 
@@ -136,6 +136,12 @@ public:
 
 };
 
+/** hash of the factors factorTypes of a word, which must all be set.
+ * Word::Compare() skips a factor that is missing in either word, so only
+ * factors that the decoder sets in every word it compares may be hashed,
+ * eg. the input factors of source words or the output factors of target words */
+size_t HashFactors(const Word &word, const std::vector<FactorType> &factorTypes);
+
 struct WordComparer {
   //! returns true if hypoA can be recombined with hypoB
   bool operator()(const Word *a, const Word *b) const {
@@ -35,73 +35,150 @@ namespace Moses
 {
 typedef unsigned long WordsBitmapID;
 
-/** vector of boolean used to represent whether a word has been translated or not
+/** vector of boolean used to represent whether a word has been translated or not.
+ * Coverage is packed into 64 bit words, bit (pos % 64) of word (pos / 64)
+ * standing for source position pos. Sentences of up to 128 words are stored
+ * inline, only longer ones allocate.
 */
 class WordsBitmap
 {
   friend std::ostream& operator<<(std::ostream& out, const WordsBitmap& wordsBitmap);
 protected:
+  typedef UINT64 Block;
+  enum { BitsPerBlock = 64, InlineBlocks = 2 };
+
   const size_t m_size; /**< number of words in sentence */
-  bool	*m_bitmap;	/**< ticks of words that have been done */
+  const size_t m_numBlocks; /**< number of blocks needed for m_size words */
+  Block	*m_bitmap;	/**< ticks of words that have been done. points to m_inline for short sentences */
+  Block	m_inline[InlineBlocks];
 
   WordsBitmap(); // not implemented
+  WordsBitmap& operator= (const WordsBitmap&); // not implemented
+
+  static size_t NumBlocks(size_t size) {
+    return (size + BitsPerBlock - 1) / BitsPerBlock;
+  }
+
+  //! number of set bits
+  static size_t PopCount(Block block) {
+#ifdef __GNUC__
+    return __builtin_popcountll(block);
+#else
+    size_t count = 0;
+    for (; block; block &= block - 1) ++count;
+    return count;
+#endif
+  }
+  //! index of lowest set bit. block must not be 0
+  static size_t LowestBit(Block block) {
+#ifdef __GNUC__
+    return __builtin_ctzll(block);
+#else
+    size_t pos = 0;
+    while (!(block & 1)) {
+      block >>= 1;
+      ++pos;
+    }
+    return pos;
+#endif
+  }
+  //! index of highest set bit. block must not be 0
+  static size_t HighestBit(Block block) {
+#ifdef __GNUC__
+    return BitsPerBlock - 1 - __builtin_clzll(block);
+#else
+    size_t pos = 0;
+    while (block >>= 1) ++pos;
+    return pos;
+#endif
+  }
+  //! bits of block that correspond to real words, ie. not padding at the end of the sentence
+  Block ValidMask(size_t blockIndex) const {
+    size_t rest = m_size - blockIndex * BitsPerBlock;
+    return (rest >= BitsPerBlock) ? ~Block(0) : ((Block(1) << rest) - 1);
+  }
+  //! mask for the positions [startPos, endPos] that fall into block blockIndex
+  static Block RangeMask(size_t blockIndex, size_t startPos, size_t endPos) {
+    size_t blockStart = blockIndex * BitsPerBlock;
+    size_t lo = (startPos > blockStart) ? startPos - blockStart : 0;
+    size_t hi = endPos - blockStart;
+    if (hi >= BitsPerBlock - 1) hi = BitsPerBlock - 1;
+    Block upper = (hi == BitsPerBlock - 1) ? ~Block(0) : ((Block(1) << (hi + 1)) - 1);
+    return upper & ~((Block(1) << lo) - 1);
+  }
+  //! up to 64 bits starting at position pos, position pos ending up in the lowest bit
+  Block GetBits(size_t pos, size_t count) const {
+    if (count == 0 || pos >= m_size) return 0;
+    size_t blockIndex = pos / BitsPerBlock
+                        , offset = pos % BitsPerBlock;
+    Block bits = m_bitmap[blockIndex] >> offset;
+    if (offset && blockIndex + 1 < m_numBlocks)
+      bits |= m_bitmap[blockIndex + 1] << (BitsPerBlock - offset);
+    if (count < BitsPerBlock)
+      bits &= (Block(1) << count) - 1;
+    return bits;
+  }
+
+  void Allocate() {
+    m_bitmap = (m_numBlocks <= InlineBlocks) ? m_inline : (Block*) malloc(sizeof(Block) * m_numBlocks);
+  }
 
   //! set all elements to false
   void Initialize() {
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      m_bitmap[pos] = false;
-    }
+    std::memset(m_bitmap, 0, sizeof(Block) * m_numBlocks);
   }
 
   //sets elements by vector
-  void Initialize(std::vector<bool> vector) {
+  void Initialize(const std::vector<bool> &vector) {
+    Initialize();
     size_t vector_size = vector.size();
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (pos < vector_size && vector[pos] == true) m_bitmap[pos] = true;
-      else m_bitmap[pos] = false;
+    for (size_t pos = 0 ; pos < m_size && pos < vector_size ; pos++) {
+      if (vector[pos]) SetValue(pos, true);
     }
   }
 
 
 public:
   //! create WordsBitmap of length size and initialise with vector
-  WordsBitmap(size_t size, std::vector<bool> initialize_vector)
-    :m_size	(size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * size);
+  WordsBitmap(size_t size, const std::vector<bool> &initialize_vector)
+    :m_size	(size)
+    ,m_numBlocks (NumBlocks(size)) {
+    Allocate();
     Initialize(initialize_vector);
   }
   //! create WordsBitmap of length size and initialise
   WordsBitmap(size_t size)
-    :m_size	(size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * size);
+    :m_size	(size)
+    ,m_numBlocks (NumBlocks(size)) {
+    Allocate();
     Initialize();
   }
   //! deep copy
   WordsBitmap(const WordsBitmap &copy)
-    :m_size	(copy.m_size) {
-    m_bitmap = (bool*) malloc(sizeof(bool) * m_size);
-    for (size_t pos = 0 ; pos < copy.m_size ; pos++) {
-      m_bitmap[pos] = copy.GetValue(pos);
-    }
+    :m_size	(copy.m_size)
+    ,m_numBlocks (copy.m_numBlocks) {
+    Allocate();
+    std::memcpy(m_bitmap, copy.m_bitmap, sizeof(Block) * m_numBlocks);
   }
   ~WordsBitmap() {
-    free(m_bitmap);
+    if (m_bitmap != m_inline)
+      free(m_bitmap);
   }
   //! count of words translated
   size_t GetNumWordsCovered() const {
     size_t count = 0;
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (m_bitmap[pos])
-        count++;
+    for (size_t i = 0 ; i < m_numBlocks ; i++) {
+      count += PopCount(m_bitmap[i]);
     }
     return count;
   }
 
   //! position of 1st word not yet translated, or NOT_FOUND if everything already translated
   size_t GetFirstGapPos() const {
-    for (size_t pos = 0 ; pos < m_size ; pos++) {
-      if (!m_bitmap[pos]) {
-        return pos;
+    for (size_t i = 0 ; i < m_numBlocks ; i++) {
+      Block gaps = ~m_bitmap[i] & ValidMask(i);
+      if (gaps) {
+        return i * BitsPerBlock + LowestBit(gaps);
       }
     }
     // no starting pos
@@ -111,9 +188,10 @@ public:
 
   //! position of last word not yet translated, or NOT_FOUND if everything already translated
   size_t GetLastGapPos() const {
-    for (int pos = (int) m_size - 1 ; pos >= 0 ; pos--) {
-      if (!m_bitmap[pos]) {
-        return pos;
+    for (size_t i = m_numBlocks ; i > 0 ; i--) {
+      Block gaps = ~m_bitmap[i-1] & ValidMask(i-1);
+      if (gaps) {
+        return (i-1) * BitsPerBlock + HighestBit(gaps);
       }
     }
     // no starting pos
@@ -123,9 +201,9 @@ public:
 
   //! position of last translated word
   size_t GetLastPos() const {
-    for (int pos = (int) m_size - 1 ; pos >= 0 ; pos--) {
-      if (m_bitmap[pos]) {
-        return pos;
+    for (size_t i = m_numBlocks ; i > 0 ; i--) {
+      if (m_bitmap[i-1]) {
+        return (i-1) * BitsPerBlock + HighestBit(m_bitmap[i-1]);
       }
     }
     // no starting pos
@@ -134,26 +212,35 @@ public:
 
   //! whether a word has been translated at a particular position
   bool GetValue(size_t pos) const {
-    return m_bitmap[pos];
+    return (m_bitmap[pos / BitsPerBlock] >> (pos % BitsPerBlock)) & 1;
   }
   //! set value at a particular position
   void SetValue( size_t pos, bool value ) {
-    m_bitmap[pos] = value;
+    Block bit = Block(1) << (pos % BitsPerBlock);
+    if (value)
+      m_bitmap[pos / BitsPerBlock] |= bit;
+    else
+      m_bitmap[pos / BitsPerBlock] &= ~bit;
   }
   //! set value between 2 positions, inclusive
   void SetValue( size_t startPos, size_t endPos, bool value ) {
-    for(size_t pos = startPos ; pos <= endPos ; pos++) {
-      m_bitmap[pos] = value;
+    for (size_t i = startPos / BitsPerBlock ; i <= endPos / BitsPerBlock ; i++) {
+      if (value)
+        m_bitmap[i] |= RangeMask(i, startPos, endPos);
+      else
+        m_bitmap[i] &= ~RangeMask(i, startPos, endPos);
     }
   }
   //! whether every word has been translated
   bool IsComplete() const {
-    return GetSize() == GetNumWordsCovered();
+    return GetFirstGapPos() == NOT_FOUND;
   }
   //! whether the wordrange overlaps with any translated word in this bitmap
   bool Overlap(const WordsRange &compare) const {
-    for (size_t pos = compare.GetStartPos() ; pos <= compare.GetEndPos() ; pos++) {
-      if (m_bitmap[pos])
+    size_t startPos = compare.GetStartPos()
+                      ,endPos = compare.GetEndPos();
+    for (size_t i = startPos / BitsPerBlock ; i <= endPos / BitsPerBlock ; i++) {
+      if (m_bitmap[i] & RangeMask(i, startPos, endPos))
         return true;
     }
     return false;
@@ -163,7 +250,8 @@ public:
     return m_size;
   }
 
-  //! transitive comparison of WordsBitmap
+  //! transitive comparison of WordsBitmap.
+  //! orders the same way as a position-by-position comparison would
   inline int Compare (const WordsBitmap &compare) const {
     // -1 = less than
     // +1 = more than
@@ -175,27 +263,55 @@ public:
     if (thisSize != compareSize) {
       return (thisSize < compareSize) ? -1 : 1;
     }
-    return std::memcmp(m_bitmap, compare.m_bitmap, thisSize * sizeof(bool));
+    for (size_t i = 0 ; i < m_numBlocks ; i++) {
+      Block diff = m_bitmap[i] ^ compare.m_bitmap[i];
+      if (diff) {
+        // the lowest differing position decides
+        return ((m_bitmap[i] >> LowestBit(diff)) & 1) ? 1 : -1;
+      }
+    }
+    return 0;
   }
 
   bool operator< (const WordsBitmap &compare) const {
     return Compare(compare) < 0;
   }
 
+  bool operator== (const WordsBitmap &compare) const {
+    return Compare(compare) == 0;
+  }
+
+  //! hash of the coverage, consistent with Compare()
+  size_t hash() const {
+    UINT64 seed = m_size;
+    for (size_t i = 0 ; i < m_numBlocks ; i++) {
+      seed ^= m_bitmap[i] + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    }
+    return (size_t) seed;
+  }
+
   inline size_t GetEdgeToTheLeftOf(size_t l) const {
     if (l == 0) return l;
-    while (l && !m_bitmap[l-1]) {
-      --l;
+    // last translated word before l
+    for (size_t i = (l-1) / BitsPerBlock + 1 ; i > 0 ; i--) {
+      Block covered = m_bitmap[i-1] & RangeMask(i-1, 0, l-1);
+      if (covered) {
+        return (i-1) * BitsPerBlock + HighestBit(covered) + 1;
+      }
     }
-    return l;
+    return 0;
   }
 
   inline size_t GetEdgeToTheRightOf(size_t r) const {
     if (r+1 == m_size) return r;
-    while (r+1 < m_size && !m_bitmap[r+1]) {
-      ++r;
+    // first translated word after r
+    for (size_t i = (r+1) / BitsPerBlock ; i < m_numBlocks ; i++) {
+      Block covered = m_bitmap[i] & RangeMask(i, r+1, m_size-1);
+      if (covered) {
+        return i * BitsPerBlock + LowestBit(covered) - 1;
+      }
     }
-    return r;
+    return m_size - 1;
   }
 
 
@@ -214,8 +330,9 @@ public:
 
     assert(end < start || end-start <= 16);
     WordsBitmapID id = 0;
-    for(size_t pos = end; pos > start; pos--) {
-      id = id*2 + (int) GetValue(pos);
+    if (end > start) {
+      // bit for position start+1 is the least significant one
+      id = (WordsBitmapID) GetBits(start+1, end-start);
     }
     return id + (1<<16) * start;
   }
@@ -235,10 +352,16 @@ public:
 
     assert(end < start || end-start <= 16);
     WordsBitmapID id = 0;
-    for(size_t pos = end; pos > start; pos--) {
-      id = id*2;
-      if (GetValue(pos) || (startPos<=pos && pos<=endPos))
-        id++;
+    if (end > start) {
+      Block bits = GetBits(start+1, end-start);
+      // add the span, shifted into the window (start, end]
+      size_t spanStart = (startPos > start) ? startPos : start+1;
+      if (spanStart <= endPos) {
+        size_t spanLength = endPos - spanStart + 1;
+        Block span = (spanLength >= BitsPerBlock) ? ~Block(0) : ((Block(1) << spanLength) - 1);
+        bits |= span << (spanStart - start - 1);
+      }
+      id = (WordsBitmapID) bits;
     }
     return id + (1<<16) * start;
   }
@@ -246,6 +369,12 @@ public:
   TO_STRING();
 };
 
+//! for use with boost::hash and friends
+inline size_t hash_value(const WordsBitmap &wordsBitmap)
+{
+  return wordsBitmap.hash();
+}
+
 // friend
 inline std::ostream& operator<<(std::ostream& out, const WordsBitmap& wordsBitmap)
 {